@@ -7,6 +7,6 @@ if [ ! -x ${CMD} ]; then
     exit 1
 fi
 
-for file in *.umetxt; do
-    ${CMD} "$file" "${file%.umetxt}.ume"
-done
+# Convert every partition, several at a time; extra arguments (such as
+# --jobs or --verify) are passed to txt2bin
+exec ${CMD} "$@" --batch '*.umetxt'
@@ -33,7 +33,7 @@ OutputIt pack(DST const &val, OutputIt d_first) {
   if constexpr (std::is_scalar_v<DST>) {
     *d_first++ = val;
   } else {
-    std::copy(std::begin(val), std::end(val), d_first);
+    d_first = std::copy(std::begin(val), std::end(val), d_first);
   }
   return d_first;
 }
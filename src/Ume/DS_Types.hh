@@ -18,11 +18,25 @@
 
 #include "Ume/RaggedRight.hh"
 #include "Ume/VecN.hh"
+#include <memory>
 #include <variant>
 #include <vector>
+#if defined(UME_DS_HOST_ALLOCATOR)
+#include "Ume/host_alloc.hh"
+#endif
 
 namespace Ume {
 
+//! The allocator for the vector types held in the datastore
+/*! Building with UME_DS_HOST_ALLOCATOR places large mesh fields with
+    Host_Allocator, so that UME_HOST_PAGES can put them on huge pages or in
+    pinned memory at runtime. */
+#if defined(UME_DS_HOST_ALLOCATOR)
+template <typename T> using DS_Allocator = Host_Allocator<T>;
+#else
+template <typename T> using DS_Allocator = std::allocator<T>;
+#endif
+
 //! Types that can be held in the datastore
 struct DS_Types {
   //! An enumeration for switching between types
@@ -40,13 +54,13 @@ struct DS_Types {
   };
   // The actual C++ type declarations
   using INT_T = int; //!< scalar integer type
-  using INTV_T = std::vector<INT_T>; //!< vector<int> type
+  using INTV_T = std::vector<INT_T, DS_Allocator<INT_T>>; //!< vector<int> type
   using INTRR_T = RaggedRight<INT_T>; //!< RaggedRight<int> type
   using DBL_T = double; //!< scalar double type
-  using DBLV_T = std::vector<DBL_T>; //!< vector<double> type
+  using DBLV_T = std::vector<DBL_T, DS_Allocator<DBL_T>>; //!< vector<double>
   using DBLRR_T = RaggedRight<DBL_T>; //!< RaggedRight<double> type
   using VEC3_T = Vec3; //!< scalar Vec3 type
-  using VEC3V_T = std::vector<VEC3_T>; //!< vector<Vec3> type
+  using VEC3V_T = std::vector<VEC3_T, DS_Allocator<VEC3_T>>; //!< vector<Vec3>
   using VEC3RR_T = RaggedRight<VEC3_T>; //!< RaggedRight<Vec3> type
 };
 
@@ -14,8 +14,13 @@
 */
 
 #include "Ume/Datastore.hh"
+#include "Ume/Timer.hh"
+#include <algorithm>
 #include <cstdlib>
+#include <fstream>
 #include <iomanip>
+#include <sstream>
+#include <type_traits>
 
 namespace Ume {
 
@@ -53,6 +58,71 @@ void DS_Entry::set_type(DS_Entry::Types type) {
   }
 }
 
+size_t DS_Entry::resident_bytes() const {
+  return std::visit(
+      [](auto const &d) -> size_t {
+        using DT = std::decay_t<decltype(d)>;
+        if constexpr (std::is_same_v<DT, INT_T> || std::is_same_v<DT, DBL_T> ||
+            std::is_same_v<DT, VEC3_T>) {
+          return 0;
+        } else if constexpr (std::is_same_v<DT, INTRR_T> ||
+            std::is_same_v<DT, DBLRR_T> || std::is_same_v<DT, VEC3RR_T>) {
+          return d.resident_bytes();
+        } else {
+          return d.capacity() * sizeof(typename DT::value_type);
+        }
+      },
+      data_);
+}
+
+bool DS_Entry::recompute_() const {
+  Timer t;
+  t.start();
+  bool const result = init_();
+  t.stop();
+  evicted_ = false;
+  recomputes_ += 1;
+  recompute_seconds_ += t.seconds();
+  return result;
+}
+
+void DS_Entry::evict_() const {
+  bytes_evicted_ += resident_bytes();
+  evictions_ += 1;
+  /* Assigning a default-constructed value releases the storage */
+  std::visit([](auto &d) { d = std::decay_t<decltype(d)>(); }, data_);
+  init_state_ = Init_State::UNINITIALIZED;
+  evicted_ = true;
+}
+
+void DS_Entry::write_data_(std::ostream &os) const {
+  std::visit(
+      [&os](auto const &d) {
+        using DT = std::decay_t<decltype(d)>;
+        if constexpr (std::is_same_v<DT, INTRR_T> ||
+            std::is_same_v<DT, DBLRR_T> || std::is_same_v<DT, VEC3RR_T>) {
+          d.write(os);
+        } else {
+          write_bin(os, d);
+        }
+      },
+      data_);
+}
+
+void DS_Entry::read_data_(std::istream &is) const {
+  std::visit(
+      [&is](auto &d) {
+        using DT = std::decay_t<decltype(d)>;
+        if constexpr (std::is_same_v<DT, INTRR_T> ||
+            std::is_same_v<DT, DBLRR_T> || std::is_same_v<DT, VEC3RR_T>) {
+          d.read(is);
+        } else {
+          read_bin(is, d);
+        }
+      },
+      data_);
+}
+
 Datastore *Datastore::add_child_(char const *const name) {
   children_.emplace_back(new Datastore(name));
   children_.back()->parent_ = this;
@@ -99,6 +169,245 @@ DS_Entry const *Datastore::cfind_or_die(std::string const &name) const {
   return ptr;
 }
 
+void Datastore::collect_entries_(std::vector<DS_Entry const *> &list) const {
+  for (auto const &pair : entries_)
+    list.push_back(pair.second.get());
+  for (auto const &c : children_)
+    c->collect_entries_(list);
+}
+
+size_t Datastore::evict_to_budget() {
+  if (memory_budget_ == 0)
+    return 0;
+
+  std::vector<DS_Entry const *> all;
+  collect_entries_(all);
+
+  /* Candidates are initialized, recomputable entries.  Anything that is
+     IN_PROGRESS is in the middle of being built and is left alone. */
+  std::vector<std::pair<DS_Entry const *, size_t>> candidates;
+  size_t held{0};
+  for (auto const *e : all) {
+    if (!e->recomputable() || e->init_state_ != DS_Entry::Init_State::INITIALIZED)
+      continue;
+    size_t const bytes = e->resident_bytes();
+    held += bytes;
+    candidates.emplace_back(e, bytes);
+  }
+  if (held <= memory_budget_)
+    return 0;
+
+  std::sort(candidates.begin(), candidates.end(),
+      [](auto const &a, auto const &b) {
+        return a.first->last_use_ < b.first->last_use_;
+      });
+
+  size_t released{0};
+  for (auto const &[e, bytes] : candidates) {
+    if (held - released <= memory_budget_)
+      break;
+    e->evict_();
+    released += bytes;
+  }
+  return released;
+}
+
+size_t Datastore::shrink_to_fit() {
+  std::vector<DS_Entry const *> all;
+  collect_entries_(all);
+  size_t released{0};
+  for (auto const *e : all) {
+    size_t const before = e->resident_bytes();
+    std::visit(
+        [](auto &d) {
+          if constexpr (requires { d.shrink_to_fit(); })
+            d.shrink_to_fit();
+        },
+        e->data_);
+    released += before - e->resident_bytes();
+  }
+  return released;
+}
+
+size_t Datastore::invalidate_derived() {
+  std::vector<DS_Entry const *> all;
+  collect_entries_(all);
+  size_t released{0};
+  for (auto const *e : all) {
+    if (!e->recomputable() ||
+        e->init_state_ == DS_Entry::Init_State::IN_PROGRESS)
+      continue;
+    released += e->resident_bytes();
+    std::visit([](auto &d) { d = std::decay_t<decltype(d)>(); }, e->data_);
+    e->init_state_ = DS_Entry::Init_State::UNINITIALIZED;
+    /* This is not an eviction, so the rebuild is not counted as a recompute */
+    e->evicted_ = false;
+  }
+  return released;
+}
+
+bool Datastore::is_primary(std::string const &name, Types const t) const {
+  DS_Entry const *const e = cfind(name);
+  return e && !e->recomputable() && e->type_ == t;
+}
+
+Datastore::Eviction_Stats Datastore::eviction_stats() const {
+  std::vector<DS_Entry const *> all;
+  collect_entries_(all);
+  Eviction_Stats stats;
+  for (auto const *e : all) {
+    size_t const bytes = e->resident_bytes();
+    stats.resident_bytes += bytes;
+    if (e->recomputable())
+      stats.recomputable_bytes += bytes;
+    stats.evictions += e->evictions_;
+    stats.bytes_evicted += e->bytes_evicted_;
+    stats.recomputes += e->recomputes_;
+    stats.recompute_seconds += e->recompute_seconds_;
+  }
+  return stats;
+}
+
+void Datastore::print_eviction_stats(std::ostream &os) const {
+  auto const stats = eviction_stats();
+  os << "Datastore " << path() << ": budget " << memory_budget_
+     << " bytes, resident " << stats.resident_bytes << " bytes ("
+     << stats.recomputable_bytes << " recomputable)\n"
+     << "  evictions: " << stats.evictions << " (" << stats.bytes_evicted
+     << " bytes), recomputes: " << stats.recomputes << " ("
+     << stats.recompute_seconds << "s)" << std::endl;
+}
+
+void Datastore::write_snapshot(std::ostream &os) const {
+  write_bin(os, std::string{"ds_snapshot"});
+  write_bin(os, int{UME_DS_SNAPSHOT_1});
+  write_bin(os, name_);
+  write_snapshot_(os);
+}
+
+void Datastore::write_snapshot_(std::ostream &os) const {
+  /* Sort the names so that identical datastores give identical snapshots */
+  std::vector<std::string> names;
+  for (auto const &pair : entries_)
+    if (pair.second->init_state_ == DS_Entry::Init_State::INITIALIZED)
+      names.push_back(pair.first);
+  std::sort(names.begin(), names.end());
+
+  write_bin(os, names.size());
+  for (auto const &n : names) {
+    DS_Entry const *e = entries_.at(n).get();
+    write_bin(os, n);
+    write_bin(os, static_cast<int>(e->type_));
+    write_bin(os, static_cast<int>(e->init_state_));
+    e->write_data_(os);
+  }
+
+  write_bin(os, children_.size());
+  for (auto const &c : children_) {
+    write_bin(os, c->name_);
+    c->write_snapshot_(os);
+  }
+}
+
+bool Datastore::read_snapshot(std::istream &is) {
+  std::string tag, name;
+  int version{0};
+  read_bin(is, tag);
+  read_bin(is, version);
+  if (!is || tag != "ds_snapshot") {
+    std::cerr << "Error: not a datastore snapshot" << std::endl;
+    return false;
+  }
+  if (version != UME_DS_SNAPSHOT_1) {
+    std::cerr << "Error: unsupported datastore snapshot version " << version
+              << std::endl;
+    return false;
+  }
+  read_bin(is, name);
+
+  /* Read the whole snapshot before changing anything, so that a bad entry
+     late in the snapshot does not leave the tree partly restored */
+  std::vector<std::pair<DS_Entry const *, DS_Entry>> staged;
+  if (!read_snapshot_(is, this, staged))
+    return false;
+  for (auto &[e, s] : staged) {
+    e->data_ = std::move(s.data_);
+    e->init_state_ = s.init_state_;
+    e->evicted_ = false;
+  }
+  return true;
+}
+
+/* Read one datastore's worth of snapshot data, adding the entries that match
+   ds to `staged`.  If ds is null, the data is read and discarded. */
+bool Datastore::read_snapshot_(std::istream &is, Datastore *ds,
+    std::vector<std::pair<DS_Entry const *, DS_Entry>> &staged) {
+  size_t num_entries{0};
+  read_bin(is, num_entries);
+  for (size_t i = 0; i < num_entries && is; ++i) {
+    std::string name;
+    int type, state;
+    read_bin(is, name);
+    read_bin(is, type);
+    read_bin(is, state);
+    if (!is)
+      break;
+    /* Only INITIALIZED entries are written */
+    if (type < static_cast<int>(Types::INT) ||
+        type > static_cast<int>(Types::NONE) ||
+        state != static_cast<int>(DS_Entry::Init_State::INITIALIZED)) {
+      std::cerr << "Error: snapshot entry " << std::quoted(name)
+                << " has an invalid type or state" << std::endl;
+      return false;
+    }
+
+    DS_Entry const *e{nullptr};
+    if (ds) {
+      if (auto it = ds->entries_.find(name); it != ds->entries_.end())
+        e = it->second.get();
+    }
+    if (e && e->type_ != static_cast<Types>(type)) {
+      std::cerr << "Error: snapshot entry " << std::quoted(name)
+                << " does not match the type in datastore "
+                << std::quoted(ds->path()) << std::endl;
+      return false;
+    }
+    DS_Entry s(static_cast<Types>(type));
+    s.read_data_(is);
+    s.init_state_ = static_cast<DS_Entry::Init_State>(state);
+    if (e)
+      staged.emplace_back(e, std::move(s));
+  }
+
+  size_t num_children{0};
+  read_bin(is, num_children);
+  for (size_t i = 0; i < num_children && is; ++i) {
+    std::string name;
+    read_bin(is, name);
+    Datastore *child{nullptr};
+    if (ds) {
+      for (auto &c : ds->children_)
+        if (c->name_ == name)
+          child = c.get();
+    }
+    if (!read_snapshot_(is, child, staged))
+      return false;
+  }
+  return static_cast<bool>(is);
+}
+
+std::future<bool> Datastore::write_snapshot_async(
+    std::string const &filename) const {
+  std::ostringstream buf;
+  write_snapshot(buf);
+  return std::async(std::launch::async,
+      [filename, data = std::move(buf).str()]() {
+        std::ofstream os(filename, std::ios::binary);
+        os.write(data.data(), static_cast<std::streamsize>(data.size()));
+        return static_cast<bool>(os);
+      });
+}
+
 Datastore::~Datastore() {
   for (auto &p : children_) {
     p.reset();
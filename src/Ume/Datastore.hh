@@ -17,13 +17,20 @@
 #define UME_DATASTORE_HH 1
 
 #include "Ume/DS_Types.hh"
+#include <atomic>
+#include <cstdint>
+#include <future>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <variant>
 #include <vector>
 #include <iostream>
 
+//! Tag written at the start of a Datastore snapshot
+#define UME_DS_SNAPSHOT_1 20261018
+
 namespace Ume {
 
 class Datastore;
@@ -42,6 +49,14 @@ public:
   //! Set the type of the data held in this entry
   void set_type(Types t);
 
+  //! Return true if this entry can be discarded and rebuilt by `init_()`
+  /*! Entries holding primary data (e.g. connectivity read from a file) are
+      not recomputable. Derived fields override this; see Entity_Field. */
+  virtual bool recomputable() const { return false; }
+
+  //! Return the number of heap bytes held by the `data_` variant
+  size_t resident_bytes() const;
+
 protected:
   friend class Datastore;
 
@@ -66,6 +81,36 @@ protected:
   //! The current initialization state
   mutable Init_State init_state_{Init_State::UNINITIALIZED};
 
+  //! A global counter that orders entries by their most recent access
+  /*! This is shared by every Datastore, including those of meshes used on
+      different threads (e.g. txt2bin --batch), so it is atomic. */
+  static inline std::atomic<std::uint64_t> access_clock_{0};
+  //! The value of `access_clock_` at the most recent access of this entry
+  mutable std::uint64_t last_use_{0};
+  //! True if the data was dropped by Datastore::evict_to_budget()
+  mutable bool evicted_{false};
+  //! Eviction and recompute counters (see Datastore::eviction_stats())
+  mutable size_t evictions_{0}, bytes_evicted_{0}, recomputes_{0};
+  //! Total time spent in `init_()` rebuilding this entry after evictions
+  mutable double recompute_seconds_{0.0};
+
+  //! Called by the Datastore accessors: update the LRU stamp and initialize
+  /*! Returns the result of `init_()`. */
+  bool touch_() const {
+    last_use_ = access_clock_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (evicted_ && init_state_ == Init_State::UNINITIALIZED)
+      return recompute_();
+    return init_();
+  }
+  //! Rebuild an evicted entry, recording the time spent doing so
+  bool recompute_() const;
+  //! Release the data held by this entry and mark it UNINITIALIZED
+  void evict_() const;
+  //! Binary write of the `data_` variant
+  void write_data_(std::ostream &os) const;
+  //! Binary read of the `data_` variant, which must already have `type_` set
+  void read_data_(std::istream &is) const;
+
 protected:
   //! Default initialization call
   /*! Each derived version of this class should provide an `init_()` function
@@ -127,13 +172,13 @@ public:
 #define MAKE_ACCESS(Y, T) \
   inline T &access_##Y(char const *const name) { \
     auto ptr = find_or_die(name); \
-    ptr->init_(); \
+    ptr->touch_(); \
     ptr->dirty_ = true; \
     return std::get<T>(ptr->data_); \
   } \
   inline T const &caccess_##Y(char const *const name) const { \
     auto ptr = cfind_or_die(name); \
-    ptr->dirty_ = ptr->init_(); \
+    ptr->dirty_ = ptr->touch_(); \
     return std::get<T>(ptr->data_); \
   }
 
@@ -149,6 +194,76 @@ public:
 
 #undef MAKE_ACCESS
 
+  //! Eviction activity for a datastore subtree
+  struct Eviction_Stats {
+    size_t resident_bytes{0}; //!< heap bytes currently held by entries
+    size_t recomputable_bytes{0}; //!< the portion held by recomputable entries
+    size_t evictions{0}; //!< number of entries evicted
+    size_t bytes_evicted{0}; //!< total bytes released by evictions
+    size_t recomputes{0}; //!< number of evicted entries rebuilt on access
+    double recompute_seconds{0.0}; //!< time spent rebuilding evicted entries
+  };
+
+  //! Set a soft limit on the bytes held by recomputable entries (0 = none)
+  /*! The budget applies to this datastore and its children, and is enforced
+      by evict_to_budget(). */
+  void set_memory_budget(size_t const bytes) { memory_budget_ = bytes; }
+  //! Return the memory budget in bytes (0 means unlimited)
+  constexpr size_t memory_budget() const { return memory_budget_; }
+
+  //! Evict least-recently-used recomputable entries until under budget
+  /*! Evicted entries drop their data and revert to UNINITIALIZED, so that
+      their `init_()` rebuilds them on the next access.  Since the accessors
+      hand out references, this is never done implicitly during an access:
+      call it at points where no references to derived fields are held (e.g.
+      between kernels).  Returns the number of bytes released. */
+  size_t evict_to_budget();
+
+  //! Shrink the capacity of every array entry to its size
+  /*! This applies to this datastore and its children, and returns the
+      resulting change in resident bytes.  Resizing arrays down does not free
+      their storage; this does. */
+  size_t shrink_to_fit();
+
+  //! Discard the data of every recomputable entry
+  /*! Call this after changing primary data in place (e.g. after renumbering a
+      mesh), so that derived fields are rebuilt from the new data on their
+      next access.  As with evict_to_budget(), no references to derived
+      fields may be held.  This applies to this datastore and its children,
+      and returns the number of bytes released. */
+  size_t invalidate_derived();
+
+  //! Return true if `name` is an entry of type `t` holding primary data
+  /*! Primary entries are the ones that are not recomputable, and so must be
+      updated in place when the mesh changes. */
+  bool is_primary(std::string const &name, Types t) const;
+
+  //! Gather eviction statistics for this datastore and its children
+  Eviction_Stats eviction_stats() const;
+  //! Print a summary of eviction_stats()
+  void print_eviction_stats(std::ostream &os) const;
+
+  //! Write all INITIALIZED entries of this datastore and its children
+  /*! The snapshot records the type and initialization state of each entry
+      along with its data, so that read_snapshot() can restore derived fields
+      without recomputing them. Uninitialized entries are not written. */
+  void write_snapshot(std::ostream &os) const;
+
+  //! Restore entries from a snapshot created by write_snapshot()
+  /*! Entries and children are matched by name; names in the snapshot that
+      are not present in this datastore are skipped.  Restored entries are
+      marked INITIALIZED.  Returns false if the snapshot is not compatible
+      with this tree (bad tag, version, or mismatched entry type) or is
+      damaged, in which case no entries are changed. */
+  bool read_snapshot(std::istream &is);
+
+  //! Write a snapshot to `filename` in the background
+  /*! The snapshot is serialized into memory before this returns, so the
+      caller is free to modify the datastore while the file is written.  The
+      future returns true if the write succeeded. */
+  [[nodiscard]] std::future<bool> write_snapshot_async(
+      std::string const &filename) const;
+
   //! Recursively delete this tree and its children.
   ~Datastore();
 
@@ -161,12 +276,18 @@ private:
   [[nodiscard]] DS_Entry const *cfind(std::string const &name) const;
   [[nodiscard]] DS_Entry *find_or_die(std::string const &name);
   [[nodiscard]] DS_Entry const *cfind_or_die(std::string const &name) const;
+  void collect_entries_(std::vector<DS_Entry const *> &list) const;
+  void write_snapshot_(std::ostream &os) const;
+  static bool read_snapshot_(std::istream &is, Datastore *ds,
+      std::vector<std::pair<DS_Entry const *, DS_Entry>> &staged);
 
 private:
   //! The actual datastore
   std::unordered_map<std::string, eptr> entries_;
   //! The name of this datastore
   std::string name_;
+  //! The limit on bytes held by recomputable entries (0 = unlimited)
+  size_t memory_budget_{0};
 
 public:
   //! Return a list of "to" maps for a mesh entity.
@@ -37,6 +37,9 @@ public:
   //! Associate this field with an Entity and set the datatype
   Entity_Field(Types t, Entity &be) : DS_Entry(t), base_entity_{be} {}
 
+  //! Entity fields are derived from mesh data, and can be rebuilt on demand
+  bool recomputable() const override { return true; }
+
   //! Define Datastore accessors via the base entity and an accessor for mydata
 #define MAKE_DS_ACCESS(Y, R) \
   R &access_##Y(char const *const name) { \
@@ -16,51 +16,261 @@
 #ifndef UME_RAGGEDRIGHT_HH
 #define UME_RAGGEDRIGHT_HH
 
+#include "Ume/mem_exec_spaces.hh"
+#include "Ume/utils.hh"
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
 #include <span>
+#include <type_traits>
 #include <vector>
 
 namespace Ume {
 
+//! A device-usable view of a RaggedRight
+/*! This holds Kokkos::Views of the CSR offsets and data, so that it can be
+    captured by value in a KOKKOS_LAMBDA.  The entries of row `n` are
+    data(i) for i in [begin(n)..end(n)). Create these with RaggedRight::view().
+ */
+template <class T, class MemSpace> struct RaggedRight_View {
+  Kokkos::View<const int *, MemSpace> offsets;
+  Kokkos::View<T *, MemSpace> data;
+
+  //! The number of rows
+  KOKKOS_INLINE_FUNCTION int num_rows() const {
+    return static_cast<int>(offsets.extent(0)) - 1;
+  }
+  //! The index into `data` of the first entry in row `n`
+  KOKKOS_INLINE_FUNCTION int begin(int const n) const { return offsets(n); }
+  //! The index into `data` one past the last entry in row `n`
+  KOKKOS_INLINE_FUNCTION int end(int const n) const { return offsets(n + 1); }
+  //! The length of row `n`
+  KOKKOS_INLINE_FUNCTION int size(int const n) const {
+    return offsets(n + 1) - offsets(n);
+  }
+  //! The `j`th entry of row `n`
+  KOKKOS_INLINE_FUNCTION T &operator()(int const n, int const j) const {
+    return data(offsets(n) + j);
+  }
+};
+
 //! An array-of-arrays, where each array can be a different length
-/*! Implemented as three arrays: the data for primary index `n` is stored in the
-    array `data`, in the half-open interval [bidx[n]..eidx[n]).
+/*! Stored in compressed sparse row (CSR) form: the data for primary index `n`
+    is stored in the array `data`, in the half-open interval
+    [offsets[n]..offsets[n+1]).  The preferred way to build one is to call
+    init_from_counts() with the length of each row, and then fill the rows in
+    place through operator[].
  */
 template <class T> struct RaggedRight {
   RaggedRight() = default;
   explicit RaggedRight(int base_size) { init(base_size); }
+
+  //! Set the number of rows, each of which is empty
   void init(int const len) {
-    bidx.assign(len, 0);
-    eidx.assign(len, 0);
+    offsets.assign(len + 1, 0);
+    data.clear();
+    dev_current = false;
+  }
+
+  //! Set the number of rows and their lengths
+  /*! The row offsets are the exclusive prefix sum of `counts`, computed in
+      parallel on ExecSpace (which must be able to access host memory). The
+      `data` array is sized to hold all of the rows, and the row contents are
+      value-initialized. */
+  template <class ExecSpace = HostExecSpace>
+  void init_from_counts(std::vector<int> const &counts) {
+    int const len = static_cast<int>(counts.size());
+    offsets.resize(len + 1);
+    Kokkos::View<const int *, HostSpace> h_counts(counts.data(), len);
+    Kokkos::View<int *, HostSpace> h_offsets(offsets.data(), len + 1);
+    int total{0};
+    Kokkos::parallel_scan(
+        "RaggedRight::init_from_counts", Kokkos::RangePolicy<ExecSpace>(0, len),
+        [=](const int n, int &partial, const bool final) {
+          if (final)
+            h_offsets(n) = partial;
+          partial += h_counts(n);
+        },
+        total);
+    offsets[len] = total;
+    data.clear();
+    data.resize(total);
+    dev_current = false;
+  }
+
+  //! Build from a container of rows (e.g. a vector of vectors or sets)
+  template <class Rows> void assign_rows(Rows const &rows) {
+    std::vector<int> counts;
+    counts.reserve(std::size(rows));
+    for (auto const &r : rows)
+      counts.push_back(static_cast<int>(std::size(r)));
+    init_from_counts(counts);
+    int n{0};
+    for (auto const &r : rows)
+      std::copy(std::begin(r), std::end(r), (*this)[n++].begin());
   }
 
   bool operator==(RaggedRight<T> const &rhs) const {
-    return (bidx == rhs.bidx && eidx == rhs.eidx && data == rhs.data);
+    return (offsets == rhs.offsets && data == rhs.data);
   }
 
   std::span<T> operator[](int const n) {
-    return std::span(data.begin() + bidx[n], size(n));
+    dev_current = false;
+    return std::span(data.begin() + offsets[n], size(n));
   }
   std::span<T const> const operator[](int const n) const {
-    return std::span(data.cbegin() + bidx[n], size(n));
+    return std::span(data.cbegin() + offsets[n], size(n));
   }
 
   //! Copy the contents of the range [`b`..`e`) to element `n`
-  /*! Note that if `n` has already been assigned data, it will be abandonend in
-      the `data` array! */
+  /*! Any existing data in `n` is replaced in place, and the following rows
+      are shifted.  This costs O(total size), so use init_from_counts() when
+      building an entire RaggedRight. */
   template <class IT> void assign(int const n, IT const b, IT const e) {
-    bidx.at(n) = static_cast<int>(data.size());
-    data.insert(data.end(), b, e);
-    eidx.at(n) = static_cast<int>(data.size());
+    int const old_len = size(n);
+    int const new_len = static_cast<int>(std::distance(b, e));
+    auto pos = data.erase(
+        data.begin() + offsets.at(n), data.begin() + offsets[n + 1]);
+    data.insert(pos, b, e);
+    dev_current = false;
+    if (new_len != old_len) {
+      for (size_t i = n + 1; i < offsets.size(); ++i)
+        offsets[i] += new_len - old_len;
+    }
   }
 
   //! Return the length of the n'th array
-  constexpr int size(int const n) const { return eidx[n] - bidx[n]; }
+  constexpr int size(int const n) const { return offsets[n + 1] - offsets[n]; }
+
+  //! Return the number of arrays
+  constexpr int num_rows() const {
+    return offsets.empty() ? 0 : static_cast<int>(offsets.size()) - 1;
+  }
+
+  //! The CSR row offsets (num_rows() + 1 entries)
+  std::span<int const> row_offsets() const { return offsets; }
+  //! The concatenated data of all rows
+  std::span<T> values() {
+    dev_current = false;
+    return data;
+  }
+  //! The concatenated data of all rows (const)
+  std::span<T const> values() const { return data; }
+
+  //! Release any excess capacity, e.g. after a series of assign() calls
+  void compact() {
+    offsets.shrink_to_fit();
+    data.shrink_to_fit();
+    dev_current = false;
+  }
+
+  //! Return a view of this object that is usable in MemSpace
+  /*! If MemSpace can access host memory, the view aliases this object;
+      otherwise the offsets and data are copied to MemSpace.  The copy in
+      DevExecMemSpace is kept, and reused by later calls until this object is
+      modified through one of its non-const members.  Writes through a span
+      obtained before the view() call are not seen by it. */
+  template <class MemSpace> RaggedRight_View<T const, MemSpace> view() const {
+    Kokkos::View<const int *, HostSpace> h_offsets(
+        offsets.data(), offsets.size());
+    Kokkos::View<const T *, HostSpace> h_data(data.data(), data.size());
+    if constexpr (std::is_same_v<MemSpace, DevExecMemSpace> &&
+        !Kokkos::SpaceAccessibility<MemSpace, HostSpace>::accessible) {
+      if (!dev_current) {
+        dev_offsets =
+            Kokkos::create_mirror_view_and_copy(MemSpace(), h_offsets);
+        dev_data = Kokkos::create_mirror_view_and_copy(MemSpace(), h_data);
+        dev_current = true;
+      }
+      return RaggedRight_View<T const, MemSpace>{dev_offsets, dev_data};
+    }
+    return RaggedRight_View<T const, MemSpace>{
+        Kokkos::create_mirror_view_and_copy(MemSpace(), h_offsets),
+        Kokkos::create_mirror_view_and_copy(MemSpace(), h_data)};
+  }
+
+  //! Return the number of heap bytes held by this object
+  /*! This includes the device copy kept by view(), if there is one. */
+  size_t resident_bytes() const {
+    return offsets.capacity() * sizeof(int) + data.capacity() * sizeof(T) +
+        dev_offsets.extent(0) * sizeof(int) + dev_data.extent(0) * sizeof(T);
+  }
+
+  //! Binary write, using the same conventions as write_bin for vectors
+  void write(std::ostream &os) const {
+    write_bin(os, offsets);
+    write_bin(os, data);
+  }
+
+  //! Binary read of data generated by write()
+  void read(std::istream &is) {
+    read_bin(is, offsets);
+    read_bin(is, data);
+    dev_current = false;
+  }
 
 private:
-  std::vector<int> bidx, eidx;
+  std::vector<int> offsets;
   std::vector<T> data;
+  /* The cached device copy returned by view<DevExecMemSpace>().  Like any
+     Kokkos::View, it must be released before Kokkos::finalize(). */
+  mutable Kokkos::View<const int *, DevExecMemSpace> dev_offsets;
+  mutable Kokkos::View<const T *, DevExecMemSpace> dev_data;
+  mutable bool dev_current{false};
 };
 
+//! Build a RaggedRight<int> by inverting an item-to-row relation in parallel
+/*! Each item `i` in [0, `num_items`) contributes the value `value_of(i)` to
+    row `row_of(i)`, or nothing if `row_of(i)` is not in [0, `num_rows`)
+    (e.g. a bad connectivity value at a ghost).  The rows are built
+    with a parallel count, prefix sum, and fill on ExecSpace (which must be able
+    to access host memory), after which each row is sorted so that the result
+    does not depend on thread scheduling.  When `value_of` is increasing in
+    `i`, this gives the same row order as a serial push_back loop over items.
+ */
+template <class ExecSpace = HostExecSpace, class RowFn, class ValFn>
+void invert_map(RaggedRight<int> &rr, int const num_rows, int const num_items,
+    RowFn const &row_of, ValFn const &value_of) {
+  std::vector<int> counts(num_rows, 0);
+  Kokkos::View<int *, HostSpace> h_counts(counts.data(), counts.size());
+  Kokkos::parallel_for("invert_map-count",
+      Kokkos::RangePolicy<ExecSpace>(0, num_items), [&](const int i) {
+        int const r = row_of(i);
+        if (r >= 0 && r < num_rows) {
+#if defined(UME_SERIAL)
+          h_counts(r) += 1;
+#else
+          Kokkos::atomic_add(&h_counts(r), 1);
+#endif
+        }
+      });
+
+  rr.init_from_counts<ExecSpace>(counts);
+
+  /* Reuse the counts array as the per-row insertion cursor */
+  auto const offsets = rr.row_offsets();
+  std::copy(offsets.begin(), offsets.end() - 1, counts.begin());
+  auto const values = rr.values();
+  Kokkos::parallel_for("invert_map-fill",
+      Kokkos::RangePolicy<ExecSpace>(0, num_items), [&](const int i) {
+        int const r = row_of(i);
+        if (r >= 0 && r < num_rows) {
+#if defined(UME_SERIAL)
+          int const slot = h_counts(r)++;
+#else
+          int const slot = Kokkos::atomic_fetch_add(&h_counts(r), 1);
+#endif
+          values[slot] = value_of(i);
+        }
+      });
+
+  Kokkos::parallel_for("invert_map-sort",
+      Kokkos::RangePolicy<ExecSpace>(0, num_rows), [&](const int r) {
+        auto row = rr[r];
+        std::sort(row.begin(), row.end());
+      });
+}
+
 } // namespace Ume
 
 #endif
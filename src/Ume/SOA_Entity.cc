@@ -15,6 +15,7 @@
 #include "Ume/SOA_Entity.hh"
 #include "Ume/utils.hh"
 #include <cassert>
+#include <sstream>
 
 namespace Ume {
 
@@ -91,6 +92,35 @@ void Entity::read(std::istream &is) {
   skip_line(is);
 }
 
+void Entity::write(Section_Writer &w, std::string const &tag) const {
+  std::ostringstream os;
+  write_bin(os, lsize_);
+  write_bin<Comm::Neighbors>(os, myCpys);
+  write_bin<Comm::Neighbors>(os, mySrcs);
+  write_bin(os, subsets);
+  w.add_bytes(tag, os.str());
+  w.add(tag + "/mask", mask);
+  w.add(tag + "/comm_type", comm_type);
+  w.add(tag + "/cpy_idx", cpy_idx);
+  w.add(tag + "/src_pe", src_pe);
+  w.add(tag + "/src_idx", src_idx);
+  w.add(tag + "/ghost_mask", ghost_mask);
+}
+
+void Entity::read(Section_Reader &r, std::string const &tag) {
+  std::istringstream is(r.read_bytes(tag));
+  read_bin(is, lsize_);
+  read_bin<Comm::Neighbors>(is, myCpys);
+  read_bin<Comm::Neighbors>(is, mySrcs);
+  read_bin(is, subsets);
+  r.read(tag + "/mask", mask);
+  r.read(tag + "/comm_type", comm_type);
+  r.read(tag + "/cpy_idx", cpy_idx);
+  r.read(tag + "/src_pe", src_pe);
+  r.read(tag + "/src_idx", src_idx);
+  r.read(tag + "/ghost_mask", ghost_mask);
+}
+
 bool Entity::operator==(Entity const &rhs) const {
   return (lsize_ == rhs.lsize_ && mask == rhs.mask &&
       comm_type == rhs.comm_type && cpy_idx == rhs.cpy_idx &&
@@ -109,6 +139,16 @@ void Entity::resize(int const local, int const total, int const ghost) {
   lsize_ = local;
 }
 
+void Entity::release() {
+  resize(lsize_, 0, 0);
+  mask.shrink_to_fit();
+  comm_type.shrink_to_fit();
+  cpy_idx.shrink_to_fit();
+  src_pe.shrink_to_fit();
+  src_idx.shrink_to_fit();
+  ghost_mask.shrink_to_fit();
+}
+
 template <typename FT> void Entity::gather(Comm::Op const op, FT &field) {
   assert(static_cast<int>(field.size()) == size());
   Comm::Buffers<FT> cpyBufs(myCpys);
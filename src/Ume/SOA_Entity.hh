@@ -19,6 +19,7 @@
 #include "Ume/Comm_Transport.hh"
 #include "Ume/Datastore.hh"
 #include "Ume/Mesh_Base.hh"
+#include "Ume/mesh_sections.hh"
 #include <iosfwd>
 #include <ranges>
 #include <string>
@@ -137,25 +138,37 @@ struct Entity {
   /* Element sequences for iterating over. */
   //! Return a sequence over all indices.
   constexpr auto all_indices() const {
-    return std::ranges::iota_view{0, size() - 1};
+    return std::ranges::iota_view{0, size()};
   }
   //! Return a sequence over non-ghost indices.
   constexpr auto local_indices() const {
-    return std::ranges::iota_view{0, lsize_ - 1};
+    return std::ranges::iota_view{0, lsize_};
   }
   //! Return a sequence over ghost indices.
-  //! This requires at least one ghost to make sense.
   constexpr auto ghost_indices() const {
-    return std::ranges::iota_view{lsize_, size() - 1};
+    return std::ranges::iota_view{lsize_, size()};
   }
   //! Return a sequence over ghost indices offset to 0.
   constexpr auto ghost_indices_offset() const {
-    return std::ranges::iota_view{0, ghost_size() - 1};
+    return std::ranges::iota_view{0, ghost_local_size()};
   }
 
   virtual void write(std::ostream &os) const = 0;
   virtual void read(std::istream &is) = 0;
+  //! Add this Entity's sections for a UME_VERSION_3 file
+  virtual void write(Section_Writer &w) const = 0;
+  //! Read this Entity's sections from a UME_VERSION_3 file
+  virtual void read(Section_Reader &r) = 0;
+  /*! The sections common to all entities: the scalars, neighbors and subsets
+      in a BYTES section named `tag`, and each array in a section named
+      "<tag>/<array>" */
+  void write(Section_Writer &w, std::string const &tag) const;
+  void read(Section_Reader &r, std::string const &tag);
   virtual void resize(int const local, int const total, int const ghost);
+  /*! Resize to no elements (keeping local_size), and free the arrays held by
+      this class.  The Datastore arrays are freed by Datastore::shrink_to_fit.
+   */
+  void release();
   bool operator==(Entity const &rhs) const;
 
   //! Return the Datastore of the mesh that this Entity belongs to
@@ -48,6 +48,18 @@ void Corners::read(std::istream &is) {
   IVREAD("m:c>z");
 }
 
+void Corners::write(Section_Writer &w) const {
+  Entity::write(w, "corners");
+  IVSWRITE("corners", "m:c>p");
+  IVSWRITE("corners", "m:c>z");
+}
+
+void Corners::read(Section_Reader &r) {
+  Entity::read(r, "corners");
+  IVSREAD("corners", "m:c>p");
+  IVSREAD("corners", "m:c>z");
+}
+
 bool Corners::operator==(Corners const &rhs) const {
   return (Entity::operator==(rhs) && EQOP("m:c>p") && EQOP("m:c>z"));
 }
@@ -141,17 +153,13 @@ bool Corners::VAR_corner_to_sides::init_() const {
   auto const &s2c1{caccess_intv("m:s>c1")};
   auto const &s2c2{caccess_intv("m:s>c2")};
   auto &corner_to_sides = mydata_intrr();
-  corner_to_sides.init(cll);
-
-  std::vector<std::vector<int>> accum(cll);
-  for (int s = 0; s < sll; ++s) {
-    accum.at(s2c1[s]).push_back(s);
-    accum.at(s2c2[s]).push_back(s);
-  }
 
-  for (int c = 0; c < cll; ++c) {
-    corner_to_sides.assign(c, accum[c].begin(), accum[c].end());
-  }
+  /* Each side contributes to two corners: item i is side i/2, and corner
+     s2c1 for even i and s2c2 for odd i */
+  invert_map(
+      corner_to_sides, cll, 2 * sll,
+      [&](const int i) { return (i & 1) ? s2c2[i / 2] : s2c1[i / 2]; },
+      [](const int i) { return i / 2; });
   VAR_INIT_EPILOGUE;
 }
 
@@ -47,6 +47,18 @@ void Edges::read(std::istream &is) {
   IVREAD("m:e>p2");
 }
 
+void Edges::write(Section_Writer &w) const {
+  Entity::write(w, "edges");
+  IVSWRITE("edges", "m:e>p1");
+  IVSWRITE("edges", "m:e>p2");
+}
+
+void Edges::read(Section_Reader &r) {
+  Entity::read(r, "edges");
+  IVSREAD("edges", "m:e>p1");
+  IVSREAD("edges", "m:e>p2");
+}
+
 bool Edges::operator==(Edges const &rhs) const {
   return (Entity::operator==(rhs) && EQOP("m:e>p1") && EQOP("m:e>p2"));
 }
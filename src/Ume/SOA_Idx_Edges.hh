@@ -27,6 +27,8 @@ struct Edges : public Entity {
   explicit Edges(Mesh *mesh);
   void write(std::ostream &os) const override;
   void read(std::istream &is) override;
+  void write(Section_Writer &w) const override;
+  void read(Section_Reader &r) override;
   void resize(int const local, int const total, int const ghost) override;
   bool operator==(Edges const &rhs) const;
 
@@ -47,6 +47,18 @@ void Faces::read(std::istream &is) {
   IVREAD("m:f>z2");
 }
 
+void Faces::write(Section_Writer &w) const {
+  Entity::write(w, "faces");
+  IVSWRITE("faces", "m:f>z1");
+  IVSWRITE("faces", "m:f>z2");
+}
+
+void Faces::read(Section_Reader &r) {
+  Entity::read(r, "faces");
+  IVSREAD("faces", "m:f>z1");
+  IVSREAD("faces", "m:f>z2");
+}
+
 bool Faces::operator==(Faces const &rhs) const {
   return (Entity::operator==(rhs) && EQOP("m:f>z1") && EQOP("m:f>z2"));
 }
@@ -55,6 +55,24 @@ void Iotas::read(std::istream &is) {
   IVREAD("m:a>s");
 }
 
+void Iotas::write(Section_Writer &w) const {
+  Entity::write(w, "iotas");
+  IVSWRITE("iotas", "m:a>z");
+  IVSWRITE("iotas", "m:a>f");
+  IVSWRITE("iotas", "m:a>p");
+  IVSWRITE("iotas", "m:a>e");
+  IVSWRITE("iotas", "m:a>s");
+}
+
+void Iotas::read(Section_Reader &r) {
+  Entity::read(r, "iotas");
+  IVSREAD("iotas", "m:a>z");
+  IVSREAD("iotas", "m:a>f");
+  IVSREAD("iotas", "m:a>p");
+  IVSREAD("iotas", "m:a>e");
+  IVSREAD("iotas", "m:a>s");
+}
+
 bool Iotas::operator==(Iotas const &rhs) const {
   return (Entity::operator==(rhs) && EQOP("m:a>z") && EQOP("m:a>f") &&
       EQOP("m:a>p") && EQOP("m:a>e") && EQOP("m:a>s"));
@@ -31,6 +31,8 @@ struct Iotas : public Entity {
   explicit Iotas(Mesh *mesh);
   void write(std::ostream &os) const override;
   void read(std::istream &is) override;
+  void write(Section_Writer &w) const override;
+  void read(Section_Reader &r) override;
   void resize(int const local, int const total, int const ghost) override;
   bool operator==(Iotas const &rhs) const;
 };
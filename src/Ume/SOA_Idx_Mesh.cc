@@ -14,8 +14,16 @@
 */
 
 #include "Ume/SOA_Idx_Mesh.hh"
+#include "Ume/Timer.hh"
+#include "Ume/mapped_file.hh"
 #include "Ume/soa_idx_helpers.hh"
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
 #include <istream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <ostream>
 
 namespace Ume {
@@ -44,6 +52,10 @@ std::ostream &operator<<(std::ostream &os, Mesh::Geometry_Type const &geo) {
 
 void Mesh::write(std::ostream &os) const {
   write_bin(os, ivtag);
+  if (ivtag >= UME_VERSION_3) {
+    write_sections(os);
+    return;
+  }
   write_bin(os, mype);
   write_bin(os, numpe);
   write_bin(os, geo);
@@ -71,6 +83,12 @@ void Mesh::read(std::istream &is) {
   //
   // An alternative solution is to have a script to modify these
   // original binary ume files
+  if (ivtag == UME_VERSION_3) {
+    version_header = true;
+    Section_Reader r(is, sizeof(ivtag));
+    read_sections(r);
+    return;
+  }
   if (ivtag != UME_VERSION_1 && ivtag != UME_VERSION_2) {
     mype = ivtag;
     ivtag = UME_VERSION_1;
@@ -98,6 +116,121 @@ void Mesh::read(std::istream &is) {
     iotas.read(is);
 }
 
+/* The version 3 layout: the scalars in a "mesh" section, followed by the
+   entities in the same order as the older formats. */
+void Mesh::write_sections(std::ostream &os) const {
+  Section_Writer w;
+  w.compress = compress;
+  w.add_bytes("mesh", header_section());
+  points.write(w);
+  edges.write(w);
+  faces.write(w);
+  sides.write(w);
+  corners.write(w);
+  zones.write(w);
+  if (dump_iotas)
+    iotas.write(w);
+  w.write(os, sizeof(ivtag));
+}
+
+std::string Mesh::header_section() const {
+  std::ostringstream hdr;
+  write_bin(hdr, mype);
+  write_bin(hdr, numpe);
+  write_bin(hdr, geo);
+  write_bin(hdr, dump_iotas);
+  return hdr.str();
+}
+
+/* The entities in the order that they are written */
+std::vector<Entity *> Mesh::entities() {
+  std::vector<Entity *> list{
+      &points, &edges, &faces, &sides, &corners, &zones};
+  if (dump_iotas)
+    list.push_back(&iotas);
+  return list;
+}
+
+void Mesh::write_streaming(
+    std::ostream &os, std::function<void(Entity &)> const &load) {
+  /* The TOC has the same entries whatever the sizes of the arrays, so its
+     size is known before any of them are loaded */
+  Section_Writer layout;
+  layout.add_bytes("mesh", header_section());
+  for (Entity *e : entities())
+    e->write(layout);
+
+  write_bin(os, ivtag);
+  Section_Writer w;
+  w.compress = compress;
+  w.stream(os, sizeof(ivtag), layout.toc_bytes());
+  w.add_bytes("mesh", header_section());
+  for (Entity *e : entities()) {
+    load(*e);
+    e->write(w);
+    e->release();
+    ds->shrink_to_fit();
+  }
+  w.finish();
+}
+
+void Mesh::read_sections(Section_Reader &r) {
+  compress = false;
+  for (auto const &s : r.toc())
+    compress |= s.encoding != Section_Encoding::RAW;
+  std::istringstream hdr(r.read_bytes("mesh"));
+  read_bin(hdr, mype);
+  read_bin(hdr, numpe);
+  read_bin(hdr, geo);
+  read_bin(hdr, dump_iotas);
+  points.read(r);
+  edges.read(r);
+  faces.read(r);
+  sides.read(r);
+  corners.read(r);
+  zones.read(r);
+  if (dump_iotas)
+    iotas.read(r);
+}
+
+bool Mesh::read(std::string const &path, int num_threads) {
+  if (num_threads <= 0) {
+    char const *const env = std::getenv("UME_IO_THREADS");
+    num_threads = env ? std::atoi(env) : 4;
+  }
+  Timer timer;
+  timer.start();
+  std::ifstream is(path, std::ios::binary);
+  int const fd = ::open(path.c_str(), O_RDONLY);
+  if (!is || fd < 0) {
+    if (fd >= 0)
+      ::close(fd);
+    return false;
+  }
+  struct stat sb;
+  load_bytes = fstat(fd, &sb) == 0 ? static_cast<size_t>(sb.st_size) : 0;
+
+  int tag = 0;
+  read_bin(is, tag);
+  if (tag == UME_VERSION_3) {
+    ivtag = tag;
+    version_header = true;
+    /* The TOC and the small metadata sections come through the stream, and
+       the arrays are read in parallel by load() */
+    Section_Reader r(is, sizeof(ivtag), fd);
+    read_sections(r);
+    r.load(num_threads);
+  } else {
+    is.close();
+    Mapped_Istream ms(path);
+    read(ms);
+  }
+  ::close(fd);
+  timer.stop();
+  load_seconds = timer.seconds();
+  return true;
+}
+
 bool Mesh::operator==(Mesh const &rhs) const {
   return ivtag == rhs.ivtag && mype == rhs.mype && numpe == rhs.numpe &&
       geo == rhs.geo && dump_iotas == rhs.dump_iotas && points == rhs.points &&
@@ -119,6 +252,11 @@ void Mesh::print_stats(std::ostream &os) const {
   os << "\tFaces: " << faces.local_size() << '\n';
   os << "\tCorners: " << corners.local_size() << ' ' << corners.size() << '\n';
   os << "\tIotas: " << iotas.local_size() << ' ' << iotas.size() << '\n';
+  if (load_seconds > 0.0) {
+    double const gb = static_cast<double>(load_bytes) * 1e-9;
+    os << "\tLoad: " << gb << " GB in " << load_seconds << "s ("
+       << gb / load_seconds << " GB/s)\n";
+  }
 }
 
 } // namespace SOA_Idx
@@ -22,8 +22,11 @@
 
 /*! 1.0.0 release tag. */
 #define UME_VERSION_1 20230330
-/*! The latest input version tag. Inputs include iota information. */
+/*! Inputs include iota information. */
 #define UME_VERSION_2 20250722
+/*! The latest input version tag. Binary files have a table of contents and
+    64-byte-aligned array sections (see Ume/mesh_sections.hh). */
+#define UME_VERSION_3 20261018
 
 #include "Ume/Mesh_Base.hh"
 #include "Ume/SOA_Entity.hh"
@@ -34,7 +37,10 @@
 #include "Ume/SOA_Idx_Sides.hh"
 #include "Ume/SOA_Idx_Zones.hh"
 #include "Ume/SOA_Idx_Iotas.hh"
+#include <functional>
 #include <iosfwd>
+#include <string>
+#include <vector>
 
 namespace Ume {
 
@@ -59,12 +65,37 @@ struct Mesh : public Mesh_Base {
   Sides sides;
   Zones zones;
   Iotas iotas;
+  //! Compress the integer arrays when writing a UME_VERSION_3 file
+  /*! Set by read() if any array in the file was compressed. */
+  bool compress = false;
+  //! The size of the file read by read(path), in bytes
+  size_t load_bytes = 0;
+  //! The time taken by read(path), in seconds
+  double load_seconds = 0.0;
   Mesh();
   void write(std::ostream &os) const;
+  /*! Write the UME_VERSION_3 layout to a seekable stream one entity at a
+      time, so that only one entity's arrays need be in memory: `load(e)` is
+      called to fill entity `e` just before it is written, and it is
+      released (see Entity::release) just after.  The other
+      members must be set beforehand.  The file is the same as from write(). */
+  void write_streaming(
+      std::ostream &os, std::function<void(Entity &)> const &load);
   void read(std::istream &is);
+  /*! Read a mesh file.  The sections of a UME_VERSION_3 file are read
+      concurrently on num_threads threads (by default, the UME_IO_THREADS
+      environment variable, or 4); older files are read sequentially.  Returns
+      false if the file could not be opened. */
+  bool read(std::string const &path, int num_threads = 0);
   constexpr size_t ndims() const { return 3; }
   bool operator==(Mesh const &rhs) const;
   void print_stats(std::ostream &os) const;
+
+private:
+  void write_sections(std::ostream &os) const;
+  std::string header_section() const;
+  std::vector<Entity *> entities();
+  void read_sections(Section_Reader &r);
 };
 
 } // namespace SOA_Idx
@@ -46,6 +46,16 @@ void Points::read(std::istream &is) {
   read_bin(is, ds().access_vec3v("pcoord"));
 }
 
+void Points::write(Section_Writer &w) const {
+  Entity::write(w, "points");
+  w.add("points/pcoord", ds().caccess_vec3v("pcoord"));
+}
+
+void Points::read(Section_Reader &r) {
+  Entity::read(r, "points");
+  r.read("points/pcoord", ds().access_vec3v("pcoord"));
+}
+
 bool Points::operator==(Points const &rhs) const {
   return (Entity::operator==(rhs) &&
       ds().caccess_vec3v("pcoord") == rhs.ds().caccess_vec3v("pcoord"));
@@ -65,18 +75,13 @@ bool Points::VAR_point_to_zones::init_() const {
   auto const &c2p{caccess_intv("m:c>p")};
   auto &p2zs = mydata_intrr();
 
-  p2zs.init(pll);
-  std::vector<std::vector<int>> accum(pll);
-  for (int c = 0; c < cll; ++c) {
-    int const z = c2z[c];
-    int const p = c2p[c];
-    if (p < pll && z < zll) // Some c2z values are bad at ghost corners
-      accum.at(p).push_back(z);
-  }
-  for (int p = 0; p < pll; ++p) {
-    std::sort(accum[p].begin(), accum[p].end());
-    p2zs.assign(p, accum[p].begin(), accum[p].end());
-  }
+  invert_map(
+      p2zs, pll, cll,
+      [&](const int c) {
+        // Some c2z values are bad at ghost corners
+        return (c2p[c] < pll && c2z[c] < zll) ? c2p[c] : -1;
+      },
+      [&](const int c) { return c2z[c]; });
 
   VAR_INIT_EPILOGUE;
 }
@@ -145,17 +150,10 @@ bool Points::VAR_point_to_real_corners::init_() const {
   auto const &cmask{corners().mask};
   auto &p2rc = mydata_intrr();
 
-  p2rc.init(pll);
-  std::vector<std::vector<int>> accum(pll);
-  for (int c = 0; c < cl; ++c) {
-    if (cmask[c] < 1)
-      continue; // only take non-ghost/non-boundary corners
-    int const p = c2p[c];
-    accum.at(p).push_back(c);
-  }
-  for (int p = 0; p < pll; ++p) {
-    p2rc.assign(p, accum[p].begin(), accum[p].end());
-  }
+  /* Only take non-ghost/non-boundary corners */
+  invert_map(
+      p2rc, pll, cl, [&](const int c) { return cmask[c] < 1 ? -1 : c2p[c]; },
+      [](const int c) { return c; });
   VAR_INIT_EPILOGUE;
 }
 
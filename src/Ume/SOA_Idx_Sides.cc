@@ -79,6 +79,36 @@ void Sides::read(std::istream &is) {
   IVREAD("m:s>s5");
 }
 
+void Sides::write(Section_Writer &w) const {
+  Entity::write(w, "sides");
+  IVSWRITE("sides", "m:s>z");
+  IVSWRITE("sides", "m:s>p1");
+  IVSWRITE("sides", "m:s>p2");
+  IVSWRITE("sides", "m:s>e");
+  IVSWRITE("sides", "m:s>f");
+  IVSWRITE("sides", "m:s>c1");
+  IVSWRITE("sides", "m:s>c2");
+  IVSWRITE("sides", "m:s>s2");
+  IVSWRITE("sides", "m:s>s3");
+  IVSWRITE("sides", "m:s>s4");
+  IVSWRITE("sides", "m:s>s5");
+}
+
+void Sides::read(Section_Reader &r) {
+  Entity::read(r, "sides");
+  IVSREAD("sides", "m:s>z");
+  IVSREAD("sides", "m:s>p1");
+  IVSREAD("sides", "m:s>p2");
+  IVSREAD("sides", "m:s>e");
+  IVSREAD("sides", "m:s>f");
+  IVSREAD("sides", "m:s>c1");
+  IVSREAD("sides", "m:s>c2");
+  IVSREAD("sides", "m:s>s2");
+  IVSREAD("sides", "m:s>s3");
+  IVSREAD("sides", "m:s>s4");
+  IVSREAD("sides", "m:s>s5");
+}
+
 bool Sides::operator==(Sides const &rhs) const {
   return (Entity::operator==(rhs) && EQOP("m:s>z") && EQOP("m:s>p1") &&
       EQOP("m:s>p2") && EQOP("m:s>e") && EQOP("m:s>f") && EQOP("m:s>c1") &&
@@ -16,7 +16,7 @@
 #include "Ume/SOA_Idx_Mesh.hh"
 #include "Ume/soa_idx_helpers.hh"
 #include "Ume/mem_exec_spaces.hh"
-#include <set>
+#include <algorithm>
 
 namespace Ume {
 namespace SOA_Idx {
@@ -42,6 +42,14 @@ void Zones::read(std::istream &is) {
   Entity::read(is);
 }
 
+void Zones::write(Section_Writer &w) const {
+  Entity::write(w, "zones");
+}
+
+void Zones::read(Section_Reader &r) {
+  Entity::read(r, "zones");
+}
+
 bool Zones::operator==(Zones const &rhs) const {
   return (Entity::operator==(rhs));
 }
@@ -114,22 +122,61 @@ bool Zones::VAR_zone_to_pt_zone::init_() const {
   auto const &c2p{caccess_intv("m:c>p")};
   auto const &c2z{caccess_intv("m:c>z")};
   auto &z2pz = mydata_intrr();
-  z2pz.init(zll);
-  std::vector<std::set<int>> accum(zll);
-
-  /* Iterate over corners, add all zones attached to c2p[c] to c2z[z]; */
-  for (int c = 0; c < cll; ++c) {
-    int const p = c2p[c];
-    int const z = c2z[c];
-    if (p < pll && z < zll)
-      accum.at(z).insert(p2zs[p].begin(), p2zs[p].end());
-  }
-
-  /* Fill the ragged-right arrays, eliminating zone self-links */
-  for (int z = 0; z < zll; ++z) {
-    accum[z].erase(z);
-    z2pz.assign(z, accum[z].begin(), accum[z].end());
-  }
+  auto valid = [&](const int c) { return c2p[c] < pll && c2z[c] < zll; };
+
+  /* Iterate over corners, gathering all zones attached to c2p[c] into a
+     candidate list for c2z[c] (with duplicates).  This is a count/scan/fill,
+     like invert_map(). */
+  std::vector<int> counts(zll, 0);
+  Kokkos::View<int *, HostSpace> h_counts(counts.data(), counts.size());
+  Kokkos::parallel_for("zone_to_pt_zone-count",
+      Kokkos::RangePolicy<HostExecSpace>(0, cll), [&](const int c) {
+        if (valid(c)) {
+#if defined(UME_SERIAL)
+          h_counts(c2z[c]) += p2zs.size(c2p[c]);
+#else
+          Kokkos::atomic_add(&h_counts(c2z[c]), p2zs.size(c2p[c]));
+#endif
+        }
+      });
+
+  RaggedRight<int> candidates;
+  candidates.init_from_counts(counts);
+  auto const offsets = candidates.row_offsets();
+  std::copy(offsets.begin(), offsets.end() - 1, counts.begin());
+  auto const values = candidates.values();
+  Kokkos::parallel_for("zone_to_pt_zone-fill",
+      Kokkos::RangePolicy<HostExecSpace>(0, cll), [&](const int c) {
+        if (valid(c)) {
+          auto const zs = p2zs[c2p[c]];
+          int const len = static_cast<int>(zs.size());
+#if defined(UME_SERIAL)
+          int const slot = h_counts(c2z[c]);
+          h_counts(c2z[c]) += len;
+#else
+          int const slot = Kokkos::atomic_fetch_add(&h_counts(c2z[c]), len);
+#endif
+          std::copy(zs.begin(), zs.end(), values.begin() + slot);
+        }
+      });
+
+  /* Sort and unique each candidate list, eliminating zone self-links */
+  Kokkos::parallel_for("zone_to_pt_zone-unique",
+      Kokkos::RangePolicy<HostExecSpace>(0, zll), [&](const int z) {
+        auto row = candidates[z];
+        std::sort(row.begin(), row.end());
+        auto last = std::unique(row.begin(), row.end());
+        last = std::remove(row.begin(), last, z);
+        h_counts(z) = static_cast<int>(last - row.begin());
+      });
+
+  /* Fill the ragged-right arrays */
+  z2pz.init_from_counts(counts);
+  Kokkos::parallel_for("zone_to_pt_zone-copy",
+      Kokkos::RangePolicy<HostExecSpace>(0, zll), [&](const int z) {
+        auto const row = candidates[z];
+        std::copy_n(row.begin(), z2pz.size(z), z2pz[z].begin());
+      });
   VAR_INIT_EPILOGUE;
 }
 
@@ -141,22 +188,11 @@ bool Zones::VAR_zone_to_points::init_() const {
   auto const &c2p{caccess_intv("m:c>p")};
   auto const &c2z{caccess_intv("m:c>z")};
   auto &z2p = mydata_intrr();
-  z2p.init(zll);
-  std::vector<std::vector<int>> accum(zll);
-
   /* Iterate over corners, connect points to zones */
-  for (int c = 0; c < cll; ++c) {
-    int const p = c2p[c];
-    int const z = c2z[c];
-    if (p < pll && z < zll)
-      accum.at(z).push_back(p);
-  }
-
-  /* Fill the ragged-right arrays*/
-  for (int z = 0; z < zll; ++z) {
-    std::sort(accum[z].begin(), accum[z].end());
-    z2p.assign(z, accum[z].begin(), accum[z].end());
-  }
+  invert_map(
+      z2p, zll, cll,
+      [&](const int c) { return (c2p[c] < pll && c2z[c] < zll) ? c2z[c] : -1; },
+      [&](const int c) { return c2p[c]; });
   VAR_INIT_EPILOGUE;
 }
 
@@ -166,24 +202,12 @@ bool Zones::VAR_zone_to_corners::init_() const {
   int const cll = corners().size();
   auto const &c2z{caccess_intv("m:c>z")};
   auto &z2c = mydata_intrr();
-  z2c.init(zll);
-  std::vector<std::vector<int>> accum(zll);
-
-  /* Iterate over corners, connect points to zones */
-  for (int c = 0; c < cll; ++c) {
-    int const z = c2z[c];
-    if (z < zll)
-      accum.at(z).push_back(c);
-  }
-
-  /* Fill the ragged-right arrays*/
-  for (int z = 0; z < zll; ++z) {
-    /* It is perhaps tempting to sort the corner indices accum[z] here to take
-       better advantage of cache reuse, but leaving them in the original order
-       replicates the summation pattern found when using a c->z loop. */
-    //    std::sort(accum[z].begin(), accum[z].end());
-    z2c.assign(z, accum[z].begin(), accum[z].end());
-  }
+  /* Iterate over corners, connect corners to zones.  Each row ends up in
+     increasing corner order, which replicates the summation pattern found when
+     using a c->z loop. */
+  invert_map(
+      z2c, zll, cll, [&](const int c) { return c2z[c] < zll ? c2z[c] : -1; },
+      [](const int c) { return c; });
   VAR_INIT_EPILOGUE;
 }
 
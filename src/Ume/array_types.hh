@@ -53,6 +53,22 @@ inline auto NewArrayRank1(const std::string &name, const int dim0,
     return SArrayRank1<T>(name, static_cast<size_t>(dim0));
 };
 
+/* A rank 1 scratch array for library kernels, which must also work when
+ * Ume::initialize has not enabled the memory pool.  `view` is in the pool
+ * when it is enabled, with `claim` holding that memory, and is otherwise a
+ * Kokkos managed view. */
+template <typename T> struct ScratchArrayRank1 {
+  ScratchArrayRank1(const std::string &name, const int dim0)
+      : claim{NewArrayRank1<T>(
+            name, GetMemPool().IsPoolEnabled() ? dim0 : 0)},
+        view{GetMemPool().IsPoolEnabled()
+                ? SArrayRank1<T>(claim.data(), static_cast<size_t>(dim0))
+                : SArrayRank1<T>(name, static_cast<size_t>(dim0))} {}
+
+  decltype(NewArrayRank1<T>(std::string{}, 0)) claim;
+  SArrayRank1<T> view;
+};
+
 template <typename T, bool useMemPool = true,
           typename CopyOpt = MemOpts::CopyInit>
 inline auto NewArrayRank2(const std::string &name, const int dim0,
@@ -0,0 +1,145 @@
+/*
+  Copyright (c) 2023, Triad National Security, LLC. All rights reserved.
+
+  This is open source software; you can redistribute it and/or modify it under
+  the terms of the BSD-3 License. If software is modified to produce derivative
+  works, such modified software should be clearly marked, so as not to confuse
+  it with the version available from LANL. Full text of the BSD-3 License can be
+  found in the LICENSE.md file, and the full assertion of copyright in the
+  NOTICE.md file.
+*/
+
+/*!
+\file Ume/checksum.cc
+*/
+
+#include "Ume/checksum.hh"
+#include <algorithm>
+#include <cstring>
+
+namespace Ume {
+
+namespace {
+
+constexpr uint64_t P1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t P3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t P5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t const x, int const r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t read64(unsigned char const *const p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t read32(unsigned char const *const p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint64_t round(uint64_t acc, uint64_t const input) {
+  acc += input * P2;
+  acc = rotl(acc, 31);
+  return acc * P1;
+}
+
+inline uint64_t merge_round(uint64_t acc, uint64_t const val) {
+  acc ^= round(0, val);
+  return acc * P1 + P4;
+}
+
+/* Consume whole 32-byte stripes; returns the number of bytes consumed */
+inline size_t stripes(
+    uint64_t v[4], unsigned char const *const p, size_t const num_bytes) {
+  size_t i = 0;
+  for (; i + 32 <= num_bytes; i += 32) {
+    v[0] = round(v[0], read64(p + i));
+    v[1] = round(v[1], read64(p + i + 8));
+    v[2] = round(v[2], read64(p + i + 16));
+    v[3] = round(v[3], read64(p + i + 24));
+  }
+  return i;
+}
+
+} // namespace
+
+void Checksum::reset(uint64_t const seed) {
+  seed_ = seed;
+  v_[0] = seed + P1 + P2;
+  v_[1] = seed + P2;
+  v_[2] = seed;
+  v_[3] = seed - P1;
+  total_ = 0;
+  buf_len_ = 0;
+}
+
+void Checksum::update(void const *const data, size_t num_bytes) {
+  if (num_bytes == 0)
+    return;
+  auto p = static_cast<unsigned char const *>(data);
+  total_ += num_bytes;
+  if (buf_len_ > 0) {
+    size_t const fill = std::min(num_bytes, sizeof(buf_) - buf_len_);
+    std::memcpy(buf_ + buf_len_, p, fill);
+    buf_len_ += fill;
+    p += fill;
+    num_bytes -= fill;
+    if (buf_len_ < sizeof(buf_))
+      return;
+    stripes(v_, buf_, sizeof(buf_));
+    buf_len_ = 0;
+  }
+  size_t const done = stripes(v_, p, num_bytes);
+  buf_len_ = num_bytes - done;
+  std::memcpy(buf_, p + done, buf_len_);
+}
+
+uint64_t Checksum::value() const {
+  uint64_t h;
+  if (total_ >= 32) {
+    h = rotl(v_[0], 1) + rotl(v_[1], 7) + rotl(v_[2], 12) + rotl(v_[3], 18);
+    for (int i = 0; i < 4; ++i)
+      h = merge_round(h, v_[i]);
+  } else {
+    h = seed_ + P5;
+  }
+  h += total_;
+
+  unsigned char const *p = buf_;
+  unsigned char const *const end = buf_ + buf_len_;
+  for (; p + 8 <= end; p += 8) {
+    h ^= round(0, read64(p));
+    h = rotl(h, 27) * P1 + P4;
+  }
+  if (p + 4 <= end) {
+    h ^= static_cast<uint64_t>(read32(p)) * P1;
+    h = rotl(h, 23) * P2 + P3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    h ^= *p * P5;
+    h = rotl(h, 11) * P1;
+  }
+
+  h ^= h >> 33;
+  h *= P2;
+  h ^= h >> 29;
+  h *= P3;
+  h ^= h >> 32;
+  return h;
+}
+
+uint64_t checksum64(
+    void const *const data, size_t const num_bytes, uint64_t const seed) {
+  Checksum c(seed);
+  c.update(data, num_bytes);
+  return c.value();
+}
+
+} // namespace Ume
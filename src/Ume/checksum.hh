@@ -0,0 +1,50 @@
+/*
+  Copyright (c) 2023, Triad National Security, LLC. All rights reserved.
+
+  This is open source software; you can redistribute it and/or modify it under
+  the terms of the BSD-3 License. If software is modified to produce derivative
+  works, such modified software should be clearly marked, so as not to confuse
+  it with the version available from LANL. Full text of the BSD-3 License can be
+  found in the LICENSE.md file, and the full assertion of copyright in the
+  NOTICE.md file.
+*/
+
+/*!
+\file Ume/checksum.hh
+
+A fast, non-cryptographic 64-bit checksum (XXH64) for file payloads.
+*/
+
+#ifndef UME_CHECKSUM_HH
+#define UME_CHECKSUM_HH 1
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Ume {
+
+//! Incremental XXH64 checksum
+/*! Feeding the same bytes through any sequence of update() calls gives the
+    same value() as a single call to checksum64().  The result matches the
+    reference XXH64 implementation. */
+class Checksum {
+public:
+  explicit Checksum(uint64_t seed = 0) { reset(seed); }
+  void reset(uint64_t seed = 0);
+  void update(void const *data, size_t num_bytes);
+  uint64_t value() const;
+
+private:
+  uint64_t v_[4];
+  uint64_t seed_;
+  uint64_t total_;
+  unsigned char buf_[32];
+  size_t buf_len_;
+};
+
+//! The XXH64 checksum of a block of memory
+uint64_t checksum64(void const *data, size_t num_bytes, uint64_t seed = 0);
+
+} // namespace Ume
+
+#endif
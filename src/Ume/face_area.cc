@@ -14,6 +14,7 @@
 */
 
 #include "Ume/face_area.hh"
+#include "Ume/array_types.hh"
 #include "Ume/mem_exec_spaces.hh"
 
 namespace Ume {
@@ -34,7 +35,13 @@ void calc_face_area(Mesh &mesh, DBLV_T &face_area) {
   int const sl = mesh.sides.local_size();
 
   std::fill(face_area.begin(), face_area.end(), 0.0);
-  INTV_T side_tag(sll, 0);
+
+  /* The side tags are only needed on the device, so they come from the
+     memory pool (when there is one) rather than a fresh host vector and
+     mirror on each call */
+  ScratchScope<> scratch(sll * sizeof(int));
+  ScratchArrayRank1<int> side_tag("side_tag", sll);
+  auto d_side_tag = side_tag.view;
 
   Kokkos::View<double *, HostSpace> h_face_area(
       &face_area[0], face_area.size());
@@ -43,7 +50,6 @@ void calc_face_area(Mesh &mesh, DBLV_T &face_area) {
   Kokkos::View<const int *, HostSpace> h_s_to_s2_map(
       &s_to_s2_map[0], s_to_s2_map.size());
   Kokkos::View<const Vec3 *, HostSpace> h_surz(&surz[0], surz.size());
-  Kokkos::View<int *, HostSpace> h_side_tag(&side_tag[0], side_tag.size());
   Kokkos::View<const short *, HostSpace> h_side_type(
       &side_type[0], side_type.size());
   Kokkos::View<const int *, HostSpace> h_face_comm_type(
@@ -53,7 +59,6 @@ void calc_face_area(Mesh &mesh, DBLV_T &face_area) {
   auto d_s_to_f_map = create_mirror_view(DevExecMemSpace(), h_s_to_f_map);
   auto d_s_to_s2_map = create_mirror_view(DevExecMemSpace(), h_s_to_s2_map);
   auto d_surz = create_mirror_view(DevExecMemSpace(), h_surz);
-  auto d_side_tag = create_mirror_view(DevExecMemSpace(), h_side_tag);
   auto d_side_type = create_mirror_view(DevExecMemSpace(), h_side_type);
   auto d_face_comm_type =
       create_mirror_view(DevExecMemSpace(), h_face_comm_type);
@@ -65,7 +70,6 @@ void calc_face_area(Mesh &mesh, DBLV_T &face_area) {
   Kokkos::deep_copy(d_s_to_f_map, h_s_to_f_map);
   Kokkos::deep_copy(d_s_to_s2_map, h_s_to_s2_map);
   Kokkos::deep_copy(d_surz, h_surz);
-  Kokkos::deep_copy(d_side_tag, h_side_tag);
   Kokkos::deep_copy(d_side_type, h_side_type);
   Kokkos::deep_copy(d_face_comm_type, h_face_comm_type);
 #endif
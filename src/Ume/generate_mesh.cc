@@ -0,0 +1,895 @@
+/*
+  Copyright (c) 2023, Triad National Security, LLC. All rights reserved.
+
+  This is open source software; you can redistribute it and/or modify it under
+  the terms of the BSD-3 License. If software is modified to produce derivative
+  works, such modified software should be clearly marked, so as not to confuse
+  it with the version available from LANL. Full text of the BSD-3 License can be
+  found in the LICENSE.md file, and the full assertion of copyright in the
+  NOTICE.md file.
+*/
+
+/*!
+\file Ume/generate_mesh.cc
+
+Every entity is identified by lattice coordinates.  A point set (a point, an
+edge or a face) is a type, giving the offsets of its points, and a base point.
+Each rank numbers the point sets that lie in its closed box of points first,
+type by type and then by base point, and then the ghosts, in global id order.
+Zones are numbered by cell, and their sides, corners and iotas follow the
+zone.  Since local numbers are closed-form, every rank can compute the index
+of a ghost's source on its owner without communicating.  The owner of a
+shared point set is the lowest rank that has it in its box.
+*/
+
+#include "Ume/generate_mesh.hh"
+#include "Ume/mem_exec_spaces.hh"
+#include "Ume/process_mgmt.hh"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <climits>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace Ume {
+
+namespace {
+
+using Ijk = std::array<int, 3>;
+using Entity = SOA_Idx::Entity;
+using Mesh = SOA_Idx::Mesh;
+
+/* Points within a cell are given as bit sets of their offsets from the cell's
+   lowest corner: x + 2y + 4z */
+inline Ijk offset(Ijk const &base, int const bits) {
+  return {base[0] + (bits & 1), base[1] + (bits >> 1 & 1),
+      base[2] + (bits >> 2 & 1)};
+}
+
+inline bool spans(int const span, int const d) { return span >> d & 1; }
+
+/* ------------------------------ Lattice types ----------------------------- */
+
+/* A kind of point set: its points are the base point plus each offset */
+struct Lattice_Type {
+  int span; //!< The bits of the dimensions that the points spread across
+  std::vector<int> pts; //!< Edges have two points, faces list theirs in order
+};
+using Lattice_Types = std::vector<Lattice_Type>;
+
+Lattice_Types point_types() { return {{0, {0}}}; }
+
+Lattice_Types edge_types(Mesh_Spec::Shape const shape) {
+  Lattice_Types types;
+  for (int span = 1; span < 8; ++span)
+    if (shape == Mesh_Spec::TET || std::has_single_bit(unsigned(span)))
+      types.push_back({span, {0, span}});
+  return types;
+}
+
+Lattice_Types face_types(Mesh_Spec::Shape const shape) {
+  Lattice_Types types;
+  if (shape == Mesh_Spec::HEX) {
+    for (int const span : {3, 5, 6}) {
+      int const a = span & -span;
+      types.push_back({span, {0, a, span, span ^ a}});
+    }
+  } else {
+    /* The triangles of the cube's diagonal chains */
+    for (int a = 1; a < 8; ++a)
+      for (int b = 1; b < 8; ++b)
+        if ((a & b) == 0)
+          types.push_back({a | b, {0, a, a | b}});
+  }
+  return types;
+}
+
+/* The type of a point set within a cell, and its base as a bit set */
+std::pair<int, int> find_type(
+    Lattice_Types const &types, std::vector<int> pts) {
+  int base = 7;
+  for (int const p : pts)
+    base &= p;
+  for (int &p : pts)
+    p ^= base;
+  std::sort(pts.begin(), pts.end());
+  for (size_t t = 0; t < types.size(); ++t) {
+    std::vector<int> tpts{types[t].pts};
+    std::sort(tpts.begin(), tpts.end());
+    if (tpts == pts)
+      return {static_cast<int>(t), base};
+  }
+  error_stop("generate_mesh: unknown lattice type");
+  return {-1, 0};
+}
+
+/* ------------------------------- Numbering ------------------------------- */
+
+/* Number the point sets of each type that lie in a box of points, type by
+   type, and then by base point with x fastest */
+class Box_Numbering {
+public:
+  Box_Numbering() = default;
+  Box_Numbering(Lattice_Types const &types, Ijk const &lo, Ijk const &hi)
+      : lo_{lo} {
+    first_.push_back(0);
+    for (auto const &type : types) {
+      Ijk w;
+      for (int d = 0; d < 3; ++d)
+        w[d] = std::max(0, hi[d] - lo[d] + 1 - spans(type.span, d));
+      width_.push_back(w);
+      first_.push_back(first_.back() + w[0] * w[1] * w[2]);
+    }
+  }
+  int size() const { return first_.back(); }
+  bool contains(int const t, Ijk const &b) const {
+    for (int d = 0; d < 3; ++d)
+      if (b[d] < lo_[d] || b[d] - lo_[d] >= width_[t][d])
+        return false;
+    return true;
+  }
+  int index(int const t, Ijk const &b) const {
+    Ijk const &w = width_[t];
+    return first_[t] + (b[0] - lo_[0]) +
+        w[0] * ((b[1] - lo_[1]) + w[1] * (b[2] - lo_[2]));
+  }
+  void decode(int i, int &t, Ijk &b) const {
+    t = static_cast<int>(
+        std::upper_bound(first_.begin(), first_.end(), i) - first_.begin() - 1);
+    i -= first_[t];
+    Ijk const &w = width_[t];
+    b = {lo_[0] + i % w[0], lo_[1] + i / w[0] % w[1],
+        lo_[2] + i / (w[0] * w[1])};
+  }
+
+private:
+  Ijk lo_{};
+  std::vector<Ijk> width_;
+  std::vector<int> first_;
+};
+
+/* Global ids: by base point, x fastest, and then by type */
+struct Global_Ids {
+  Ijk n; //!< Lattice points in each dimension
+  long num_types;
+  long id(int const t, Ijk const &b) const {
+    return (b[0] + n[0] * (b[1] + long(n[1]) * b[2])) * num_types + t;
+  }
+  void decode(long const id, int &t, Ijk &b) const {
+    t = static_cast<int>(id % num_types);
+    long const p = id / num_types;
+    b = {static_cast<int>(p % n[0]), static_cast<int>(p / n[0] % n[1]),
+        static_cast<int>(p / (long(n[0]) * n[1]))};
+  }
+};
+
+/* A rank's numbering of the point sets that it holds: those in its box, and
+   then its ghosts in global id order */
+struct Lattice_Numbering {
+  Lattice_Types types;
+  Global_Ids ids;
+  Box_Numbering local;
+  std::vector<long> ghosts;
+
+  int local_size() const { return local.size(); }
+  int size() const { return local.size() + static_cast<int>(ghosts.size()); }
+  int index(int const t, Ijk const &b) const {
+    if (local.contains(t, b))
+      return local.index(t, b);
+    auto const g =
+        std::lower_bound(ghosts.begin(), ghosts.end(), ids.id(t, b));
+    assert(g != ghosts.end() && *g == ids.id(t, b));
+    return local.size() + static_cast<int>(g - ghosts.begin());
+  }
+  void decode(int const i, int &t, Ijk &b) const {
+    if (i < local.size())
+      local.decode(i, t, b);
+    else
+      ids.decode(ghosts[i - local.size()], t, b);
+  }
+};
+
+/* ----------------------------- Decomposition ----------------------------- */
+
+//! Up to five ranks in each dimension can hold a point set
+struct Rank_List {
+  int n = 0;
+  std::array<int, 125> pe;
+};
+
+/* The block decomposition of the cells among the ranks */
+struct Decomposition {
+  Ijk cells;
+  Ijk ranks;
+
+  //! The first cell of block q in dimension d
+  int first(int const d, int const q) const {
+    return static_cast<int>(long(q) * cells[d] / ranks[d]);
+  }
+  //! The block holding cell x (the last block for the last point)
+  int block(int const d, int const x) const {
+    int q = std::min(
+        ranks[d] - 1, static_cast<int>(long(x) * ranks[d] / cells[d]));
+    while (q > 0 && first(d, q) > x)
+      --q;
+    while (q + 1 < ranks[d] && first(d, q + 1) <= x)
+      ++q;
+    return q;
+  }
+  Ijk coords(int const pe) const {
+    return {
+        pe % ranks[0], pe / ranks[0] % ranks[1], pe / (ranks[0] * ranks[1])};
+  }
+  int rank(Ijk const &q) const {
+    return q[0] + ranks[0] * (q[1] + ranks[1] * q[2]);
+  }
+
+  //! Rank pe's cells, inclusive, optionally with its layer of ghost cells
+  void cell_box(int const pe, bool const ghosts, Ijk &lo, Ijk &hi) const {
+    Ijk const q = coords(pe);
+    for (int d = 0; d < 3; ++d) {
+      lo[d] = first(d, q[d]);
+      hi[d] = first(d, q[d] + 1) - 1;
+      if (ghosts) {
+        lo[d] = std::max(0, lo[d] - 1);
+        hi[d] = std::min(cells[d] - 1, hi[d] + 1);
+      }
+    }
+  }
+  //! The points of those cells
+  void point_box(int const pe, bool const ghosts, Ijk &lo, Ijk &hi) const {
+    cell_box(pe, ghosts, lo, hi);
+    for (int d = 0; d < 3; ++d)
+      ++hi[d];
+  }
+
+  //! The lowest rank with the point set in its box of points
+  int owner(int const span, Ijk const &b) const {
+    Ijk q;
+    for (int d = 0; d < 3; ++d) {
+      q[d] = block(d, b[d]);
+      if (!spans(span, d) && q[d] > 0 && b[d] == first(d, q[d]))
+        --q[d];
+    }
+    return rank(q);
+  }
+  //! The rank with the cell
+  int cell_owner(Ijk const &c) const {
+    return rank({block(0, c[0]), block(1, c[1]), block(2, c[2])});
+  }
+
+  //! The ranks that hold the point set, as a local entity or a ghost
+  Rank_List holders(int const span, Ijk const &b) const {
+    return holders_if([&](int const d, int const q) {
+      return std::max(0, first(d, q) - 1) <= b[d] &&
+          b[d] + spans(span, d) <= std::min(cells[d], first(d, q + 1) + 1);
+    }, b);
+  }
+  //! The ranks that hold the cell
+  Rank_List cell_holders(Ijk const &c) const {
+    return holders_if([&](int const d, int const q) {
+      return std::max(0, first(d, q) - 1) <= c[d] &&
+          c[d] <= std::min(cells[d] - 1, first(d, q + 1));
+    }, c);
+  }
+
+private:
+  template <class F> Rank_List holders_if(F const &holds, Ijk const &x) const {
+    std::array<std::array<int, 5>, 3> qs;
+    Ijk nq{0, 0, 0};
+    for (int d = 0; d < 3; ++d) {
+      int const q0 = block(d, x[d]);
+      int const q1 = std::min(ranks[d] - 1, q0 + 2);
+      for (int q = std::max(0, q0 - 2); q <= q1; ++q)
+        if (holds(d, q))
+          qs[d][nq[d]++] = q;
+    }
+    Rank_List r;
+    for (int k = 0; k < nq[2]; ++k)
+      for (int j = 0; j < nq[1]; ++j)
+        for (int i = 0; i < nq[0]; ++i)
+          r.pe[r.n++] = rank({qs[0][i], qs[1][j], qs[2][k]});
+    return r;
+  }
+};
+
+/* ----------------------------- Zone templates ---------------------------- */
+
+/* A zone of a cell, with its corners, faces and sides in the order that they
+   are numbered */
+struct Zone_Template {
+  //! The zone's points (one corner each), as offsets in the cell
+  std::vector<int> pts;
+  struct Face {
+    int type;
+    int base;
+    //! The face's points, as indices into pts, in side order
+    std::vector<int> loop;
+    int first_side;
+  };
+  std::vector<Face> faces;
+  //! A side per face edge; p1 and p2 index pts, and s3-s5 are template sides
+  struct Side {
+    int face, edge_type, edge_base, p1, p2, s3, s4, s5;
+  };
+  std::vector<Side> sides;
+};
+
+Zone_Template make_zone(std::vector<int> const &pts,
+    std::vector<std::vector<int>> loops, Lattice_Types const &etypes,
+    Lattice_Types const &ftypes) {
+  auto const coord = [&](int const i) {
+    Ijk const p = offset({0, 0, 0}, pts[i]);
+    return Vec3{{double(p[0]), double(p[1]), double(p[2])}};
+  };
+  Vec3 zc(0.0);
+  for (size_t i = 0; i < pts.size(); ++i)
+    zc += coord(static_cast<int>(i));
+  zc /= static_cast<double>(pts.size());
+
+  Zone_Template z;
+  z.pts = pts;
+  for (auto &loop : loops) {
+    int const len = static_cast<int>(loop.size());
+    std::vector<int> face_pts;
+    Vec3 fc(0.0);
+    for (int const i : loop) {
+      face_pts.push_back(pts[i]);
+      fc += coord(i);
+    }
+    fc /= static_cast<double>(len);
+    /* Order the loop so that the side volumes (see Sides::calc_side_vol) are
+       positive */
+    if (dotprod(fc - zc,
+            crossprod(coord(loop[1]) - zc, coord(loop[0]) - zc)) < 0.0)
+      std::reverse(loop.begin(), loop.end());
+
+    auto const [type, base] = find_type(ftypes, face_pts);
+    int const first = static_cast<int>(z.sides.size());
+    z.faces.push_back({type, base, loop, first});
+    for (int k = 0; k < len; ++k) {
+      int const p1 = loop[k];
+      int const p2 = loop[(k + 1) % len];
+      auto const [etype, ebase] = find_type(etypes, {pts[p1], pts[p2]});
+      z.sides.push_back({static_cast<int>(z.faces.size()) - 1, etype, ebase, p1,
+          p2, -1, first + (k + 1) % len, first + (k + len - 1) % len});
+    }
+  }
+  /* s3 is the zone's other side on the same edge */
+  for (auto &s : z.sides)
+    for (size_t j = 0; j < z.sides.size(); ++j)
+      if (z.sides[j].face != s.face && z.sides[j].edge_type == s.edge_type &&
+          z.sides[j].edge_base == s.edge_base)
+        s.s3 = static_cast<int>(j);
+  return z;
+}
+
+std::vector<Zone_Template> zone_templates(Mesh_Spec::Shape const shape,
+    Lattice_Types const &etypes, Lattice_Types const &ftypes) {
+  std::vector<Zone_Template> zones;
+  if (shape == Mesh_Spec::HEX) {
+    zones.push_back(make_zone({0, 1, 2, 3, 4, 5, 6, 7},
+        {{0, 2, 6, 4}, {1, 3, 7, 5}, {0, 1, 5, 4}, {2, 3, 7, 6}, {0, 1, 3, 2},
+            {4, 5, 7, 6}},
+        etypes, ftypes));
+  } else {
+    /* The six tets along the paths from the lowest corner to the highest */
+    int perm[3] = {1, 2, 4};
+    do {
+      std::vector<int> const pts{0, perm[0], perm[0] | perm[1], 7};
+      zones.push_back(make_zone(pts,
+          {{1, 2, 3}, {0, 2, 3}, {0, 1, 3}, {0, 1, 2}}, etypes, ftypes));
+    } while (std::next_permutation(perm, perm + 3));
+  }
+  return zones;
+}
+
+/* ----------------------------- Communication ----------------------------- */
+
+/* Collect neighbor lists keyed by global id, so that both ends of each
+   exchange order their elements the same way */
+class Neighbor_Lists {
+public:
+  void add(int const pe, long const id, int const i) {
+    lists_[pe].emplace_back(id, i);
+  }
+  Comm::Neighbors finish() {
+    Comm::Neighbors neighbors;
+    for (auto &[pe, list] : lists_) {
+      std::sort(list.begin(), list.end());
+      neighbors.push_back({pe, {}});
+      for (auto const &e : list)
+        neighbors.back().elements.push_back(e.second);
+    }
+    return neighbors;
+  }
+
+private:
+  std::map<int, std::vector<std::pair<long, int>>> lists_;
+};
+
+/* Set a ghost's table entry, and list it with the other copies of its
+   owner's entities */
+inline void add_ghost(Entity &e, Neighbor_Lists &cpys, int const i,
+    long const id, int const owner, int const owner_idx) {
+  int const g = i - e.local_size();
+  e.comm_type[i] = Entity::GHOST;
+  e.cpy_idx[g] = i;
+  e.src_pe[g] = owner;
+  e.src_idx[g] = owner_idx;
+  e.ghost_mask[g] = 1;
+  cpys.add(owner, id, i);
+}
+
+/* The communication data of points, edges or faces */
+void lattice_comm(Entity &e, Lattice_Numbering const &num,
+    Decomposition const &dec, int const mype) {
+  Neighbor_Lists cpys, srcs;
+  std::map<int, Box_Numbering> owner_boxes;
+  for (int i = 0; i < num.size(); ++i) {
+    int t;
+    Ijk b;
+    num.decode(i, t, b);
+    int const span = num.types[t].span;
+    long const id = num.ids.id(t, b);
+    int const owner = dec.owner(span, b);
+    if (i >= num.local_size()) {
+      auto box = owner_boxes.find(owner);
+      if (box == owner_boxes.end()) {
+        Ijk lo, hi;
+        dec.point_box(owner, false, lo, hi);
+        box =
+            owner_boxes.emplace(owner, Box_Numbering{num.types, lo, hi}).first;
+      }
+      add_ghost(e, cpys, i, id, owner, box->second.index(t, b));
+    } else if (owner != mype) {
+      e.comm_type[i] = Entity::COPY;
+      cpys.add(owner, id, i);
+    } else {
+      e.comm_type[i] = Entity::INTERNAL;
+      Rank_List const holders = dec.holders(span, b);
+      for (int h = 0; h < holders.n; ++h)
+        if (holders.pe[h] != mype) {
+          e.comm_type[i] = Entity::SOURCE;
+          srcs.add(holders.pe[h], id, i);
+        }
+    }
+  }
+  e.myCpys = cpys.finish();
+  e.mySrcs = srcs.finish();
+}
+
+} // namespace
+
+/* ------------------------------- Mesh_Spec ------------------------------- */
+
+bool Mesh_Spec::parse(std::string const &desc) {
+  auto const colon = desc.find(':');
+  if (colon == std::string::npos)
+    return false;
+  std::string const kind = desc.substr(0, colon);
+  if (kind == "hex")
+    shape = HEX;
+  else if (kind == "tet")
+    shape = TET;
+  else
+    return false;
+
+  std::array<int, 3> n;
+  int num = 0;
+  size_t pos = colon + 1;
+  while (num < 3) {
+    size_t len = 0;
+    try {
+      n[num++] = std::stoi(desc.substr(pos), &len);
+    } catch (...) {
+      return false;
+    }
+    if (len == 0 || n[num - 1] < 1)
+      return false;
+    pos += len;
+    if (pos == desc.size())
+      break;
+    if (desc[pos++] != 'x')
+      return false;
+  }
+  if (pos != desc.size() || (num != 1 && num != 3))
+    return false;
+  if (num == 1)
+    n[1] = n[2] = n[0];
+  cells = n;
+  return true;
+}
+
+void Mesh_Spec::split_ranks(int num_pe) {
+  /* Give each prime factor, largest first, to the dimension with the most
+     cells per rank */
+  std::vector<int> factors;
+  for (int p = 2; p * p <= num_pe; ++p)
+    for (; num_pe % p == 0; num_pe /= p)
+      factors.push_back(p);
+  if (num_pe > 1)
+    factors.push_back(num_pe);
+  ranks = {1, 1, 1};
+  for (auto f = factors.rbegin(); f != factors.rend(); ++f) {
+    int best = 0;
+    for (int d = 1; d < 3; ++d)
+      if (long(cells[d]) * ranks[best] > long(cells[best]) * ranks[d])
+        best = d;
+    ranks[best] *= *f;
+  }
+}
+
+/* ------------------------------ generate_mesh ---------------------------- */
+
+void generate_mesh(Mesh_Spec const &spec, int const mype, Mesh &mesh) {
+  Ijk const &N = spec.cells;
+  long num_cells = 1;
+  for (int d = 0; d < 3; ++d) {
+    if (spec.ranks[d] < 1 || spec.cells[d] < spec.ranks[d])
+      error_stop("generate_mesh: each dimension needs at least one cell per "
+                 "rank");
+    num_cells *= N[d];
+  }
+  if (mype < 0 || mype >= spec.num_ranks())
+    error_stop("generate_mesh: rank out of range");
+  Decomposition const dec{N, spec.ranks};
+
+  /* Number everything this rank holds */
+  Ijk const np{N[0] + 1, N[1] + 1, N[2] + 1};
+  Ijk lo, hi, glo, ghi;
+  auto const numbering = [&](Lattice_Types const &types, Ijk const &n) {
+    Lattice_Numbering num{
+        types, {n, long(types.size())}, Box_Numbering{types, lo, hi}, {}};
+    Box_Numbering const held{types, glo, ghi};
+    for (int i = 0; i < held.size(); ++i) {
+      int t;
+      Ijk b;
+      held.decode(i, t, b);
+      if (!num.local.contains(t, b))
+        num.ghosts.push_back(num.ids.id(t, b));
+    }
+    std::sort(num.ghosts.begin(), num.ghosts.end());
+    return num;
+  };
+  dec.cell_box(mype, false, lo, hi);
+  dec.cell_box(mype, true, glo, ghi);
+  Lattice_Numbering const cells = numbering(point_types(), N);
+  dec.point_box(mype, false, lo, hi);
+  dec.point_box(mype, true, glo, ghi);
+  Lattice_Numbering const points = numbering(point_types(), np);
+  Lattice_Numbering const edges = numbering(edge_types(spec.shape), np);
+  Lattice_Numbering const faces = numbering(face_types(spec.shape), np);
+
+  std::vector<Zone_Template> const templates =
+      zone_templates(spec.shape, edges.types, faces.types);
+  int const zpc = static_cast<int>(templates.size());
+  int const spz = static_cast<int>(templates[0].sides.size());
+  int const cpz = static_cast<int>(templates[0].pts.size());
+  if (num_cells * zpc * spz * 2 > INT_MAX)
+    error_stop("generate_mesh: the mesh has too many iotas for int indices");
+
+  auto const on_boundary = [&](int const span, Ijk const &b) {
+    for (int d = 0; d < 3; ++d)
+      if (!spans(span, d) && (b[d] == 0 || b[d] == N[d]))
+        return true;
+    return false;
+  };
+
+  /* Each real zone's exterior zones (one per boundary face) and their sides
+     come after the real zones and their sides */
+  int const num_real = cells.local_size() * zpc;
+  std::vector<int> ext_zone(num_real + 1, 0), ext_side(num_real + 1, 0);
+  for (int z = 0; z < num_real; ++z) {
+    int t;
+    Ijk c;
+    cells.decode(z / zpc, t, c);
+    ext_zone[z + 1] = ext_zone[z];
+    ext_side[z + 1] = ext_side[z];
+    for (auto const &f : templates[z % zpc].faces)
+      if (on_boundary(faces.types[f.type].span, offset(c, f.base))) {
+        ext_zone[z + 1] += 1;
+        ext_side[z + 1] += static_cast<int>(f.loop.size());
+      }
+  }
+  int const num_ghost = static_cast<int>(cells.ghosts.size()) * zpc;
+  int const zl = num_real + ext_zone[num_real];
+  int const sl = num_real * spz + ext_side[num_real];
+  int const cl = num_real * cpz + ext_side[num_real];
+  int const zt = zl + num_ghost;
+  int const st = sl + num_ghost * spz;
+  int const ct = cl + num_ghost * cpz;
+
+  mesh.ivtag = UME_VERSION_3;
+  mesh.version_header = true;
+  mesh.mype = mype;
+  mesh.numpe = spec.num_ranks();
+  mesh.geo = Mesh::CARTESIAN;
+  mesh.dump_iotas = true;
+  mesh.points.resize(points.local_size(), points.size(),
+      points.size() - points.local_size());
+  mesh.edges.resize(
+      edges.local_size(), edges.size(), edges.size() - edges.local_size());
+  mesh.faces.resize(
+      faces.local_size(), faces.size(), faces.size() - faces.local_size());
+  mesh.zones.resize(zl, zt, zt - zl);
+  mesh.sides.resize(sl, st, st - sl);
+  mesh.corners.resize(cl, ct, ct - cl);
+  mesh.iotas.resize(2 * sl, 2 * st, 2 * (st - sl));
+
+  auto &ds = *mesh.ds;
+  auto &pcoord = ds.access_vec3v("pcoord");
+  auto &e2p1 = ds.access_intv("m:e>p1");
+  auto &e2p2 = ds.access_intv("m:e>p2");
+  auto &f2z1 = ds.access_intv("m:f>z1");
+  auto &f2z2 = ds.access_intv("m:f>z2");
+  auto &c2p = ds.access_intv("m:c>p");
+  auto &c2z = ds.access_intv("m:c>z");
+  auto &s2z = ds.access_intv("m:s>z");
+  auto &s2p1 = ds.access_intv("m:s>p1");
+  auto &s2p2 = ds.access_intv("m:s>p2");
+  auto &s2e = ds.access_intv("m:s>e");
+  auto &s2f = ds.access_intv("m:s>f");
+  auto &s2c1 = ds.access_intv("m:s>c1");
+  auto &s2c2 = ds.access_intv("m:s>c2");
+  auto &s2s2 = ds.access_intv("m:s>s2");
+  auto &s2s3 = ds.access_intv("m:s>s3");
+  auto &s2s4 = ds.access_intv("m:s>s4");
+  auto &s2s5 = ds.access_intv("m:s>s5");
+  auto &a2z = ds.access_intv("m:a>z");
+  auto &a2f = ds.access_intv("m:a>f");
+  auto &a2p = ds.access_intv("m:a>p");
+  auto &a2e = ds.access_intv("m:a>e");
+  auto &a2s = ds.access_intv("m:a>s");
+
+  /* Points and edges */
+  Vec3 const h{{spec.extent[0] / N[0], spec.extent[1] / N[1],
+      spec.extent[2] / N[2]}};
+  Kokkos::parallel_for("generate-points",
+      Kokkos::RangePolicy<HostExecSpace>(0, points.size()),
+      [&](int const p) {
+        int t;
+        Ijk b;
+        points.decode(p, t, b);
+        pcoord[p] = Vec3{{b[0] * h[0], b[1] * h[1], b[2] * h[2]}};
+        mesh.points.mask[p] = p >= points.local_size() ? 0
+            : on_boundary(0, b)                        ? -1
+                                                       : 1;
+      });
+  Kokkos::parallel_for("generate-edges",
+      Kokkos::RangePolicy<HostExecSpace>(0, edges.size()),
+      [&](int const e) {
+        int t;
+        Ijk b;
+        edges.decode(e, t, b);
+        int const span = edges.types[t].span;
+        e2p1[e] = points.index(0, b);
+        e2p2[e] = points.index(0, offset(b, span));
+        mesh.edges.mask[e] = e >= edges.local_size() ? 0
+            : on_boundary(span, b)                   ? -1
+                                                     : 1;
+      });
+
+  /* Zones, with their corners, sides and iotas.  Real zones also build their
+     exterior zones. */
+  auto const set_iotas = [&](int const s, short const mask) {
+    for (int k = 0; k < 2; ++k) {
+      int const a = 2 * s + k;
+      a2z[a] = s2z[s];
+      a2f[a] = s2f[s];
+      a2e[a] = s2e[s];
+      a2p[a] = k == 0 ? s2p1[s] : s2p2[s];
+      a2s[a] = s;
+      mesh.iotas.mask[a] = mask;
+    }
+  };
+  Kokkos::parallel_for("generate-zones",
+      Kokkos::RangePolicy<HostExecSpace>(0, num_real + num_ghost),
+      [&](int const i) {
+        bool const real = i < num_real;
+        int const g = i - num_real;
+        int const z = real ? i : zl + g;
+        int const sb = real ? i * spz : sl + g * spz;
+        int const cb = real ? i * cpz : cl + g * cpz;
+        short const mask = real ? 1 : 0;
+        Zone_Template const &tz = templates[i % zpc];
+        int t;
+        Ijk c;
+        cells.decode(real ? i / zpc : cells.local_size() + g / zpc, t, c);
+
+        mesh.zones.mask[z] = mask;
+        std::array<int, 8> p;
+        for (int m = 0; m < cpz; ++m) {
+          p[m] = points.index(0, offset(c, tz.pts[m]));
+          c2p[cb + m] = p[m];
+          c2z[cb + m] = z;
+          mesh.corners.mask[cb + m] = mask;
+        }
+        std::array<int, 6> f;
+        for (size_t j = 0; j < tz.faces.size(); ++j)
+          f[j] = faces.index(tz.faces[j].type, offset(c, tz.faces[j].base));
+        for (int k = 0; k < spz; ++k) {
+          auto const &ts = tz.sides[k];
+          int const s = sb + k;
+          s2z[s] = z;
+          s2p1[s] = p[ts.p1];
+          s2p2[s] = p[ts.p2];
+          s2e[s] = edges.index(ts.edge_type, offset(c, ts.edge_base));
+          s2f[s] = f[ts.face];
+          s2c1[s] = cb + ts.p1;
+          s2c2[s] = cb + ts.p2;
+          s2s2[s] = -1;
+          s2s3[s] = sb + ts.s3;
+          s2s4[s] = sb + ts.s4;
+          s2s5[s] = sb + ts.s5;
+          mesh.sides.mask[s] = mask;
+          set_iotas(s, mask);
+        }
+        if (!real)
+          return;
+
+        /* An exterior zone mirrors the real zone's sides on the face */
+        int xz = num_real + ext_zone[i];
+        int xs = num_real * spz + ext_side[i];
+        int xc = num_real * cpz + ext_side[i];
+        for (auto const &tf : tz.faces) {
+          if (!on_boundary(faces.types[tf.type].span, offset(c, tf.base)))
+            continue;
+          int const len = static_cast<int>(tf.loop.size());
+          mesh.zones.mask[xz] = -1;
+          for (int k = 0; k < len; ++k) {
+            int const s = xs + k;
+            int const r = sb + tf.first_side + k;
+            c2p[xc + k] = p[tf.loop[k]];
+            c2z[xc + k] = xz;
+            mesh.corners.mask[xc + k] = -1;
+            s2z[s] = xz;
+            s2p1[s] = s2p2[r];
+            s2p2[s] = s2p1[r];
+            s2e[s] = s2e[r];
+            s2f[s] = s2f[r];
+            s2c1[s] = xc + (k + 1) % len;
+            s2c2[s] = xc + k;
+            s2s2[s] = -1;
+            s2s3[s] = -1;
+            s2s4[s] = xs + (k + len - 1) % len;
+            s2s5[s] = xs + (k + 1) % len;
+            mesh.sides.mask[s] = -1;
+            set_iotas(s, -1);
+          }
+          ++xz;
+          xs += len;
+          xc += len;
+        }
+      });
+
+  /* Pair the sides across each face */
+  std::vector<int> face_first(faces.size() + 1, 0), face_sides(st);
+  for (int s = 0; s < st; ++s)
+    ++face_first[s2f[s] + 1];
+  for (int f = 0; f < faces.size(); ++f)
+    face_first[f + 1] += face_first[f];
+  {
+    std::vector<int> next(face_first.begin(), face_first.end() - 1);
+    for (int s = 0; s < st; ++s)
+      face_sides[next[s2f[s]]++] = s;
+  }
+  Kokkos::parallel_for("generate-faces",
+      Kokkos::RangePolicy<HostExecSpace>(0, faces.size()),
+      [&](int const f) {
+        int const first = face_first[f];
+        int const last = face_first[f + 1];
+        assert(last > first);
+        f2z1[f] = s2z[face_sides[first]];
+        f2z2[f] = -1;
+        for (int i = first; i < last; ++i) {
+          int const s = face_sides[i];
+          if (s2z[s] != f2z1[f] && f2z2[f] < 0)
+            f2z2[f] = s2z[s];
+          for (int j = first; j < last; ++j) {
+            int const o = face_sides[j];
+            if (s2e[o] == s2e[s] && s2z[o] != s2z[s])
+              s2s2[s] = o;
+          }
+        }
+        int t;
+        Ijk b;
+        faces.decode(f, t, b);
+        mesh.faces.mask[f] = f >= faces.local_size()  ? 0
+            : on_boundary(faces.types[t].span, b) ? -1
+                                                  : 1;
+      });
+
+  /* Communication.  Points, edges and faces may be shared; zones and their
+     children are either owned or ghosts. */
+  lattice_comm(mesh.points, points, dec, mype);
+  lattice_comm(mesh.edges, edges, dec, mype);
+  lattice_comm(mesh.faces, faces, dec, mype);
+
+  Neighbor_Lists zcpys, zsrcs, scpys, ssrcs, ccpys, csrcs, acpys, asrcs;
+  std::map<int, Box_Numbering> owner_boxes;
+  for (int i = 0; i < num_real + num_ghost; ++i) {
+    bool const real = i < num_real;
+    int const g = i - num_real;
+    int const z = real ? i : zl + g;
+    int const sb = real ? i * spz : sl + g * spz;
+    int const cb = real ? i * cpz : cl + g * cpz;
+    int t;
+    Ijk c;
+    cells.decode(real ? i / zpc : cells.local_size() + g / zpc, t, c);
+    long const zid = cells.ids.id(0, c) * zpc + i % zpc;
+
+    if (real) {
+      int comm_type = Entity::INTERNAL;
+      Rank_List const holders = dec.cell_holders(c);
+      for (int h = 0; h < holders.n; ++h) {
+        int const pe = holders.pe[h];
+        if (pe == mype)
+          continue;
+        comm_type = Entity::SOURCE;
+        zsrcs.add(pe, zid, z);
+        for (int k = 0; k < spz; ++k) {
+          ssrcs.add(pe, zid * spz + k, sb + k);
+          asrcs.add(pe, 2 * (zid * spz + k), 2 * (sb + k));
+          asrcs.add(pe, 2 * (zid * spz + k) + 1, 2 * (sb + k) + 1);
+        }
+        for (int m = 0; m < cpz; ++m)
+          csrcs.add(pe, zid * cpz + m, cb + m);
+      }
+      mesh.zones.comm_type[z] = comm_type;
+      for (int k = 0; k < spz; ++k) {
+        mesh.sides.comm_type[sb + k] = comm_type;
+        mesh.iotas.comm_type[2 * (sb + k)] = comm_type;
+        mesh.iotas.comm_type[2 * (sb + k) + 1] = comm_type;
+      }
+      for (int m = 0; m < cpz; ++m)
+        mesh.corners.comm_type[cb + m] = comm_type;
+      continue;
+    }
+
+    int const owner = dec.cell_owner(c);
+    auto box = owner_boxes.find(owner);
+    if (box == owner_boxes.end()) {
+      Ijk olo, ohi;
+      dec.cell_box(owner, false, olo, ohi);
+      box = owner_boxes.emplace(owner, Box_Numbering{point_types(), olo, ohi})
+                .first;
+    }
+    int const oz = box->second.index(0, c) * zpc + i % zpc;
+    add_ghost(mesh.zones, zcpys, z, zid, owner, oz);
+    for (int k = 0; k < spz; ++k) {
+      int const s = sb + k;
+      int const os = oz * spz + k;
+      add_ghost(mesh.sides, scpys, s, zid * spz + k, owner, os);
+      add_ghost(mesh.iotas, acpys, 2 * s, 2 * (zid * spz + k), owner, 2 * os);
+      add_ghost(mesh.iotas, acpys, 2 * s + 1, 2 * (zid * spz + k) + 1, owner,
+          2 * os + 1);
+    }
+    for (int m = 0; m < cpz; ++m)
+      add_ghost(
+          mesh.corners, ccpys, cb + m, zid * cpz + m, owner, oz * cpz + m);
+  }
+  /* The exterior zones and their children are never shared */
+  for (int z = num_real; z < zl; ++z)
+    mesh.zones.comm_type[z] = Entity::INTERNAL;
+  for (int s = num_real * spz; s < sl; ++s) {
+    mesh.sides.comm_type[s] = Entity::INTERNAL;
+    mesh.iotas.comm_type[2 * s] = Entity::INTERNAL;
+    mesh.iotas.comm_type[2 * s + 1] = Entity::INTERNAL;
+  }
+  for (int c = num_real * cpz; c < cl; ++c)
+    mesh.corners.comm_type[c] = Entity::INTERNAL;
+
+  mesh.zones.myCpys = zcpys.finish();
+  mesh.zones.mySrcs = zsrcs.finish();
+  mesh.sides.myCpys = scpys.finish();
+  mesh.sides.mySrcs = ssrcs.finish();
+  mesh.corners.myCpys = ccpys.finish();
+  mesh.corners.mySrcs = csrcs.finish();
+  mesh.iotas.myCpys = acpys.finish();
+  mesh.iotas.mySrcs = asrcs.finish();
+}
+
+} // namespace Ume
@@ -0,0 +1,66 @@
+/*
+  Copyright (c) 2023, Triad National Security, LLC. All rights reserved.
+
+  This is open source software; you can redistribute it and/or modify it under
+  the terms of the BSD-3 License. If software is modified to produce derivative
+  works, such modified software should be clearly marked, so as not to confuse
+  it with the version available from LANL. Full text of the BSD-3 License can be
+  found in the LICENSE.md file, and the full assertion of copyright in the
+  NOTICE.md file.
+*/
+
+/*!
+\file Ume/generate_mesh.hh
+
+Build structured meshes in memory, so that the kernels can be run at any size
+without reading a mesh file.
+
+The mesh is a box of cells.  A HEX mesh has one hexahedral zone per cell; a TET
+mesh splits each cell into the six tetrahedra that share its main diagonal.
+The cells are divided among the ranks in blocks, and each rank holds its own
+cells plus one layer of ghost cells.  The result has everything a mesh file
+provides: all of the connectivity maps, the iotas, the masks, and the ghost
+and communication data that gathscat needs.
+
+Each domain boundary face also gets an exterior zone, with mask -1.  Its
+sides are the boundary sides (mask -1, s2 the real side across the face), and
+its corners are the boundary corners.  Boundary points, edges and faces have
+mask -1, ghosts have mask 0, and everything else has mask 1.
+*/
+
+#ifndef UME_GENERATE_MESH_HH
+#define UME_GENERATE_MESH_HH 1
+
+#include "Ume/SOA_Idx_Mesh.hh"
+#include <array>
+#include <string>
+
+namespace Ume {
+
+//! The shape and decomposition of a generated mesh
+struct Mesh_Spec {
+  enum Shape { HEX, TET };
+  Shape shape = HEX;
+  //! The number of cells in each dimension
+  std::array<int, 3> cells{8, 8, 8};
+  //! The number of ranks in each dimension
+  std::array<int, 3> ranks{1, 1, 1};
+  //! The size of the box in each dimension; it starts at the origin
+  std::array<double, 3> extent{1.0, 1.0, 1.0};
+
+  constexpr int num_ranks() const { return ranks[0] * ranks[1] * ranks[2]; }
+  /*! Parse "hex:NXxNYxNZ" or "tet:NXxNYxNZ" (or just "hex:N" for a cube),
+      setting shape and cells.  Returns false if `desc` is not of this form. */
+  bool parse(std::string const &desc);
+  //! Set ranks to split num_pe ranks evenly across the cells
+  void split_ranks(int num_pe);
+};
+
+/*! Fill `mesh` with rank `mype`'s part of the mesh described by `spec`.  The
+    rank layout is row-major with x fastest.  Ranks must not outnumber cells in
+    any dimension.  The mesh's comm member is left for the caller to set. */
+void generate_mesh(Mesh_Spec const &spec, int mype, SOA_Idx::Mesh &mesh);
+
+} // namespace Ume
+
+#endif
@@ -14,6 +14,7 @@
 */
 
 #include "Ume/gradient.hh"
+#include "Ume/array_types.hh"
 #include "Ume/mem_exec_spaces.hh"
 
 namespace Ume {
@@ -37,10 +38,15 @@ void gradzatz(Ume::SOA_Idx::Mesh &mesh, DBLV_T const &zone_field,
   int const pl = mesh.points.local_size();
   int const cl = mesh.corners.local_size();
 
+  /* The point volume needs a host vector for the gathscat, but the zone
+     volume is only used on the device, so it comes from the memory pool
+     (when there is one) */
+  ScratchScope<> scratch(mesh.zones.size() * sizeof(double));
   DBLV_T point_volume(pll, 0.0);
   point_gradient.assign(pll, VEC3_T(0.0));
 
-  DBLV_T zone_volume(mesh.zones.size(), 0.0);
+  ScratchArrayRank1<double> zone_volume("zone_volume", mesh.zones.size());
+  auto d_zone_volume = zone_volume.view;
   zone_gradient.assign(mesh.zones.size(), VEC3_T(0.0));
 
   Kokkos::View<Vec3 *, HostSpace> h_point_gradient(
@@ -57,8 +63,6 @@ void gradzatz(Ume::SOA_Idx::Mesh &mesh, DBLV_T const &zone_field,
       &corner_type[0], corner_type.size());
   Kokkos::View<Vec3 *, HostSpace> h_zone_gradient(
       &zone_gradient[0], zone_gradient.size());
-  Kokkos::View<double *, HostSpace> h_zone_volume(
-      &zone_volume[0], zone_volume.size());
   Kokkos::View<const Vec3 *, HostSpace> h_point_normal(
       &point_normal[0], point_normal.size());
   Kokkos::View<double *, HostSpace> h_point_volume(
@@ -76,7 +80,6 @@ void gradzatz(Ume::SOA_Idx::Mesh &mesh, DBLV_T const &zone_field,
   auto d_c_to_p_map = create_mirror_view(DevExecMemSpace(), h_c_to_p_map);
   auto d_corner_type = create_mirror_view(DevExecMemSpace(), h_corner_type);
   auto d_zone_gradient = create_mirror_view(DevExecMemSpace(), h_zone_gradient);
-  auto d_zone_volume = create_mirror_view(DevExecMemSpace(), h_zone_volume);
 
   auto d_point_type = create_mirror_view(DevExecMemSpace(), h_point_type);
   auto d_point_volume = create_mirror_view(DevExecMemSpace(), h_point_volume);
@@ -93,7 +96,6 @@ void gradzatz(Ume::SOA_Idx::Mesh &mesh, DBLV_T const &zone_field,
   Kokkos::deep_copy(d_c_to_p_map, h_c_to_p_map);
   Kokkos::deep_copy(d_corner_type, h_corner_type);
   Kokkos::deep_copy(d_zone_gradient, h_zone_gradient);
-  Kokkos::deep_copy(d_zone_volume, h_zone_volume);
   Kokkos::deep_copy(d_point_type, h_point_type);
   Kokkos::deep_copy(d_point_volume, h_point_volume);
   Kokkos::deep_copy(d_point_normal, h_point_normal);
@@ -119,9 +121,26 @@ void gradzatz(Ume::SOA_Idx::Mesh &mesh, DBLV_T const &zone_field,
         }
       });
 
+#if !defined(UME_SERIAL)
+#if defined(KOKKOS_ENABLE_CUDA) || defined(KOKKOS_ENABLE_HIP) || \
+    defined(KOKKOS_ENABLE_SYCL)
+  Kokkos::fence();
+  Kokkos::deep_copy(h_point_volume, d_point_volume);
+  Kokkos::deep_copy(h_point_gradient, d_point_gradient);
+#endif
+#endif
+
   mesh.points.gathscat(Ume::Comm::Op::SUM, point_volume);
   mesh.points.gathscat(Ume::Comm::Op::SUM, point_gradient);
 
+#if !defined(UME_SERIAL)
+#if defined(KOKKOS_ENABLE_CUDA) || defined(KOKKOS_ENABLE_HIP) || \
+    defined(KOKKOS_ENABLE_SYCL)
+  Kokkos::deep_copy(d_point_volume, h_point_volume);
+  Kokkos::deep_copy(d_point_gradient, h_point_gradient);
+#endif
+#endif
+
   /*
     Divide by point control volume to get gradient.  If a point is on the outer
     perimeter of the mesh (POINT_TYPE=-1), subtract the outward normal component
@@ -207,7 +226,6 @@ void gradzatz(Ume::SOA_Idx::Mesh &mesh, DBLV_T const &zone_field,
   mesh.zones.scatter(zone_gradient);
 }
 
-/* NOTE: this only executes on Host */
 void gradzatp_invert(Ume::SOA_Idx::Mesh &mesh, DBLV_T const &zone_field,
     VEC3V_T &point_gradient) {
   auto const &csurf = mesh.ds->caccess_vec3v("corner_csurf");
@@ -239,42 +257,94 @@ void gradzatp_invert(Ume::SOA_Idx::Mesh &mesh, DBLV_T const &zone_field,
   Kokkos::View<const short *, HostSpace> h_point_type(
       &point_type[0], point_type.size());
 
-  Kokkos::parallel_for("gradzatp-ivt-1",
-      Kokkos::RangePolicy<HostExecSpace>(0, num_local_points),
-      [&](const int point_idx) {
-        for (int const &corner_idx : p_to_c_map[point_idx]) {
-          int const zone_idx = h_c_to_z_map(corner_idx);
-          h_point_volume(point_idx) += h_corner_volume(corner_idx);
-          h_point_gradient(point_idx) +=
-              h_csurf(corner_idx) * h_zone_field(zone_idx);
+  auto const d_p_to_c_map = p_to_c_map.view<DevExecMemSpace>();
+  auto d_c_to_z_map = create_mirror_view(DevExecMemSpace(), h_c_to_z_map);
+  auto d_corner_volume = create_mirror_view(DevExecMemSpace(), h_corner_volume);
+  auto d_point_volume = create_mirror_view(DevExecMemSpace(), h_point_volume);
+  auto d_point_gradient =
+      create_mirror_view(DevExecMemSpace(), h_point_gradient);
+  auto d_csurf = create_mirror_view(DevExecMemSpace(), h_csurf);
+  auto d_zone_field = create_mirror_view(DevExecMemSpace(), h_zone_field);
+  auto d_point_normal = create_mirror_view(DevExecMemSpace(), h_point_normal);
+  auto d_point_type = create_mirror_view(DevExecMemSpace(), h_point_type);
+
+#if !defined(UME_SERIAL)
+#if defined(KOKKOS_ENABLE_CUDA) || defined(KOKKOS_ENABLE_HIP) || \
+    defined(KOKKOS_ENABLE_SYCL)
+  Kokkos::deep_copy(d_c_to_z_map, h_c_to_z_map);
+  Kokkos::deep_copy(d_corner_volume, h_corner_volume);
+  Kokkos::deep_copy(d_point_volume, h_point_volume);
+  Kokkos::deep_copy(d_point_gradient, h_point_gradient);
+  Kokkos::deep_copy(d_csurf, h_csurf);
+  Kokkos::deep_copy(d_zone_field, h_zone_field);
+  Kokkos::deep_copy(d_point_normal, h_point_normal);
+  Kokkos::deep_copy(d_point_type, h_point_type);
+#endif
+#endif
+
+  /* Each point gathers from its own corners, so no atomics are needed */
+  Kokkos::parallel_for(
+      "gradzatp-ivt-1", Kokkos::RangePolicy<DevExecSpace>(0, num_local_points),
+      KOKKOS_LAMBDA(const int point_idx) {
+        for (int i = d_p_to_c_map.begin(point_idx);
+             i < d_p_to_c_map.end(point_idx); ++i) {
+          int const corner_idx = d_p_to_c_map.data(i);
+          int const zone_idx = d_c_to_z_map(corner_idx);
+          d_point_volume(point_idx) += d_corner_volume(corner_idx);
+          d_point_gradient(point_idx) +=
+              d_csurf(corner_idx) * d_zone_field(zone_idx);
         }
       });
 
+#if !defined(UME_SERIAL)
+#if defined(KOKKOS_ENABLE_CUDA) || defined(KOKKOS_ENABLE_HIP) || \
+    defined(KOKKOS_ENABLE_SYCL)
+  Kokkos::fence();
+  Kokkos::deep_copy(h_point_volume, d_point_volume);
+  Kokkos::deep_copy(h_point_gradient, d_point_gradient);
+#endif
+#endif
+
   // check for gathscat in gradient.cc
   mesh.points.gathscat(Ume::Comm::Op::SUM, point_volume);
   mesh.points.gathscat(Ume::Comm::Op::SUM, point_gradient);
 
-  Kokkos::parallel_for("gradzatp-ivt-2",
-      Kokkos::RangePolicy<HostExecSpace>(0, num_local_points),
-      [&](const int point_idx) {
-        if (h_point_type(point_idx) > 0) {
+#if !defined(UME_SERIAL)
+#if defined(KOKKOS_ENABLE_CUDA) || defined(KOKKOS_ENABLE_HIP) || \
+    defined(KOKKOS_ENABLE_SYCL)
+  Kokkos::deep_copy(d_point_volume, h_point_volume);
+  Kokkos::deep_copy(d_point_gradient, h_point_gradient);
+#endif
+#endif
+
+  Kokkos::parallel_for(
+      "gradzatp-ivt-2", Kokkos::RangePolicy<DevExecSpace>(0, num_local_points),
+      KOKKOS_LAMBDA(const int point_idx) {
+        if (d_point_type(point_idx) > 0) {
           // Internal point
-          h_point_gradient(point_idx) =
-              h_point_gradient(point_idx) / h_point_volume(point_idx);
-        } else if (h_point_type(point_idx) == -1) {
+          d_point_gradient(point_idx) =
+              d_point_gradient(point_idx) / d_point_volume(point_idx);
+        } else if (d_point_type(point_idx) == -1) {
           // Mesh boundary point
           double const ppdot =
-              dotprod(h_point_gradient(point_idx), h_point_normal(point_idx));
-          h_point_gradient(point_idx) = (h_point_gradient(point_idx) -
-                                            h_point_normal(point_idx) * ppdot) /
-              h_point_volume(point_idx);
+              dotprod(d_point_gradient(point_idx), d_point_normal(point_idx));
+          d_point_gradient(point_idx) = (d_point_gradient(point_idx) -
+                                            d_point_normal(point_idx) * ppdot) /
+              d_point_volume(point_idx);
         }
       });
 
+#if !defined(UME_SERIAL)
+#if defined(KOKKOS_ENABLE_CUDA) || defined(KOKKOS_ENABLE_HIP) || \
+    defined(KOKKOS_ENABLE_SYCL)
+  Kokkos::fence();
+  Kokkos::deep_copy(h_point_gradient, d_point_gradient);
+#endif
+#endif
+
   mesh.points.scatter(point_gradient);
 }
 
-/* NOTE: this only executes on Host */
 void gradzatz_invert(Ume::SOA_Idx::Mesh &mesh, DBLV_T const &zone_field,
     VEC3V_T &zone_gradient, VEC3V_T &point_gradient) {
   auto const &z_to_c_map = mesh.ds->caccess_intrr("m:z>c");
@@ -298,27 +368,57 @@ void gradzatz_invert(Ume::SOA_Idx::Mesh &mesh, DBLV_T const &zone_field,
   Kokkos::View<Vec3 *, HostSpace> h_point_gradient(
       &point_gradient[0], point_gradient.size());
 
-  Kokkos::parallel_for("gradzatz-ivt",
-      Kokkos::RangePolicy<HostExecSpace>(0, num_local_zones),
-      [&](const int zone_idx) {
-        if (h_zone_type(zone_idx) >= 1) {
+  auto const d_z_to_c_map = z_to_c_map.view<DevExecMemSpace>();
+  auto d_zone_type = create_mirror_view(DevExecMemSpace(), h_zone_type);
+  auto d_corner_volume = create_mirror_view(DevExecMemSpace(), h_corner_volume);
+  auto d_c_to_p_map = create_mirror_view(DevExecMemSpace(), h_c_to_p_map);
+  auto d_zone_gradient = create_mirror_view(DevExecMemSpace(), h_zone_gradient);
+  auto d_point_gradient =
+      create_mirror_view(DevExecMemSpace(), h_point_gradient);
+
+#if !defined(UME_SERIAL)
+#if defined(KOKKOS_ENABLE_CUDA) || defined(KOKKOS_ENABLE_HIP) || \
+    defined(KOKKOS_ENABLE_SYCL)
+  Kokkos::deep_copy(d_zone_type, h_zone_type);
+  Kokkos::deep_copy(d_corner_volume, h_corner_volume);
+  Kokkos::deep_copy(d_c_to_p_map, h_c_to_p_map);
+  Kokkos::deep_copy(d_zone_gradient, h_zone_gradient);
+  Kokkos::deep_copy(d_point_gradient, h_point_gradient);
+#endif
+#endif
+
+  Kokkos::parallel_for(
+      "gradzatz-ivt", Kokkos::RangePolicy<DevExecSpace>(0, num_local_zones),
+      KOKKOS_LAMBDA(const int zone_idx) {
+        if (d_zone_type(zone_idx) >= 1) {
           // Only operate on local interior zones
           // Accumulate the (local) zone volume
+          int const cbeg = d_z_to_c_map.begin(zone_idx);
+          int const cend = d_z_to_c_map.end(zone_idx);
           double zone_volume{0.0}; // Only need a local volume
-          for (int const &corner_idx : z_to_c_map[zone_idx]) {
-            zone_volume += h_corner_volume(corner_idx);
+          for (int i = cbeg; i < cend; ++i) {
+            zone_volume += d_corner_volume(d_z_to_c_map.data(i));
           }
 
-          for (int const &corner_idx : z_to_c_map[zone_idx]) {
-            int const point_idx = h_c_to_p_map(corner_idx);
+          for (int i = cbeg; i < cend; ++i) {
+            int const corner_idx = d_z_to_c_map.data(i);
+            int const point_idx = d_c_to_p_map(corner_idx);
             double const c_z_vol_ratio =
-                h_corner_volume(corner_idx) / zone_volume;
-            h_zone_gradient(zone_idx) +=
-                h_point_gradient(point_idx) * c_z_vol_ratio;
+                d_corner_volume(corner_idx) / zone_volume;
+            d_zone_gradient(zone_idx) +=
+                d_point_gradient(point_idx) * c_z_vol_ratio;
           }
         }
       });
 
+#if !defined(UME_SERIAL)
+#if defined(KOKKOS_ENABLE_CUDA) || defined(KOKKOS_ENABLE_HIP) || \
+    defined(KOKKOS_ENABLE_SYCL)
+  Kokkos::fence();
+  Kokkos::deep_copy(h_zone_gradient, d_zone_gradient);
+#endif
+#endif
+
   mesh.zones.scatter(zone_gradient);
 }
 
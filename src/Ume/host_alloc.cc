@@ -0,0 +1,171 @@
+/*
+  Copyright (c) 2023, Triad National Security, LLC. All rights reserved.
+
+  This is open source software; you can redistribute it and/or modify it under
+  the terms of the BSD-3 License. If software is modified to produce derivative
+  works, such modified software should be clearly marked, so as not to confuse
+  it with the version available from LANL. Full text of the BSD-3 License can be
+  found in the LICENSE.md file, and the full assertion of copyright in the
+  NOTICE.md file.
+*/
+
+/*!
+\file Ume/host_alloc.cc
+*/
+
+#include "Ume/host_alloc.hh"
+#include "Ume/mem_exec_spaces.hh"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace Ume {
+
+namespace {
+
+constexpr size_t huge_page_size = host_alloc_threshold;
+
+/* The allocations made by host_alloc */
+struct Mapping {
+  size_t len; // mapped length
+  bool pinned; // from kokkos_malloc<HostPinnedSpace>
+};
+std::mutex mappings_mutex;
+std::map<void *, Mapping> mappings;
+
+void add_mapping(void *const p, size_t const len, bool const pinned) {
+  std::lock_guard<std::mutex> lock(mappings_mutex);
+  mappings.emplace(p, Mapping{len, pinned});
+}
+
+size_t round_up(size_t const n, size_t const align) {
+  return (n + align - 1) / align * align;
+}
+
+/* Write one byte per small page, in parallel where possible, so that pages
+   are placed by the first-touch policy of the threads that touch them. */
+void first_touch(char *const p, size_t const num_bytes) {
+  size_t const page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t const num_pages = num_bytes / page;
+  if (Kokkos::is_initialized()) {
+    Kokkos::parallel_for("first_touch",
+        Kokkos::RangePolicy<HostExecSpace>(0, static_cast<int64_t>(num_pages)),
+        [=](int64_t const i) { p[static_cast<size_t>(i) * page] = 0; });
+    HostExecSpace().fence();
+  } else {
+    for (size_t i = 0; i < num_pages; ++i)
+      p[i * page] = 0;
+  }
+}
+
+#if defined(__linux__)
+/* Map num_bytes (a multiple of huge_page_size) aligned to huge_page_size by
+   over-mapping and trimming the ends. */
+void *map_aligned(size_t const num_bytes, int const extra_flags) {
+  size_t const len = num_bytes + huge_page_size;
+  void *const raw = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+  if (raw == MAP_FAILED)
+    return nullptr;
+  auto const addr = reinterpret_cast<uintptr_t>(raw);
+  uintptr_t const start = round_up(addr, huge_page_size);
+  if (start > addr)
+    munmap(raw, start - addr);
+  size_t const tail = addr + len - (start + num_bytes);
+  if (tail > 0)
+    munmap(reinterpret_cast<void *>(start + num_bytes), tail);
+  return reinterpret_cast<void *>(start);
+}
+#endif
+
+} // namespace
+
+Host_Pages host_pages_from_env() {
+  if (char const *const s = std::getenv("UME_HOST_PAGES")) {
+    if (std::strcmp(s, "thp") == 0)
+      return Host_Pages::THP;
+    if (std::strcmp(s, "hugetlb") == 0)
+      return Host_Pages::HUGETLB;
+    if (std::strcmp(s, "pinned") == 0)
+      return Host_Pages::PINNED;
+  }
+  return Host_Pages::DEFAULT;
+}
+
+Host_Pages &host_pages() {
+  static Host_Pages pages = host_pages_from_env();
+  return pages;
+}
+
+void *host_alloc(size_t const num_bytes, Host_Pages const pages) {
+  if (num_bytes == 0)
+    return nullptr;
+  size_t const len = round_up(num_bytes, huge_page_size);
+  if (pages == Host_Pages::PINNED && Kokkos::is_initialized()) {
+    void *const p =
+        Kokkos::kokkos_malloc<HostPinnedSpace>("Ume host pinned", len);
+    if (p)
+      add_mapping(p, len, true);
+    return p;
+  }
+#if defined(__linux__)
+  void *p = nullptr;
+  if (pages == Host_Pages::HUGETLB) {
+    /* MAP_HUGETLB mappings are already huge-page aligned, but fail if too
+       few huge pages are reserved */
+    p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p == MAP_FAILED)
+      p = nullptr;
+  }
+  if (!p) {
+    p = map_aligned(len, 0);
+    if (!p)
+      return nullptr;
+#if defined(MADV_HUGEPAGE)
+    if (pages == Host_Pages::THP || pages == Host_Pages::HUGETLB)
+      madvise(p, len, MADV_HUGEPAGE);
+#endif
+  }
+#else
+  /* Without mmap, fall back to ordinary (but still first-touched) memory */
+  void *const p = std::aligned_alloc(huge_page_size, len);
+  if (!p)
+    return nullptr;
+#endif
+  first_touch(static_cast<char *>(p), len);
+  add_mapping(p, len, false);
+  return p;
+}
+
+bool host_free(void *const p) {
+  Mapping m;
+  {
+    std::lock_guard<std::mutex> lock(mappings_mutex);
+    auto const it = mappings.find(p);
+    if (it == mappings.end())
+      return false;
+    m = it->second;
+    mappings.erase(it);
+  }
+  if (m.pinned) {
+    /* Pinned memory that outlives Kokkos is reclaimed at process exit */
+    if (Kokkos::is_initialized())
+      Kokkos::kokkos_free<HostPinnedSpace>(p);
+    return true;
+  }
+#if defined(__linux__)
+  munmap(p, m.len);
+#else
+  std::free(p);
+#endif
+  return true;
+}
+
+} // namespace Ume
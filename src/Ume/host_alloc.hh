@@ -0,0 +1,94 @@
+/*
+  Copyright (c) 2023, Triad National Security, LLC. All rights reserved.
+
+  This is open source software; you can redistribute it and/or modify it under
+  the terms of the BSD-3 License. If software is modified to produce derivative
+  works, such modified software should be clearly marked, so as not to confuse
+  it with the version available from LANL. Full text of the BSD-3 License can be
+  found in the LICENSE.md file, and the full assertion of copyright in the
+  NOTICE.md file.
+*/
+
+/*!
+\file Ume/host_alloc.hh
+
+Large host allocations backed by huge pages (with first-touch NUMA
+placement) or by page-locked memory.
+*/
+
+#ifndef UME_HOST_ALLOC_HH
+#define UME_HOST_ALLOC_HH 1
+
+#include <cstddef>
+#include <new>
+
+namespace Ume {
+
+/*! The kind of pages used for large host allocations */
+enum class Host_Pages {
+  DEFAULT, //!< Ordinary pages (Host_Allocator just uses operator new)
+  THP, //!< mmap + madvise(MADV_HUGEPAGE) (transparent huge pages)
+  HUGETLB, //!< mmap with MAP_HUGETLB, falling back to THP if none are reserved
+  PINNED //!< Page-locked (HostPinnedSpace) memory for fast device transfers
+};
+
+/*! Set from the UME_HOST_PAGES environment variable ("thp", "hugetlb" or
+    "pinned"), the default for the Host_Allocator and for the host memory
+    pool. */
+Host_Pages host_pages_from_env();
+
+//! The page kind used by Host_Allocator; initially host_pages_from_env()
+Host_Pages &host_pages();
+
+/*!
+  Allocate num_bytes of host memory with the given kind of pages.  Mapped
+  memory is huge-page aligned, and is first touched in parallel by the
+  HostExecSpace threads (when Kokkos is initialized), so that each page is
+  placed on the NUMA node of the thread that will typically use it.  PINNED
+  memory comes from Kokkos, so it falls back to ordinary pages before Kokkos
+  is initialized.  Returns nullptr on failure.  Release with host_free.
+*/
+void *host_alloc(size_t num_bytes, Host_Pages pages);
+
+//! Release memory from host_alloc; returns false if p did not come from it
+bool host_free(void *p);
+
+//! Allocations smaller than this are never mapped (2 MiB, one huge page)
+constexpr size_t host_alloc_threshold = size_t{1} << 21;
+
+/*!
+  A std::allocator replacement that places large arrays (at least
+  host_alloc_threshold bytes) with host_alloc, using host_pages().  Small
+  arrays use operator new as usual.
+*/
+template <class T> class Host_Allocator {
+public:
+  using value_type = T;
+
+  Host_Allocator() noexcept = default;
+  template <class U> Host_Allocator(Host_Allocator<U> const &) noexcept {}
+
+  T *allocate(size_t const n) {
+    size_t const num_bytes = n * sizeof(T);
+    if (num_bytes >= host_alloc_threshold &&
+        host_pages() != Host_Pages::DEFAULT) {
+      if (void *const p = host_alloc(num_bytes, host_pages()))
+        return static_cast<T *>(p);
+    }
+    return static_cast<T *>(::operator new(num_bytes));
+  }
+
+  void deallocate(T *const p, size_t const n) noexcept {
+    /* The page kind may have changed since p was allocated */
+    if (n * sizeof(T) < host_alloc_threshold || !host_free(p))
+      ::operator delete(p);
+  }
+
+  template <class U> bool operator==(Host_Allocator<U> const &) const noexcept {
+    return true;
+  }
+};
+
+} // namespace Ume
+
+#endif
@@ -0,0 +1,179 @@
+/*
+  Copyright (c) 2023, Triad National Security, LLC. All rights reserved.
+
+  This is open source software; you can redistribute it and/or modify it under
+  the terms of the BSD-3 License. If software is modified to produce derivative
+  works, such modified software should be clearly marked, so as not to confuse
+  it with the version available from LANL. Full text of the BSD-3 License can be
+  found in the LICENSE.md file, and the full assertion of copyright in the
+  NOTICE.md file.
+*/
+
+/*!
+\file Ume/int_codec.cc
+*/
+
+#include "Ume/int_codec.hh"
+#include "Ume/utils.hh"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Ume {
+namespace Int_Codec {
+
+namespace {
+
+constexpr size_t header_bytes = sizeof(uint64_t);
+constexpr size_t tail_bytes = sizeof(uint64_t);
+//! Frames per decoding task
+constexpr size_t frames_per_task = 256;
+
+inline uint32_t zigzag(uint32_t const d) {
+  return (d << 1) ^ (0u - (d >> 31));
+}
+
+inline uint32_t unzigzag(uint32_t const z) { return (z >> 1) ^ (0u - (z & 1)); }
+
+inline size_t frame_bytes(unsigned const width) {
+  return frame_size * width / 8;
+}
+
+/* The difference between neighbors, with wrap-around */
+inline uint32_t delta(int const *const v, size_t const i) {
+  return static_cast<uint32_t>(v[i]) - static_cast<uint32_t>(v[i - 1]);
+}
+
+void pack_frame(int const *const v, size_t const len, unsigned const width,
+    unsigned char *const p) {
+  if (width == 0)
+    return;
+  for (size_t i = 1; i < len; ++i) {
+    size_t const bit = i * width;
+    uint64_t word;
+    std::memcpy(&word, p + bit / 8, sizeof(word));
+    word |= static_cast<uint64_t>(zigzag(delta(v, i))) << (bit % 8);
+    std::memcpy(p + bit / 8, &word, sizeof(word));
+  }
+}
+
+void unpack_frame(unsigned char const *const p, unsigned const width,
+    int32_t const base, size_t const len, int *const out) {
+  uint32_t d[frame_size];
+  uint64_t const mask = (uint64_t{1} << width) - 1;
+  /* No dependencies between iterations, so this vectorizes */
+  for (size_t i = 0; i < frame_size; ++i) {
+    size_t const bit = i * width;
+    uint64_t word;
+    std::memcpy(&word, p + bit / 8, sizeof(word));
+    d[i] = static_cast<uint32_t>((word >> (bit % 8)) & mask);
+  }
+  uint32_t acc = static_cast<uint32_t>(base);
+  out[0] = base;
+  for (size_t i = 1; i < len; ++i) {
+    acc += unzigzag(d[i]);
+    out[i] = static_cast<int>(acc);
+  }
+}
+
+} // namespace
+
+std::string encode(int const *const data, size_t const num_values) {
+  size_t const num_frames = (num_values + frame_size - 1) / frame_size;
+  std::vector<unsigned char> width(num_frames);
+  size_t packed_bytes = 0;
+  for (size_t f = 0; f < num_frames; ++f) {
+    size_t const first = f * frame_size;
+    size_t const last = std::min(first + frame_size, num_values);
+    /* The bit width of the OR of the values is that of the largest */
+    uint32_t bits = 0;
+    for (size_t i = first + 1; i < last; ++i)
+      bits |= zigzag(delta(data, i));
+    width[f] = static_cast<unsigned char>(std::bit_width(bits));
+    packed_bytes += frame_bytes(width[f]);
+  }
+
+  std::string out(header_bytes + num_frames * (sizeof(int32_t) + 1) +
+          packed_bytes + tail_bytes,
+      '\0');
+  char *p = out.data();
+  uint64_t const count = num_values;
+  std::memcpy(p, &count, sizeof(count));
+  p += header_bytes;
+  for (size_t f = 0; f < num_frames; ++f) {
+    std::memcpy(p, data + f * frame_size, sizeof(int32_t));
+    p += sizeof(int32_t);
+  }
+  std::memcpy(p, width.data(), num_frames);
+  p += num_frames;
+  auto packed = reinterpret_cast<unsigned char *>(p);
+  for (size_t f = 0; f < num_frames; ++f) {
+    size_t const first = f * frame_size;
+    size_t const len = std::min(frame_size, num_values - first);
+    pack_frame(data + first, len, width[f], packed);
+    packed += frame_bytes(width[f]);
+  }
+  return out;
+}
+
+size_t max_decoded_size(size_t const num_bytes) {
+  if (num_bytes < header_bytes + tail_bytes)
+    return 0;
+  /* Every frame has at least its base and width, even with no differences */
+  size_t const max_frames =
+      (num_bytes - header_bytes - tail_bytes) / (sizeof(int32_t) + 1);
+  return max_frames * frame_size;
+}
+
+size_t decoded_size(char const *const bytes, size_t const num_bytes) {
+  if (num_bytes < header_bytes + tail_bytes)
+    return 0;
+  uint64_t count;
+  std::memcpy(&count, bytes, sizeof(count));
+  if (count > max_decoded_size(num_bytes))
+    return 0;
+  return static_cast<size_t>(count);
+}
+
+bool decode(char const *const bytes, size_t const num_bytes, int *const out,
+    int const num_threads) {
+  size_t const num_values = decoded_size(bytes, num_bytes);
+  size_t const num_frames = (num_values + frame_size - 1) / frame_size;
+  size_t const packed_start =
+      header_bytes + num_frames * (sizeof(int32_t) + 1);
+  if (num_bytes < packed_start + tail_bytes)
+    return false;
+  char const *const bases = bytes + header_bytes;
+  auto const widths = reinterpret_cast<unsigned char const *>(
+      bases + num_frames * sizeof(int32_t));
+  auto const packed = widths + num_frames;
+
+  /* Locate each frame's packed differences */
+  std::vector<size_t> offset(num_frames + 1);
+  offset[0] = 0;
+  for (size_t f = 0; f < num_frames; ++f) {
+    if (widths[f] > 32)
+      return false;
+    offset[f + 1] = offset[f] + frame_bytes(widths[f]);
+  }
+  if (packed_start + offset[num_frames] + tail_bytes != num_bytes)
+    return false;
+
+  size_t const num_tasks = (num_frames + frames_per_task - 1) / frames_per_task;
+  run_tasks(num_threads, num_tasks, [&](size_t const t) {
+    size_t const last = std::min((t + 1) * frames_per_task, num_frames);
+    for (size_t f = t * frames_per_task; f < last; ++f) {
+      int32_t base;
+      std::memcpy(&base, bases + f * sizeof(int32_t), sizeof(base));
+      size_t const first = f * frame_size;
+      size_t const len = std::min(frame_size, num_values - first);
+      unpack_frame(packed + offset[f], widths[f], base, len, out + first);
+    }
+  });
+  return true;
+}
+
+} // namespace Int_Codec
+} // namespace Ume
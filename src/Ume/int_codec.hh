@@ -0,0 +1,62 @@
+/*
+  Copyright (c) 2023, Triad National Security, LLC. All rights reserved.
+
+  This is open source software; you can redistribute it and/or modify it under
+  the terms of the BSD-3 License. If software is modified to produce derivative
+  works, such modified software should be clearly marked, so as not to confuse
+  it with the version available from LANL. Full text of the BSD-3 License can be
+  found in the LICENSE.md file, and the full assertion of copyright in the
+  NOTICE.md file.
+*/
+
+/*!
+\file Ume/int_codec.hh
+
+A compact encoding for int arrays that change slowly from one element to the
+next, such as mesh connectivity.
+
+The array is split into frames of frame_size values.  Each frame stores its
+first value, and the zigzag-encoded differences between neighboring values,
+bit-packed at the smallest width that holds the largest of them.  Every frame
+decodes independently with straight-line loops, so decoding vectorizes well
+and is split across threads.  The encoded block is:
+
+    uint64_t count                 number of values
+    int32_t  base[num_frames]      first value of each frame
+    uint8_t  width[num_frames]     bits per difference in each frame
+    packed differences             frame_size * width[f] / 8 bytes per frame
+    8 zero bytes                   so that 8-byte loads never pass the end
+*/
+
+#ifndef UME_INT_CODEC_HH
+#define UME_INT_CODEC_HH 1
+
+#include <cstddef>
+#include <string>
+
+namespace Ume {
+namespace Int_Codec {
+
+//! Values per frame
+constexpr size_t frame_size = 128;
+
+//! Encode num_values ints
+std::string encode(int const *data, size_t num_values);
+
+//! The largest number of values that an encoded block of num_bytes can hold
+size_t max_decoded_size(size_t num_bytes);
+
+//! The number of values in an encoded block, or 0 if it is malformed
+/*! The count stored in the block is checked against max_decoded_size(), so
+    that a damaged count is never used to size the output. */
+size_t decoded_size(char const *bytes, size_t num_bytes);
+
+/*! Decode a block into `out`, which holds decoded_size() values, on up to
+    num_threads threads.  Returns false if the block is malformed. */
+bool decode(
+    char const *bytes, size_t num_bytes, int *out, int num_threads = 1);
+
+} // namespace Int_Codec
+} // namespace Ume
+
+#endif
@@ -0,0 +1,105 @@
+/*
+  Copyright (c) 2023, Triad National Security, LLC. All rights reserved.
+
+  This is open source software; you can redistribute it and/or modify it under
+  the terms of the BSD-3 License. If software is modified to produce derivative
+  works, such modified software should be clearly marked, so as not to confuse
+  it with the version available from LANL. Full text of the BSD-3 License can be
+  found in the LICENSE.md file, and the full assertion of copyright in the
+  NOTICE.md file.
+*/
+
+/*!
+\file Ume/mapped_file.cc
+*/
+
+#include "Ume/mapped_file.hh"
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Ume {
+
+/* ------------------------------ Mapped_File -------------------------------*/
+
+bool Mapped_File::open(std::string const &path) {
+  close();
+  int const fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat sb;
+  if (fstat(fd, &sb) != 0 || sb.st_size <= 0) {
+    ::close(fd);
+    return false;
+  }
+  size_t const size = static_cast<size_t>(sb.st_size);
+  void *const p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd); // the mapping keeps the file open
+  if (p == MAP_FAILED)
+    return false;
+  /* The mesh readers scan each file once, front to back */
+  madvise(p, size, MADV_SEQUENTIAL);
+  madvise(p, size, MADV_WILLNEED);
+  data_ = static_cast<char *>(p);
+  size_ = size;
+  return true;
+}
+
+void Mapped_File::close() {
+  if (data_)
+    munmap(data_, size_);
+  data_ = nullptr;
+  size_ = 0;
+}
+
+void Mapped_File::drop(char const *const begin, char const *const end) const {
+  auto const page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  uintptr_t const first = (reinterpret_cast<uintptr_t>(begin) + page - 1) /
+      page * page;
+  uintptr_t const last = reinterpret_cast<uintptr_t>(end) / page * page;
+  if (first < last)
+    madvise(reinterpret_cast<void *>(first), last - first, MADV_DONTNEED);
+}
+
+/* ---------------------------- Memory_Streambuf ----------------------------*/
+
+Memory_Streambuf::Memory_Streambuf(char const *const data, size_t const size) {
+  /* The get area is never written through, despite the non-const pointer */
+  char *const p = const_cast<char *>(data);
+  setg(p, p, p + size);
+}
+
+Memory_Streambuf::pos_type Memory_Streambuf::seekoff(off_type const off,
+    std::ios_base::seekdir const dir, std::ios_base::openmode const which) {
+  if (!(which & std::ios_base::in))
+    return pos_type(off_type(-1));
+  off_type base;
+  if (dir == std::ios_base::beg)
+    base = 0;
+  else if (dir == std::ios_base::cur)
+    base = gptr() - eback();
+  else
+    base = egptr() - eback();
+  off_type const pos = base + off;
+  if (pos < 0 || pos > egptr() - eback())
+    return pos_type(off_type(-1));
+  setg(eback(), eback() + pos, egptr());
+  return pos_type(pos);
+}
+
+Memory_Streambuf::pos_type Memory_Streambuf::seekpos(
+    pos_type const pos, std::ios_base::openmode const which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+/* ----------------------------- Mapped_Istream -----------------------------*/
+
+Mapped_Istream::Mapped_Istream(std::string const &path)
+    : detail::Mapped_Istream_Base(path), std::istream(&buf) {
+  if (!file.is_open())
+    setstate(std::ios_base::failbit);
+}
+
+} // namespace Ume
@@ -0,0 +1,96 @@
+/*
+  Copyright (c) 2023, Triad National Security, LLC. All rights reserved.
+
+  This is open source software; you can redistribute it and/or modify it under
+  the terms of the BSD-3 License. If software is modified to produce derivative
+  works, such modified software should be clearly marked, so as not to confuse
+  it with the version available from LANL. Full text of the BSD-3 License can be
+  found in the LICENSE.md file, and the full assertion of copyright in the
+  NOTICE.md file.
+*/
+
+/*!
+\file Ume/mapped_file.hh
+
+Read-only memory-mapped files, and an istream over them for the binary mesh
+readers.
+*/
+
+#ifndef UME_MAPPED_FILE_HH
+#define UME_MAPPED_FILE_HH 1
+
+#include <cstddef>
+#include <istream>
+#include <streambuf>
+#include <string>
+
+namespace Ume {
+
+//! A read-only, private memory mapping of a whole file
+/*! The mapping is copy-on-write (MAP_PRIVATE), so the file is never modified
+    through it. */
+class Mapped_File {
+public:
+  Mapped_File() = default;
+  explicit Mapped_File(std::string const &path) { open(path); }
+  ~Mapped_File() { close(); }
+  Mapped_File(Mapped_File const &) = delete;
+  Mapped_File &operator=(Mapped_File const &) = delete;
+
+  //! Map a file; returns false (and leaves this closed) on failure
+  bool open(std::string const &path);
+  void close();
+  bool is_open() const { return data_ != nullptr; }
+  char const *data() const { return data_; }
+  size_t size() const { return size_; }
+
+  /*! Drop the whole pages within [begin, end) of the mapping from memory,
+      e.g. once they have been parsed.  They are read from the file again if
+      they are touched later. */
+  void drop(char const *begin, char const *end) const;
+
+private:
+  char *data_{nullptr};
+  size_t size_{0};
+};
+
+//! A streambuf that reads directly from a block of memory
+/*! istream::read on this is a single memcpy from the block, and seeking is
+    O(1). */
+class Memory_Streambuf : public std::streambuf {
+public:
+  Memory_Streambuf(char const *data, size_t size);
+
+protected:
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+      std::ios_base::openmode which) override;
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+};
+
+namespace detail {
+//! Holds the mapping so that it is constructed before the istream base
+struct Mapped_Istream_Base {
+  explicit Mapped_Istream_Base(std::string const &path)
+      : file(path), buf(file.data(), file.size()) {}
+  Mapped_File file;
+  Memory_Streambuf buf;
+};
+} // namespace detail
+
+//! An istream over a memory-mapped file
+/*! A drop-in replacement for std::ifstream in the binary mesh readers: the
+    file pages are read straight into the destination arrays, with no
+    intermediate stream buffer.  The stream is in a failed state if the
+    file could not be mapped. */
+class Mapped_Istream : private detail::Mapped_Istream_Base,
+                       public std::istream {
+public:
+  explicit Mapped_Istream(std::string const &path);
+  bool is_open() const { return file.is_open(); }
+  //! The underlying mapping
+  Mapped_File const &mapping() const { return file; }
+};
+
+} // namespace Ume
+
+#endif
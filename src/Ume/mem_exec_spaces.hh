@@ -66,6 +66,20 @@ using DefaultMemSpace = Kokkos::SYCLDeviceUSMSpace;
 using DefaultMemSpace = HostSpace;
 #endif
 
+/* Define the page-locked host memory space, for fast transfers to and from
+ * the device */
+#if defined(UME_SERIAL)
+using HostPinnedSpace = HostSpace;
+#elif defined(KOKKOS_ENABLE_CUDA)
+using HostPinnedSpace = Kokkos::CudaHostPinnedSpace;
+#elif defined(KOKKOS_ENABLE_HIP)
+using HostPinnedSpace = Kokkos::HIPHostPinnedSpace;
+#elif defined(KOKKOS_ENABLE_SYCL)
+using HostPinnedSpace = Kokkos::SYCLHostUSMSpace;
+#else
+using HostPinnedSpace = HostSpace;
+#endif
+
 /* Define the default execution spaces */
 #if defined(UME_SERIAL)
 /* Set all execution spaces to Serial */
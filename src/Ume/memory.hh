@@ -20,6 +20,17 @@
 #include "process_mgmt.hh"
 #include "utils.hh"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <thread>
+#include <vector>
+
 /* Define the memory layout */
 using MemLayout = Kokkos::LayoutRight;
 
@@ -31,46 +42,254 @@ struct DoNotCopyInit : std::false_type {};
 struct CopyInit : std::true_type {};
 } // namespace MemOpts
 
+/* A snapshot of memory pool usage, from MemoryPoolAllocation::Stats().
+ * The used part of each scratch arena counts as claimed until its
+ * ScratchScope closes. */
+struct MemoryPoolStats {
+  size_t pool_bytes = 0; // total size of the pool segments
+  size_t num_segments = 0; // number of pool segments
+  size_t direct_bytes = 0; // oversized claims allocated outside the segments
+  size_t claimed_bytes = 0; // currently claimed, including direct_bytes
+  size_t peak_bytes = 0; // high-water mark of claimed_bytes
+  size_t num_claims = 0; // total number of successful claims
+  size_t live_claims = 0; // claims not yet released
+  size_t free_bytes = 0; // unclaimed bytes in the pool segments
+  size_t largest_free_bytes = 0; // largest claim that would currently fit
+
+  /* 0 when all free memory is contiguous, approaching 1 as it is split into
+   * many small ranges */
+  double fragmentation() const {
+    return free_bytes == 0
+        ? 0.0
+        : 1.0 -
+            static_cast<double>(largest_free_bytes) /
+                static_cast<double>(free_bytes);
+  }
+
+  void print(FILE *const out = stdout) const {
+    constexpr double MB = 1024.0 * 1024.0;
+    fprintf(out,
+        "Memory pool: %.1f MB in %zu segment(s) + %.1f MB direct, "
+        "claimed %.1f MB, peak %.1f MB\n"
+        "  claims %zu (%zu live), largest free %.1f MB of %.1f MB free, "
+        "fragmentation %.3f\n",
+        static_cast<double>(pool_bytes) / MB, num_segments,
+        static_cast<double>(direct_bytes) / MB,
+        static_cast<double>(claimed_bytes) / MB,
+        static_cast<double>(peak_bytes) / MB, num_claims, live_claims,
+        static_cast<double>(largest_free_bytes) / MB,
+        static_cast<double>(free_bytes) / MB, fragmentation());
+  }
+};
+
 template <typename MemorySpace> class MemoryPoolAllocation {
 private:
-  struct BlockClaim {
-    /* This represents a particular claim of some number of blocks of memory
-     * from the allocated pool -- block offset in pool and number of blocks in
-     * this claim. */
-    size_t start, length;
-  };
-
-  /* To avoid our vector of BlockClaims from resizing, let's reserve
-   * space for a set number of them. */
-  static constexpr unsigned num_claims_reservations = 32;
+  /* Block ranges are kept as maps from the block offset in the pool to the
+   * number of blocks in the range.  The free ranges are also indexed by
+   * (length, offset), so that both Claim (best fit) and Release (lookup and
+   * coalescing with the neighboring free ranges) are O(log n) in the number
+   * of ranges. */
+  using RangeMap = std::map<size_t, size_t>;
+  using SizeIndex = std::set<std::pair<size_t, size_t>>;
 
   using AllocFunc = std::function<void *(size_t const)>;
   using FreeFunc = std::function<void(void *)>;
 
+  /* The pool is one or more segments, each a separate allocation.  Block
+   * offsets are numbered across all of the segments, with one unused offset
+   * between consecutive segments so that free ranges never coalesce across
+   * a segment boundary. */
+  struct Segment {
+    char *ptr;
+    size_t num_blocks;
+  };
+
   AllocFunc Alloc_;
   FreeFunc Free_;
-  void *pool_;
-  size_t num_blocks_;
+  std::map<size_t, Segment> segments_; // first block offset -> segment
+  std::map<char const *, size_t> segment_offsets_; // address -> first block
+  size_t next_offset_; // first block offset of the next segment
+  size_t num_blocks_; // in all segments
   unsigned block_size_;
-  unsigned block_size_in_size_t_; // for pointer arithmetic
-  std::vector<BlockClaim> claims_;
+  size_t segment_bytes_; // size of added segments, zero if the pool is fixed
+  size_t max_bytes_; // cap on segments plus direct claims, zero for none
+  std::map<void *, size_t> direct_; // oversized claim -> number of bytes
+  size_t direct_bytes_;
+  RangeMap claims_; // block offset -> number of blocks claimed
+  RangeMap free_; // block offset -> number of free blocks
+  SizeIndex free_by_size_; // (number of free blocks, block offset)
+  std::mutex mutex_; // serializes Claim and Release
+
+  /* Scratch arena state (see ScratchScope).  Scopes belong to the thread
+   * that opens them.  While a thread has a scope open, its claims are
+   * bump-allocated from its arena, the block range [start, end), which is
+   * itself a single entry in claims_.  Claims from other threads take the
+   * normal path. */
+  struct ScratchArena {
+    size_t start = 0, end = 0, top = 0; // an empty range if none was reserved
+    std::vector<size_t> marks; // top when each open scope was opened
+    std::set<size_t> live; // block offsets of the unreleased arena claims
+  };
+  std::map<std::thread::id, ScratchArena> arenas_;
+  size_t num_claims_ = 0; // total number of successful claims
+  size_t claimed_blocks_ = 0; // blocks in live claims outside the arena
+  size_t peak_bytes_ = 0; // high-water mark of the bytes in use
+
+  void AddFree(size_t const start, size_t const length) {
+    free_.emplace(start, length);
+    free_by_size_.emplace(length, start);
+  }
+  void RemoveFree(RangeMap::iterator it) {
+    free_by_size_.erase({it->second, it->first});
+    free_.erase(it);
+  }
+
+  /* Allocate a new segment of num_blocks and make it free (caller holds the
+   * lock).  Returns false if the allocation failed. */
+  bool AddSegment(size_t const num_blocks) {
+    auto *const ptr = static_cast<char *>(Alloc_(num_blocks * block_size_));
+    if (!ptr)
+      return false;
+    segments_.emplace(next_offset_, Segment{ptr, num_blocks});
+    segment_offsets_.emplace(ptr, next_offset_);
+    AddFree(next_offset_, num_blocks);
+    next_offset_ += num_blocks + 1;
+    num_blocks_ += num_blocks;
+    return true;
+  }
+
+  /* Whether num_bytes more can be allocated under the cap */
+  bool WithinCap(size_t const num_bytes) const {
+    return max_bytes_ == 0 ||
+        SizeInBytes() + direct_bytes_ + num_bytes <= max_bytes_;
+  }
+
+  /* Claim num_blocks from the free range `fit` (caller holds the lock) */
+  size_t ClaimFrom(SizeIndex::iterator fit, size_t const num_blocks) {
+    auto const [length, start] = *fit;
+    RemoveFree(free_.find(start));
+    if (length > num_blocks)
+      AddFree(start + num_blocks, length - num_blocks);
+    claims_.emplace(start, num_blocks);
+    return start;
+  }
+
+  /* Bytes in use: live claims, the used part of the arenas, and direct
+   * claims (caller holds the lock) */
+  size_t UsedBytes() const {
+    size_t used_blocks = claimed_blocks_;
+    for (auto const &[id, arena] : arenas_)
+      used_blocks += arena.top - arena.start;
+    return used_blocks * block_size_ + direct_bytes_;
+  }
+  void UpdatePeak() { peak_bytes_ = std::max(peak_bytes_, UsedBytes()); }
+
+  /* Return the claim starting at block `start` to the free ranges (caller
+   * holds the lock).  Returns the number of blocks released. */
+  size_t ReleaseBlocks(size_t const start) {
+    auto const claim = claims_.find(start);
+    if (claim == claims_.end())
+      return 0;
+    size_t const length = claim->second;
+    size_t free_start = start;
+    size_t free_length = length;
+    claims_.erase(claim);
+
+    /* Coalesce with the free ranges on either side */
+    auto next = free_.lower_bound(start);
+    if (next != free_.begin()) {
+      auto prev = std::prev(next);
+      if (prev->first + prev->second == free_start) {
+        free_start = prev->first;
+        free_length += prev->second;
+        RemoveFree(prev);
+      }
+    }
+    if (next != free_.end() && next->first == start + length) {
+      free_length += next->second;
+      RemoveFree(next);
+    }
+    AddFree(free_start, free_length);
+    return length;
+  }
 
   void *GetPtrToOffsetInPool(size_t const block_index) const {
-    static_assert(sizeof(size_t) == sizeof(void *) &&
-            sizeof(void *) == sizeof(unsigned long),
-        "Unsupported pointer to integer conversion on this platform");
+    auto const seg = std::prev(segments_.upper_bound(block_index));
     return static_cast<void *>(
-        static_cast<size_t *>(pool_) + block_index * block_size_in_size_t_);
+        seg->second.ptr + (block_index - seg->first) * block_size_);
+  }
+
+  /* The block offset of a pointer to the start of a block in one of the
+   * segments, or std::nullopt (caller holds the lock) */
+  std::optional<size_t> GetOffsetInPool(void const *const p) const {
+    auto const *const cp = static_cast<char const *>(p);
+    auto it = segment_offsets_.upper_bound(cp);
+    if (it == segment_offsets_.begin())
+      return std::nullopt;
+    it = std::prev(it);
+    Segment const &seg = segments_.at(it->second);
+    size_t const byte_offset = static_cast<size_t>(cp - seg.ptr);
+    if (byte_offset >= seg.num_blocks * block_size_ ||
+        byte_offset % block_size_ != 0)
+      return std::nullopt;
+    return it->second + byte_offset / block_size_;
+  }
+
+  void MoveFrom(MemoryPoolAllocation &rhs) {
+    Alloc_ = rhs.Alloc_;
+    Free_ = rhs.Free_;
+    segments_ = std::move(rhs.segments_);
+    segment_offsets_ = std::move(rhs.segment_offsets_);
+    next_offset_ = rhs.next_offset_;
+    num_blocks_ = rhs.num_blocks_;
+    block_size_ = rhs.block_size_;
+    segment_bytes_ = rhs.segment_bytes_;
+    max_bytes_ = rhs.max_bytes_;
+    direct_ = std::move(rhs.direct_);
+    direct_bytes_ = rhs.direct_bytes_;
+    claims_ = std::move(rhs.claims_);
+    free_ = std::move(rhs.free_);
+    free_by_size_ = std::move(rhs.free_by_size_);
+    arenas_ = std::move(rhs.arenas_);
+    num_claims_ = rhs.num_claims_;
+    claimed_blocks_ = rhs.claimed_blocks_;
+    peak_bytes_ = rhs.peak_bytes_;
+    rhs.Nullify();
   }
 
 public:
+  /* The size of the pool segments (not including direct claims) */
   size_t SizeInBytes() const { return num_blocks_ * block_size_; }
+  /* The total number of claims made from this pool */
+  size_t NumClaims() const { return num_claims_; }
+
+  /* A consistent snapshot of the pool usage; this is thread-safe */
+  MemoryPoolStats Stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return StatsLocked();
+  }
+
+  /* Restart the high-water mark from the current usage, e.g. to measure
+   * the peak of a single phase */
+  void ResetPeak() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    peak_bytes_ = UsedBytes();
+  }
   void Nullify() {
-    pool_ = nullptr;
+    segments_.clear();
+    segment_offsets_.clear();
+    next_offset_ = 0;
     num_blocks_ = 0;
     block_size_ = 0;
-    block_size_in_size_t_ = 0;
-    claims_ = std::vector<BlockClaim>();
+    segment_bytes_ = 0;
+    max_bytes_ = 0;
+    direct_.clear();
+    direct_bytes_ = 0;
+    claims_.clear();
+    free_.clear();
+    free_by_size_.clear();
+    arenas_.clear();
+    num_claims_ = claimed_blocks_ = peak_bytes_ = 0;
   };
   MemoryPoolAllocation() { Nullify(); };
 
@@ -88,32 +307,22 @@ public:
     /* It would be nice to have error checking on block_size > 0, num_bytes > 0,
      * block_size a multiple of sizeof(size_t), etc. */
     block_size_ = block_size;
-    block_size_in_size_t_ = block_size / sizeof(size_t);
-    num_blocks_ = (num_bytes - 1) / block_size + 1;
     Alloc_ = alloc;
     Free_ = free;
-    claims_ = std::vector<BlockClaim>();
-    claims_.reserve(num_claims_reservations);
-    pool_ = Alloc_(num_blocks_ * block_size);
+    size_t const num_blocks = (num_bytes - 1) / block_size + 1;
 
-    if (!pool_) {
+    if (!AddSegment(num_blocks)) {
       printf("MemoryPoolAllocation: insufficient free memory to allocate\n"
              "  %zu bytes for %zu blocks of size %d\n",
-          num_bytes, num_blocks_, block_size_);
+          num_bytes, num_blocks, block_size_);
       Ume::error_stop("MemoryPoolAllocation failed");
     }
   } // MemoryPoolAllocation
 
   /* Only allow moving, NOT copying */
   MemoryPoolAllocation(MemoryPoolAllocation &&rhs) {
-    pool_ = rhs.pool_;
-    Alloc_ = rhs.Alloc_;
-    Free_ = rhs.Free_;
-    num_blocks_ = rhs.num_blocks_;
-    block_size_ = rhs.block_size_;
-    block_size_in_size_t_ = rhs.block_size_in_size_t_;
-    claims_ = rhs.claims_;
-    rhs.Nullify();
+    std::lock_guard<std::mutex> lock(rhs.mutex_);
+    MoveFrom(rhs);
   }
   MemoryPoolAllocation &operator=(MemoryPoolAllocation &&rhs) {
     if (this == &rhs)
@@ -121,14 +330,8 @@ public:
 
     Finalize();
 
-    pool_ = rhs.pool_;
-    Alloc_ = rhs.Alloc_;
-    Free_ = rhs.Free_;
-    num_blocks_ = rhs.num_blocks_;
-    block_size_ = rhs.block_size_;
-    block_size_in_size_t_ = rhs.block_size_in_size_t_;
-    claims_ = rhs.claims_;
-    rhs.Nullify();
+    std::scoped_lock lock(mutex_, rhs.mutex_);
+    MoveFrom(rhs);
     return *this;
   }
   MemoryPoolAllocation(MemoryPoolAllocation const &) = delete;
@@ -137,73 +340,207 @@ public:
   ~MemoryPoolAllocation() { Finalize(); }
 
   void Finalize() {
-    assert(claims_.empty());
+    assert(claims_.empty() && direct_.empty());
 
-    if (pool_)
-      Free_(pool_);
+    for (auto const &[offset, seg] : segments_)
+      Free_(seg.ptr);
 
     Nullify();
   }
 
+  /* Let the pool grow when a claim does not fit, by adding segments of
+   * segment_bytes, while the segments and direct claims total at most
+   * max_bytes (zero for no cap).  Claims larger than segment_bytes are
+   * allocated directly instead.  A segment_bytes of zero keeps the pool
+   * fixed, which is the default. */
+  void SetGrowth(size_t const segment_bytes, size_t const max_bytes = 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    segment_bytes_ = segment_bytes;
+    max_bytes_ = max_bytes;
+  }
+
+  /* Free the segments added by growth that are now entirely unclaimed.  The
+   * first segment is always kept.  Call this at safe points, e.g. between
+   * timesteps, to return memory after a phase with a high peak.  Returns the
+   * number of bytes freed. */
+  size_t Shrink() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t freed_blocks = 0;
+    for (auto seg = segments_.begin(); seg != segments_.end();) {
+      auto const range = free_.find(seg->first);
+      if (seg == segments_.begin() || range == free_.end() ||
+          range->second != seg->second.num_blocks) {
+        ++seg;
+        continue;
+      }
+      RemoveFree(range);
+      Free_(seg->second.ptr);
+      segment_offsets_.erase(seg->second.ptr);
+      freed_blocks += seg->second.num_blocks;
+      seg = segments_.erase(seg);
+    }
+    num_blocks_ -= freed_blocks;
+    return freed_blocks * block_size_;
+  }
+
   /* Claim some number of blocks from the already allocated pool.
-   * Returns pointer to location within the pool. */
+   * Returns pointer to location within the pool. Inside a ScratchScope on
+   * this thread, this is a bump allocation from the thread's scratch arena
+   * when it fits; otherwise it
+   * uses the smallest free range that fits (lowest offset on ties).  If
+   * nothing fits and growth is enabled (see SetGrowth), a new segment is
+   * added, or an oversized claim is allocated directly. This is
+   * thread-safe. */
   void *Claim(size_t const num_bytes) {
     // This is a valid usecase, but we need not get anything from the pool
     if (num_bytes == 0)
       return nullptr;
 
     size_t const num_blocks_needed = (num_bytes - 1) / block_size_ + 1;
-    // If we don't have any claims, just use the start of the pool
-    if (claims_.empty()) {
-      if (num_blocks_ >= num_blocks_needed) {
-        claims_.push_back(BlockClaim(0, num_blocks_needed));
-        return pool_;
-      }
-    } else {
-      // Try space before the first claim
-      if (claims_.front().start >= num_blocks_needed) {
-        claims_.insert(claims_.begin(), BlockClaim(0, num_blocks_needed));
-        return pool_;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (auto const it = arenas_.find(std::this_thread::get_id());
+          it != arenas_.end() &&
+          it->second.end - it->second.top >= num_blocks_needed) {
+        ScratchArena &arena = it->second;
+        size_t const start = arena.top;
+        arena.top += num_blocks_needed;
+        arena.live.insert(start);
+        num_claims_ += 1;
+        UpdatePeak();
+        return GetPtrToOffsetInPool(start);
       }
-      // Try space after last claim
-      {
-        auto pos_of_next_claim = claims_.back().start + claims_.back().length;
-        if (num_blocks_ - pos_of_next_claim > num_blocks_needed) {
-          claims_.push_back(BlockClaim(pos_of_next_claim, num_blocks_needed));
-          return GetPtrToOffsetInPool(pos_of_next_claim);
+      auto fit = free_by_size_.lower_bound({num_blocks_needed, 0});
+      if (fit == free_by_size_.end() && segment_bytes_ > 0) {
+        size_t const claim_bytes = num_blocks_needed * block_size_;
+        if (claim_bytes > segment_bytes_) {
+          void *const p =
+              WithinCap(claim_bytes) ? Alloc_(claim_bytes) : nullptr;
+          if (p) {
+            direct_.emplace(p, claim_bytes);
+            direct_bytes_ += claim_bytes;
+            num_claims_ += 1;
+            UpdatePeak();
+            return p;
+          }
+        } else if (WithinCap(segment_bytes_) &&
+            AddSegment((segment_bytes_ - 1) / block_size_ + 1)) {
+          fit = free_by_size_.lower_bound({num_blocks_needed, 0});
         }
       }
-      // Try space between claims
-
-      for (auto i = 0; i < static_cast<int>(claims_.size()) - 1; ++i) {
-        auto this_claim_end = claims_[i].start + claims_[i].length;
-        if (claims_[i + 1].start - this_claim_end > num_blocks_needed) {
-          claims_.insert(claims_.begin() + i + 1,
-              BlockClaim(this_claim_end, num_blocks_needed));
-          return GetPtrToOffsetInPool(claims_[i + 1].start);
-        }
+      if (fit != free_by_size_.end()) {
+        num_claims_ += 1;
+        claimed_blocks_ += num_blocks_needed;
+        UpdatePeak();
+        return GetPtrToOffsetInPool(ClaimFrom(fit, num_blocks_needed));
       }
     }
 
-    /* Claim doesn't fit anywhere, so we can't allocate it */
+    /* Claim doesn't fit anywhere, so we can't allocate it.  Report the pool
+     * usage, so that the pool size or its cap can be adjusted. */
+    printf("Memory pool: failed to claim %zu bytes\n", num_bytes);
+    Stats().print();
     Ume::error_stop("Memory pool cannot claim memory.");
     return nullptr;
   } // Claim
 
   /* Release some number of blocks back to the pool.
-   * Returns number of bytes released.
-   * This does not free any memory. */
+   * Returns number of bytes released (zero if p is not a claim in this pool).
+   * Claims from a scratch arena are not returned individually: they return
+   * zero here, and are reclaimed when the ScratchScope that made them
+   * closes.
+   * This only frees memory for direct (oversized) claims, and is
+   * thread-safe. */
   size_t Release(void *p) {
-    for (int i = static_cast<int>(claims_.size()) - 1; i >= 0; ++i) {
-      if (p == GetPtrToOffsetInPool(claims_[i].start)) {
-        size_t const bytes = claims_[i].length * block_size_;
-        claims_.erase(claims_.begin() + i);
-        return bytes;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto const direct = direct_.find(p); direct != direct_.end()) {
+      size_t const num_bytes = direct->second;
+      Free_(p);
+      direct_.erase(direct);
+      direct_bytes_ -= num_bytes;
+      return num_bytes;
+    }
+
+    auto const start = GetOffsetInPool(p);
+    if (!start)
+      return 0;
+    for (auto &[id, arena] : arenas_) {
+      if (*start >= arena.start && *start < arena.end) {
+        arena.live.erase(*start);
+        return 0;
       }
     }
-    return 0;
+    size_t const num_blocks = ReleaseBlocks(*start);
+    claimed_blocks_ -= num_blocks;
+    return num_blocks * block_size_;
   } // Release
 
+  /* Open a scratch scope on this thread; prefer the ScratchScope RAII
+   * class.  The thread's outermost scope reserves its arena: the best fit
+   * range of at least max_bytes.  With a max_bytes of zero, or if no range
+   * is available (e.g. the pool was never set up), no arena is reserved and
+   * claims inside the scope take the normal path.  Inner scopes share the
+   * arena of the outermost one. */
+  void PushScratchScope(size_t const max_bytes = 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ScratchArena &arena = arenas_[std::this_thread::get_id()];
+    if (arena.marks.empty() && max_bytes > 0 && block_size_ > 0) {
+      size_t const want = (max_bytes - 1) / block_size_ + 1;
+      auto fit = free_by_size_.lower_bound({want, 0});
+      if (fit != free_by_size_.end()) {
+        arena.start = arena.top = ClaimFrom(fit, want);
+        arena.end = arena.start + want;
+      }
+    }
+    arena.marks.push_back(arena.top);
+  }
+
+  /* Close this thread's innermost scratch scope, reclaiming everything
+   * claimed from the arena since it was opened.  It is an error for any of
+   * those claims to be alive.  Closing the outermost scope returns the
+   * arena to the pool. */
+  void PopScratchScope() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto const it = arenas_.find(std::this_thread::get_id());
+    assert(it != arenas_.end() && !it->second.marks.empty());
+    ScratchArena &arena = it->second;
+    size_t const mark = arena.marks.back();
+    arena.marks.pop_back();
+    if (arena.live.lower_bound(mark) != arena.live.end()) {
+      Ume::error_stop(
+          "ScratchScope closed while arrays claimed in it are still alive");
+    }
+    arena.top = mark;
+    if (arena.marks.empty()) {
+      if (arena.end > arena.start)
+        ReleaseBlocks(arena.start);
+      arenas_.erase(it);
+    }
+  }
+
+private:
+  MemoryPoolStats StatsLocked() const {
+    MemoryPoolStats stats;
+    stats.pool_bytes = SizeInBytes();
+    stats.num_segments = segments_.size();
+    stats.direct_bytes = direct_bytes_;
+    stats.claimed_bytes = UsedBytes();
+    stats.peak_bytes = peak_bytes_;
+    stats.num_claims = num_claims_;
+    stats.live_claims = claims_.size() + direct_.size();
+    size_t largest = 0;
+    for (auto const &[id, arena] : arenas_) {
+      stats.live_claims += arena.live.size();
+      if (arena.end > arena.start)
+        stats.live_claims -= 1; // the arena itself is not a user claim
+      largest = std::max(largest, arena.end - arena.top);
+    }
+    stats.free_bytes = stats.pool_bytes + direct_bytes_ - stats.claimed_bytes;
+    if (!free_by_size_.empty())
+      largest = std::max(largest, free_by_size_.rbegin()->first);
+    stats.largest_free_bytes = largest * block_size_;
+    return stats;
+  }
 }; // class MemoryPoolAllocation
 
 template <typename ViewDataType, typename MemorySpace> class LifetimeWrapper;
@@ -311,20 +648,27 @@ class LifetimeWrapper
   using Base = Kokkos::View<ViewDataType, MemLayout, MemorySpace, MemUnmanaged>;
   using ValueType = Base::value_type;
 
-  unsigned int *ref_count_ = nullptr;
+  /* The reference count is shared by all host copies of this wrapper, which
+   * may be created and destroyed on different threads. */
+  using RefCount = std::atomic<unsigned int>;
+  RefCount *ref_count_ = nullptr;
 
   KOKKOS_INLINE_FUNCTION
   bool RefCounted() const { return ref_count_ != nullptr; }
 
+  void IncrementRefCounter() {
+    if (RefCounted())
+      ref_count_->fetch_add(1, std::memory_order_relaxed);
+  }
+
   void DecrementRefCounterAndMaybeRelease() {
     if (RefCounted()) {
-      // TODO: theadsafety
-      --(*(ref_count_));
-      if (0 == *ref_count_) {
+      /* Only the thread that drops the last reference sees 1 here */
+      if (ref_count_->fetch_sub(1, std::memory_order_acq_rel) == 1) {
         MemoryPool<DefaultMemSpace>::GetInstance().Pool().Release(this->data());
         delete ref_count_;
-        ref_count_ = nullptr;
       }
+      ref_count_ = nullptr;
     }
   }
 
@@ -346,9 +690,7 @@ public:
         DevExecSpace().fence();
       }
 
-      // TODO: threadsafety
-      ref_count_ = new unsigned int;
-      *(ref_count_) = 1;
+      ref_count_ = new RefCount{1};
     }
   }
 
@@ -356,22 +698,16 @@ public:
   KOKKOS_INLINE_FUNCTION
   LifetimeWrapper(LifetimeWrapper const &rhs) : Base(rhs) {
     this->ref_count_ = rhs.ref_count_;
-    if (RefCounted()) {
-      KOKKOS_IF_ON_HOST(
-          // TODO: threadsafety
-          ++(*(this->ref_count_));)
-    }
+    KOKKOS_IF_ON_HOST(this->IncrementRefCounter();)
   }
   KOKKOS_INLINE_FUNCTION
   LifetimeWrapper &operator=(LifetimeWrapper const &rhs) {
+    if (this == &rhs)
+      return *this;
     KOKKOS_IF_ON_HOST(this->DecrementRefCounterAndMaybeRelease();)
     Base::operator=(rhs);
     this->ref_count_ = rhs.ref_count_;
-    if (RefCounted()) {
-      KOKKOS_IF_ON_HOST(
-          // TODO: threadsafety
-          ++(*(this->ref_count_));)
-    }
+    KOKKOS_IF_ON_HOST(this->IncrementRefCounter();)
     return *this;
   }
 
@@ -401,4 +737,34 @@ inline MemoryPool<DefaultMemSpace> &GetMemPool() {
   return MemoryPool<DefaultMemSpace>::GetInstance();
 }
 
+/* A scope for short-lived scratch arrays.  While a ScratchScope is alive,
+ * the claims that its thread makes from its pool (e.g. through
+ * NewArrayRank1) are bump-allocated from an arena of max_bytes, and are all
+ * returned at once when the scope is destroyed.  Claims that do not fit, and
+ * those of other threads, take the normal path.  Scopes may be nested;
+ * arrays claimed from the arena inside a scope must not outlive it.
+ *   {
+ *     ScratchScope scope(n * sizeof(double));
+ *     auto tmp = NewArrayRank1<double>("tmp", n);
+ *     ...
+ *   } // tmp's memory is returned here */
+template <typename MemorySpace = DefaultMemSpace> class ScratchScope {
+public:
+  explicit ScratchScope(size_t const max_bytes = 0)
+      : ScratchScope(
+            MemoryPool<MemorySpace>::GetInstance().Pool(), max_bytes) {}
+  explicit ScratchScope(
+      MemoryPoolAllocation<MemorySpace> &pool, size_t const max_bytes = 0)
+      : pool_{pool} {
+    pool_.PushScratchScope(max_bytes);
+  }
+  ~ScratchScope() { pool_.PopScratchScope(); }
+
+  ScratchScope(ScratchScope const &) = delete;
+  ScratchScope &operator=(ScratchScope const &) = delete;
+
+private:
+  MemoryPoolAllocation<MemorySpace> &pool_;
+};
+
 #endif
@@ -0,0 +1,372 @@
+/*
+  Copyright (c) 2023, Triad National Security, LLC. All rights reserved.
+
+  This is open source software; you can redistribute it and/or modify it under
+  the terms of the BSD-3 License. If software is modified to produce derivative
+  works, such modified software should be clearly marked, so as not to confuse
+  it with the version available from LANL. Full text of the BSD-3 License can be
+  found in the LICENSE.md file, and the full assertion of copyright in the
+  NOTICE.md file.
+*/
+
+/*!
+\file Ume/mesh_sections.cc
+*/
+
+#include "Ume/mesh_sections.hh"
+#include "Ume/checksum.hh"
+#include "Ume/int_codec.hh"
+#include "Ume/process_mgmt.hh"
+#include "Ume/utils.hh"
+#include <algorithm>
+#include <cstdlib>
+#include <istream>
+#include <ostream>
+#include <unistd.h>
+
+namespace Ume {
+
+namespace {
+
+uint64_t round_up(uint64_t const n) {
+  return (n + section_alignment - 1) / section_alignment * section_alignment;
+}
+
+size_t element_size(Section_Type const type) {
+  switch (type) {
+  case Section_Type::BYTES:
+    return 1;
+  case Section_Type::INT16:
+    return 2;
+  case Section_Type::INT32:
+    return 4;
+  case Section_Type::FLOAT64:
+    return 8;
+  case Section_Type::VEC3:
+    return 24;
+  }
+  return 1;
+}
+
+[[noreturn]] void section_error(char const *what, std::string const &name) {
+  std::string const msg =
+      std::string{"Mesh file section \""} + name + "\": " + what;
+  error_stop(msg.c_str());
+  std::exit(EXIT_FAILURE); // not reached
+}
+
+} // namespace
+
+/* ----------------------------- Section_Writer -----------------------------*/
+
+void Section_Writer::add(std::string name, Section_Type const type,
+    void const *const data, size_t const num_bytes,
+    Section_Encoding const encoding) {
+  toc_.push_back(Section_Info{std::move(name), type, encoding, 0, num_bytes,
+      checksum64(data, num_bytes)});
+  if (!os_) {
+    data_.push_back(data);
+    return;
+  }
+  Section_Info &s = toc_.back();
+  s.offset = round_up(pos_);
+  char const zeros[section_alignment] = {};
+  os_->write(zeros, static_cast<std::streamsize>(s.offset - pos_));
+  os_->write(static_cast<char const *>(data),
+      static_cast<std::streamsize>(num_bytes));
+  pos_ = s.offset + s.length;
+}
+
+void Section_Writer::add_encoded(
+    std::string name, int const *const data, size_t const num_values) {
+  std::string encoded = Int_Codec::encode(data, num_values);
+  if (encoded.size() >= num_values * sizeof(int)) {
+    add(std::move(name), Section_Type::INT32, data, num_values * sizeof(int));
+    return;
+  }
+  owned_.push_back(std::move(encoded));
+  add(std::move(name), Section_Type::INT32, owned_.back().data(),
+      owned_.back().size(), Section_Encoding::INT_CODEC);
+  if (os_)
+    owned_.pop_back();
+}
+
+void Section_Writer::add_bytes(std::string name, std::string bytes) {
+  owned_.push_back(std::move(bytes));
+  add(std::move(name), Section_Type::BYTES, owned_.back().data(),
+      owned_.back().size());
+  if (os_)
+    owned_.pop_back();
+}
+
+uint64_t Section_Writer::toc_bytes() const {
+  uint64_t toc_bytes = sizeof(size_t);
+  for (auto const &s : toc_)
+    toc_bytes += sizeof(size_t) + s.name.size() + sizeof(uint32_t) +
+        3 * sizeof(uint64_t);
+  return toc_bytes;
+}
+
+void Section_Writer::write_toc(std::ostream &os) const {
+  write_bin(os, toc_.size());
+  for (auto const &s : toc_) {
+    write_bin(os, s.name);
+    write_bin(os,
+        static_cast<uint32_t>(s.type) |
+            static_cast<uint32_t>(s.encoding) << 16);
+    write_bin(os, s.offset);
+    write_bin(os, s.length);
+    write_bin(os, s.checksum);
+  }
+}
+
+void Section_Writer::write(std::ostream &os, size_t const header_bytes) {
+  /* Lay out the payloads after the TOC */
+  uint64_t pos = header_bytes + toc_bytes();
+  for (auto &s : toc_) {
+    s.offset = round_up(pos);
+    pos = s.offset + s.length;
+  }
+  write_toc(os);
+
+  char const zeros[section_alignment] = {};
+  pos = header_bytes + toc_bytes();
+  for (size_t i = 0; i < toc_.size(); ++i) {
+    os.write(zeros, static_cast<std::streamsize>(toc_[i].offset - pos));
+    os.write(static_cast<char const *>(data_[i]),
+        static_cast<std::streamsize>(toc_[i].length));
+    pos = toc_[i].offset + toc_[i].length;
+  }
+}
+
+void Section_Writer::stream(
+    std::ostream &os, size_t const header_bytes, uint64_t const toc_bytes) {
+  os_ = &os;
+  header_bytes_ = header_bytes;
+  toc_reserved_ = toc_bytes;
+  pos_ = header_bytes + toc_bytes;
+  std::string const zeros(toc_bytes, '\0');
+  os.write(zeros.data(), static_cast<std::streamsize>(toc_bytes));
+}
+
+void Section_Writer::finish() {
+  if (toc_bytes() > toc_reserved_)
+    section_error("more sections than the space reserved for the TOC", "");
+  os_->seekp(static_cast<std::streamoff>(header_bytes_));
+  write_toc(*os_);
+  os_->seekp(static_cast<std::streamoff>(pos_));
+  os_ = nullptr;
+}
+
+/* ----------------------------- Section_Reader -----------------------------*/
+
+Section_Reader::Section_Reader(
+    std::istream &is, size_t const header_bytes, int const fd)
+    : is_{is}, fd_{fd} {
+  /* The TOC is checked against the size of the file before anything is
+     sized from it, so that a damaged file is reported rather than causing a
+     huge allocation or a read past the end. */
+  auto const start = is_.tellg();
+  is_.seekg(0, std::ios::end);
+  auto const end = is_.tellg();
+  is_.seekg(start);
+  if (!is_ || start < 0 || end < 0)
+    section_error("could not find the size of the file", "");
+  uint64_t const file_bytes = static_cast<uint64_t>(end);
+
+  size_t num_sections = 0;
+  read_bin(is_, num_sections);
+  pos_ = header_bytes + sizeof(size_t);
+  if (!is_ || pos_ > file_bytes)
+    section_error("could not read the table of contents", "");
+  /* Each entry takes at least this much, with an empty name */
+  constexpr uint64_t min_entry_bytes =
+      sizeof(size_t) + sizeof(uint32_t) + 3 * sizeof(uint64_t);
+  if (num_sections > (file_bytes - pos_) / min_entry_bytes)
+    section_error("too many sections for the size of the file", "");
+  toc_.resize(num_sections);
+  for (auto &s : toc_) {
+    uint32_t type;
+    size_t name_len = 0;
+    read_bin(is_, name_len);
+    if (!is_ || pos_ + min_entry_bytes > file_bytes ||
+        name_len > file_bytes - pos_ - min_entry_bytes)
+      section_error("could not read the table of contents", "");
+    s.name.resize(name_len);
+    is_.read(s.name.data(), static_cast<std::streamsize>(name_len));
+    read_bin(is_, type);
+    read_bin(is_, s.offset);
+    read_bin(is_, s.length);
+    read_bin(is_, s.checksum);
+    if (!is_)
+      section_error("could not read the table of contents", "");
+    s.type = static_cast<Section_Type>(type & 0xffff);
+    s.encoding = static_cast<Section_Encoding>(type >> 16);
+    pos_ += min_entry_bytes + name_len;
+    if (s.offset > file_bytes || s.length > file_bytes - s.offset)
+      section_error("extends past the end of the file", s.name);
+  }
+}
+
+Section_Info const *Section_Reader::find(std::string const &name) const {
+  for (auto const &s : toc_)
+    if (s.name == name)
+      return &s;
+  return nullptr;
+}
+
+Section_Info const &Section_Reader::lookup(
+    std::string const &name, Section_Type const type) const {
+  Section_Info const *const s = find(name);
+  if (!s)
+    section_error("not found", name);
+  if (s->type != type)
+    section_error("unexpected type", name);
+  if (s->encoding == Section_Encoding::RAW) {
+    if (s->length % element_size(type) != 0)
+      section_error("unexpected length", name);
+  } else if (s->encoding != Section_Encoding::INT_CODEC ||
+      type != Section_Type::INT32) {
+    section_error("unknown encoding", name);
+  }
+  return *s;
+}
+
+size_t Section_Reader::num_elements(Section_Info const &s) {
+  if (s.encoding == Section_Encoding::RAW)
+    return s.length / element_size(s.type);
+  if (fd_ >= 0) {
+    /* Just read the count at the start of the encoded block */
+    uint64_t count = 0;
+    if (s.length < sizeof(count) ||
+        pread(fd_, &count, sizeof(count), static_cast<off_t>(s.offset)) !=
+            static_cast<ssize_t>(sizeof(count)))
+      section_error("short read", s.name);
+    if (count > Int_Codec::max_decoded_size(s.length))
+      section_error("could not decode", s.name);
+    return static_cast<size_t>(count);
+  }
+  encoded_.resize(s.length);
+  read_payload(s, encoded_.data());
+  return Int_Codec::decoded_size(encoded_.data(), encoded_.size());
+}
+
+void Section_Reader::fetch(Section_Info const &s, void *const dst) {
+  if (fd_ >= 0) {
+    deferred_.push_back({&s, dst, {}});
+  } else if (s.encoding == Section_Encoding::RAW) {
+    read_payload(s, dst);
+  } else {
+    /* num_elements() read the encoded block */
+    if (!Int_Codec::decode(encoded_.data(), encoded_.size(),
+            static_cast<int *>(dst)))
+      section_error("could not decode", s.name);
+    encoded_.clear();
+  }
+}
+
+void Section_Reader::read_payload(Section_Info const &s, void *const dst) {
+  if (fd_ >= 0) {
+    if (char const *const err = pread_payload(s, dst))
+      section_error(err, s.name);
+    return;
+  }
+  /* Skip forward over padding and unread sections, or seek back */
+  if (s.offset >= pos_)
+    is_.ignore(static_cast<std::streamsize>(s.offset - pos_));
+  else
+    is_.seekg(-static_cast<std::streamoff>(pos_ - s.offset), std::ios::cur);
+  is_.read(static_cast<char *>(dst), static_cast<std::streamsize>(s.length));
+  if (!is_)
+    section_error("short read", s.name);
+  pos_ = s.offset + s.length;
+  if (verify && checksum64(dst, s.length) != s.checksum)
+    section_error("checksum mismatch", s.name);
+}
+
+char const *Section_Reader::pread_payload(
+    Section_Info const &s, void *const dst) const {
+  char *const p = static_cast<char *>(dst);
+  size_t done = 0;
+  while (done < s.length) {
+    ssize_t const n = pread(fd_, p + done, s.length - done,
+        static_cast<off_t>(s.offset + done));
+    if (n <= 0)
+      return "short read";
+    done += static_cast<size_t>(n);
+  }
+  if (verify && checksum64(dst, s.length) != s.checksum)
+    return "checksum mismatch";
+  return nullptr;
+}
+
+size_t Section_Reader::load(int const num_threads) {
+  /* Start the largest sections first, so that they overlap the rest */
+  std::sort(deferred_.begin(), deferred_.end(),
+      [](Deferred const &a, Deferred const &b) {
+        return a.section->length > b.section->length;
+      });
+  std::vector<char const *> errors(deferred_.size(), nullptr);
+  run_tasks(num_threads, deferred_.size(), [&](size_t const i) {
+    Deferred &d = deferred_[i];
+    if (d.section->encoding == Section_Encoding::RAW) {
+      errors[i] = pread_payload(*d.section, d.dst);
+    } else {
+      d.encoded.resize(d.section->length);
+      errors[i] = pread_payload(*d.section, d.encoded.data());
+    }
+  });
+  size_t num_bytes = 0;
+  for (size_t i = 0; i < deferred_.size(); ++i) {
+    if (errors[i])
+      section_error(errors[i], deferred_[i].section->name);
+    num_bytes += deferred_[i].section->length;
+  }
+
+  /* Then decode, splitting each section across the threads */
+  for (auto &d : deferred_) {
+    if (d.section->encoding == Section_Encoding::RAW)
+      continue;
+    if (!Int_Codec::decode(d.encoded.data(), d.encoded.size(),
+            static_cast<int *>(d.dst), num_threads))
+      section_error("could not decode", d.section->name);
+  }
+  deferred_.clear();
+  return num_bytes;
+}
+
+Section_Info const *Section_Reader::check(int const num_threads) const {
+  constexpr size_t piece_bytes = size_t{1} << 20;
+  std::vector<char> bad(toc_.size(), 0);
+  run_tasks(num_threads, toc_.size(), [&](size_t const i) {
+    Section_Info const &s = toc_[i];
+    std::vector<char> piece(std::min<uint64_t>(s.length, piece_bytes));
+    Checksum sum;
+    uint64_t done = 0;
+    while (done < s.length) {
+      size_t const want = std::min<uint64_t>(s.length - done, piece_bytes);
+      ssize_t const n =
+          pread(fd_, piece.data(), want, static_cast<off_t>(s.offset + done));
+      if (n <= 0) {
+        bad[i] = 1;
+        return;
+      }
+      sum.update(piece.data(), static_cast<size_t>(n));
+      done += static_cast<uint64_t>(n);
+    }
+    bad[i] = sum.value() != s.checksum;
+  });
+  for (size_t i = 0; i < toc_.size(); ++i)
+    if (bad[i])
+      return &toc_[i];
+  return nullptr;
+}
+
+std::string Section_Reader::read_bytes(std::string const &name) {
+  Section_Info const &s = lookup(name, Section_Type::BYTES);
+  std::string bytes(s.length, '\0');
+  read_payload(s, bytes.data());
+  return bytes;
+}
+
+} // namespace Ume
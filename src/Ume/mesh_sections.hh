@@ -0,0 +1,224 @@
+/*
+  Copyright (c) 2023, Triad National Security, LLC. All rights reserved.
+
+  This is open source software; you can redistribute it and/or modify it under
+  the terms of the BSD-3 License. If software is modified to produce derivative
+  works, such modified software should be clearly marked, so as not to confuse
+  it with the version available from LANL. Full text of the BSD-3 License can be
+  found in the LICENSE.md file, and the full assertion of copyright in the
+  NOTICE.md file.
+*/
+
+/*!
+\file Ume/mesh_sections.hh
+
+The sectioned binary layout used by UME_VERSION_3 mesh files.
+
+A version 3 file is the `int` version tag, followed by a table of contents
+(TOC), followed by the section payloads:
+
+    int      ivtag                  (UME_VERSION_3)
+    size_t   num_sections
+    num_sections times:
+      string   name                 (write_bin format)
+      uint32_t type                 (Section_Type | Section_Encoding << 16)
+      uint64_t offset               (bytes from the start of the file)
+      uint64_t length               (bytes)
+      uint64_t checksum             (checksum64 of the payload)
+    payloads, each starting on a section_alignment boundary
+
+Array payloads are the raw elements with no length prefix or sentinels, so
+any section can be read on its own by seeking to its offset.  Optionally, INT32
+arrays are stored encoded with Int_Codec; the length and checksum are then
+those of the encoded bytes.
+*/
+
+#ifndef UME_MESH_SECTIONS_HH
+#define UME_MESH_SECTIONS_HH 1
+
+#include "Ume/VecN.hh"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace Ume {
+
+//! Payloads start on this byte boundary
+constexpr size_t section_alignment = 64;
+
+//! The element type of a section payload
+enum class Section_Type : uint32_t {
+  BYTES, //!< Opaque bytes, such as write_bin-encoded metadata
+  INT16,
+  INT32,
+  FLOAT64,
+  VEC3 //!< Three FLOAT64's per element
+};
+
+//! How a section payload is stored
+enum class Section_Encoding : uint16_t {
+  RAW, //!< The elements as they are in memory
+  INT_CODEC //!< INT32 elements encoded with Int_Codec
+};
+
+//! The Section_Type for an element type
+template <class T> constexpr Section_Type section_type();
+template <> constexpr Section_Type section_type<char>() {
+  return Section_Type::BYTES;
+}
+template <> constexpr Section_Type section_type<short>() {
+  return Section_Type::INT16;
+}
+template <> constexpr Section_Type section_type<int>() {
+  return Section_Type::INT32;
+}
+template <> constexpr Section_Type section_type<double>() {
+  return Section_Type::FLOAT64;
+}
+template <> constexpr Section_Type section_type<VecN<double, 3>>() {
+  static_assert(sizeof(VecN<double, 3>) == 3 * sizeof(double));
+  return Section_Type::VEC3;
+}
+
+//! One entry in the table of contents
+struct Section_Info {
+  std::string name;
+  Section_Type type;
+  Section_Encoding encoding;
+  uint64_t offset;
+  uint64_t length;
+  uint64_t checksum;
+};
+
+//! Collect sections, then write them with a TOC
+/*! Array sections refer to the caller's data, which must stay unchanged until
+    write() is called.
+
+    Alternatively, after stream(), each section is written as soon as it is
+    added, so that the caller can release its data at once, and finish()
+    fills in the TOC.  The output is the same as from write(). */
+class Section_Writer {
+public:
+  //! Add a section holding the elements of `data`
+  template <class T, class A>
+  void add(std::string name, std::vector<T, A> const &data) {
+    if constexpr (std::is_same_v<T, int>) {
+      if (compress) {
+        add_encoded(std::move(name), data.data(), data.size());
+        return;
+      }
+    }
+    add(std::move(name), section_type<T>(), data.data(),
+        data.size() * sizeof(T));
+  }
+  //! Add a BYTES section holding a copy of `bytes`
+  void add_bytes(std::string name, std::string bytes);
+
+  /*! Write the TOC and the payloads.  The caller has already written the
+      first `header_bytes` bytes of the file (the version tag). */
+  void write(std::ostream &os, size_t header_bytes);
+
+  //! The size of the TOC for the sections added so far
+  uint64_t toc_bytes() const;
+  /*! Write each section to the seekable stream `os` as it is added.  The
+      caller has written `header_bytes` bytes, and `toc_bytes` is reserved
+      after them for the TOC, which finish() writes. */
+  void stream(std::ostream &os, size_t header_bytes, uint64_t toc_bytes);
+  void finish();
+
+  //! Encode INT32 sections with Int_Codec, where that makes them smaller
+  bool compress = false;
+
+private:
+  void add(std::string name, Section_Type type, void const *data,
+      size_t num_bytes, Section_Encoding encoding = Section_Encoding::RAW);
+  void add_encoded(std::string name, int const *data, size_t num_values);
+  void write_toc(std::ostream &os) const;
+
+  std::vector<Section_Info> toc_;
+  std::vector<void const *> data_;
+  //! Storage for the add_bytes sections (a deque, so pointers stay valid)
+  std::deque<std::string> owned_;
+  //! When streaming: the output, its TOC position and size, and our position
+  std::ostream *os_ = nullptr;
+  size_t header_bytes_ = 0;
+  uint64_t toc_reserved_ = 0;
+  uint64_t pos_ = 0;
+};
+
+//! Read sections from a file written by Section_Writer
+/*! Sections may be read in any order, and any subset of them may be read.
+    Reading in TOC order never seeks backwards, so non-seekable streams work
+    too.  A missing section, a type mismatch, a short read, or (when `verify`
+    is set) a checksum mismatch halts with error_stop.
+
+    Given a file descriptor for the same file, array reads are deferred: the
+    destination is sized at once, but its payload is read by load(), which
+    reads (and checks) all of the deferred sections concurrently with pread.
+    BYTES sections are still read immediately, since their contents are
+    usually needed to continue.  Encoded sections are decoded after they
+    have all been read, each on up to num_threads threads. */
+class Section_Reader {
+public:
+  /*! Read the TOC.  `is` has consumed the first `header_bytes` bytes of the
+      file (the version tag). */
+  Section_Reader(std::istream &is, size_t header_bytes, int fd = -1);
+
+  std::vector<Section_Info> const &toc() const { return toc_; }
+  //! The TOC entry for `name`, or nullptr if there is none
+  Section_Info const *find(std::string const &name) const;
+
+  //! Read a section into `data`, resizing it to fit
+  template <class T, class A>
+  void read(std::string const &name, std::vector<T, A> &data) {
+    Section_Info const &s = lookup(name, section_type<T>());
+    data.resize(num_elements(s));
+    fetch(s, data.data());
+  }
+  //! Read a BYTES section
+  std::string read_bytes(std::string const &name);
+
+  /*! Read the deferred sections on up to num_threads threads, and return the
+      number of payload bytes read. */
+  size_t load(int num_threads);
+
+  /*! Reread every payload in fixed-size pieces on up to num_threads threads,
+      and check it against its checksum without keeping it.  This needs the
+      file descriptor.  Returns the first bad section, or nullptr. */
+  Section_Info const *check(int num_threads) const;
+
+  //! Check payload checksums as they are read
+  bool verify = true;
+
+private:
+  Section_Info const &lookup(std::string const &name, Section_Type type) const;
+  size_t num_elements(Section_Info const &s);
+  //! Read (or defer reading) a section into dst, decoding it if needed
+  void fetch(Section_Info const &s, void *dst);
+  void read_payload(Section_Info const &s, void *dst);
+  //! Read a payload with pread; returns an error message or nullptr
+  char const *pread_payload(Section_Info const &s, void *dst) const;
+
+  std::istream &is_;
+  //! Our position in the file
+  uint64_t pos_;
+  std::vector<Section_Info> toc_;
+  int fd_;
+  struct Deferred {
+    Section_Info const *section;
+    void *dst;
+    //! The payload of an encoded section, before decoding
+    std::string encoded;
+  };
+  std::vector<Deferred> deferred_;
+  //! The encoded section being read from the stream
+  std::string encoded_;
+};
+
+} // namespace Ume
+
+#endif
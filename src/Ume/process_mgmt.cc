@@ -14,6 +14,7 @@
 */
 
 #include "process_mgmt.hh"
+#include "host_alloc.hh"
 #include "memory.hh"
 
 #include <charconv>
@@ -136,25 +137,49 @@ void initialize(int &argc, char *argv[]) {
 
     GetMemPool().IsPoolEnabled() = true;
 
-    /* Set pool defaults if environment variables are not set */
+    /* Set pool defaults if environment variables are not set.  The pool
+     * starts at MEMORY_POOL_SIZE_MB and grows on demand by segments of
+     * MEMORY_POOL_GROW_MB (zero for a fixed pool), up to MEMORY_POOL_MAX_MB
+     * in total (zero for no cap). */
     constexpr unsigned blockSizeBytes = 128;
-    constexpr size_t defaultSizeMB = 8000;
+    constexpr size_t defaultSizeMB = 1024;
     constexpr size_t bytesPerMB = 1024 * 1024;
 
     const size_t poolSizeMB =
         get_env_size("MEMORY_POOL_SIZE_MB").value_or(defaultSizeMB);
     const size_t poolSizeBytes = poolSizeMB * bytesPerMB;
-
-    GetMemPool().Pool() =
-        MemoryPoolAllocation<DefaultMemSpace>(poolSizeBytes, blockSizeBytes);
+    const size_t growMB =
+        get_env_size("MEMORY_POOL_GROW_MB").value_or(poolSizeMB);
+    const size_t maxMB = get_env_size("MEMORY_POOL_MAX_MB").value_or(0);
+
+    /* A host pool may be placed on huge pages (see UME_HOST_PAGES) */
+    bool huge_pool = false;
+    if constexpr (std::is_same_v<DefaultMemSpace, HostSpace>)
+      huge_pool = host_pages() != Host_Pages::DEFAULT;
+
+    if (huge_pool) {
+      Host_Pages const pages = host_pages();
+      GetMemPool().Pool() = MemoryPoolAllocation<DefaultMemSpace>(
+          poolSizeBytes, blockSizeBytes,
+          [pages](size_t const n) { return host_alloc(n, pages); },
+          [](void *p) { host_free(p); });
+    } else {
+      GetMemPool().Pool() =
+          MemoryPoolAllocation<DefaultMemSpace>(poolSizeBytes, blockSizeBytes);
+    }
+    GetMemPool().Pool().SetGrowth(growMB * bytesPerMB, maxMB * bytesPerMB);
   }
 
   ume_is_initialized = true;
 }
 
-/* First finalize the memory pool, then Kokkos */
+/* First finalize the memory pool, then Kokkos.  Setting UME_POOL_STATS to a
+ * nonzero value reports the pool usage (including its high-water mark)
+ * first, which helps in choosing MEMORY_POOL_SIZE_MB. */
 void finalize() {
   if (ume_is_initialized) {
+    if (get_env_size("UME_POOL_STATS").value_or(0) > 0)
+      GetMemPool().Pool().Stats().print();
     GetMemPool().Pool().Finalize();
     Kokkos::finalize();
   }
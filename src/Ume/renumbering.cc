@@ -14,6 +14,17 @@
 */
 
 #include "Ume/renumbering.hh"
+#include "Ume/RaggedRight.hh"
+#include "Ume/mem_exec_spaces.hh"
+#include "Ume/process_mgmt.hh"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
 
 #define INVALID_INDEX (-1)
 #define START_INDEX 0
@@ -21,11 +32,359 @@
 namespace Ume {
 
 using Mesh = SOA_Idx::Mesh;
+using Entity = SOA_Idx::Entity;
 using INTV_T = DS_Types::INTV_T;
+using Types = DS_Types::Types;
+using VEC3V_T = DS_Types::VEC3V_T;
 
 enum OPS { MIN = 1, MAX, NONE };
 typedef int Op_t;
 
+namespace {
+
+/* Reorder v so that v[xnew] = old v[x] */
+template <typename VT>
+void permute(VT &v, INTV_T const &xnew_to_x_map) {
+  VT const old(v);
+  for (size_t xnew = 0; xnew < v.size(); ++xnew)
+    v[xnew] = old[xnew_to_x_map[xnew]];
+}
+
+/* The number of bits per dimension in a curve key */
+constexpr int curve_bits = 21;
+constexpr std::uint32_t curve_max = (std::uint32_t{1} << curve_bits) - 1;
+
+/* Spread the low 21 bits of v out to every third bit */
+std::uint64_t spread_bits(std::uint64_t v) {
+  v &= curve_max;
+  v = (v | v << 32) & 0x1f00000000ffffULL;
+  v = (v | v << 16) & 0x1f0000ff0000ffULL;
+  v = (v | v << 8) & 0x100f00f00f00f00fULL;
+  v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+  v = (v | v << 2) & 0x1249249249249249ULL;
+  return v;
+}
+
+/* Map coordinates onto the grid of the curve keys.  Each dimension is
+ * scaled alike, so that the curve is not stretched. */
+class Curve_Grid {
+public:
+  Curve_Grid(VEC3V_T const &coord, int const n) {
+    Vec3 hi(0.0);
+    if (n > 0)
+      lo_ = hi = coord[0];
+    for (int i = 1; i < n; ++i) {
+      for (int d = 0; d < 3; ++d) {
+        lo_[d] = std::min(lo_[d], coord[i][d]);
+        hi[d] = std::max(hi[d], coord[i][d]);
+      }
+    }
+    double const extent =
+        std::max({hi[0] - lo_[0], hi[1] - lo_[1], hi[2] - lo_[2]});
+    scale_ = extent > 0.0 ? curve_max / extent : 0.0;
+  }
+
+  std::array<std::uint32_t, 3> operator()(Vec3 const &x) const {
+    std::array<std::uint32_t, 3> ijk;
+    for (int d = 0; d < 3; ++d) {
+      double const q = std::clamp((x[d] - lo_[d]) * scale_, 0.0,
+          static_cast<double>(curve_max));
+      ijk[d] = static_cast<std::uint32_t>(q);
+    }
+    return ijk;
+  }
+
+private:
+  Vec3 lo_{0.0};
+  double scale_;
+};
+
+/* A sort key, with the index that it belongs to as the tie-breaker */
+struct Keyed {
+  std::uint64_t key;
+  int idx;
+  bool operator<(Keyed const &rhs) const {
+    return key < rhs.key || (key == rhs.key && idx < rhs.idx);
+  }
+};
+
+/* Sort in chunks on the host execution space, then merge the chunks in
+ * pairs, doubling their width on each pass */
+void parallel_sort(std::vector<Keyed> &v) {
+  int const n = static_cast<int>(v.size());
+  int const num_chunks =
+      std::clamp(HostExecSpace().concurrency(), 1, std::max(1, n));
+  int const width = (n + num_chunks - 1) / num_chunks;
+  Kokkos::parallel_for("renumber-sort",
+      Kokkos::RangePolicy<HostExecSpace>(0, num_chunks), [&](int const c) {
+        std::sort(v.begin() + std::min(n, c * width),
+            v.begin() + std::min(n, (c + 1) * width));
+      });
+  for (int w = width; w < n; w *= 2) {
+    int const num_merges = (n + 2 * w - 1) / (2 * w);
+    Kokkos::parallel_for("renumber-merge",
+        Kokkos::RangePolicy<HostExecSpace>(0, num_merges), [&](int const m) {
+          int const lo = 2 * m * w;
+          std::inplace_merge(v.begin() + lo, v.begin() + std::min(n, lo + w),
+              v.begin() + std::min(n, lo + 2 * w));
+        });
+  }
+}
+
+/* Number the local elements of x in the order of key_of(x_idx), keeping
+ * the ghosts in place */
+template <typename KF>
+INTV_T order_by_key(Entity const &x, KF const &key_of) {
+  int const xl = x.local_size();
+  std::vector<Keyed> sorted(xl);
+  Kokkos::parallel_for("renumber-keys",
+      Kokkos::RangePolicy<HostExecSpace>(0, xl),
+      [&](int const i) { sorted[i] = Keyed{key_of(i), i}; });
+  parallel_sort(sorted);
+
+  INTV_T x_to_xnew_map(x.size());
+  Kokkos::parallel_for("renumber-order",
+      Kokkos::RangePolicy<HostExecSpace>(0, xl),
+      [&](int const i) { x_to_xnew_map[sorted[i].idx] = i; });
+  for (int x_idx : x.ghost_indices())
+    x_to_xnew_map[x_idx] = x_idx;
+  return x_to_xnew_map;
+}
+
+/* A key that groups elements by the entity y that they map to, keeping
+ * their current order within each group */
+std::uint64_t group_key(int const y_idx, int const x_idx) {
+  return std::uint64_t{static_cast<std::uint32_t>(y_idx)} << 32 |
+      static_cast<std::uint32_t>(x_idx);
+}
+
+/* The graph of the local, non-null points that share a side, in
+ * compressed rows.  The neighbors of each point are listed once each, in
+ * the order that the wavefront meets them: by iota, from p_to_as. */
+RaggedRight<int> point_graph(
+    Mesh const &mesh, RaggedRight<int> const &p_to_as) {
+  int const pl = mesh.points.local_size();
+  auto const &point_type = mesh.points.mask;
+  auto const &a_to_s_map = mesh.ds->caccess_intv("m:a>s");
+  auto const &s_to_p1_map = mesh.ds->caccess_intv("m:s>p1");
+  auto const &s_to_p2_map = mesh.ds->caccess_intv("m:s>p2");
+  auto const is_node = [&](int const p) {
+    return p >= 0 && p < pl && point_type[p] != 0;
+  };
+
+  /* Gather the other point of each side into a candidate list, keeping
+     the first of any duplicates.  This is a count/fill/unique/copy, like
+     zone_to_pt_zone. */
+  std::vector<int> counts(pl, 0);
+  Kokkos::parallel_for("renumber-graph-count",
+      Kokkos::RangePolicy<HostExecSpace>(0, pl), [&](const int p) {
+        counts[p] = is_node(p) ? p_to_as.size(p) : 0;
+      });
+  RaggedRight<int> candidates;
+  candidates.init_from_counts(counts);
+  Kokkos::parallel_for("renumber-graph-fill",
+      Kokkos::RangePolicy<HostExecSpace>(0, pl), [&](const int p) {
+        if (!is_node(p))
+          return;
+        auto row = candidates[p];
+        auto last = row.begin();
+        for (int const a : p_to_as[p]) {
+          int const s = a_to_s_map[a];
+          int sp = s_to_p1_map[s];
+          if (p == sp)
+            sp = s_to_p2_map[s];
+          if (sp != p && is_node(sp) && std::find(row.begin(), last, sp) == last)
+            *last++ = sp;
+        }
+        counts[p] = static_cast<int>(last - row.begin());
+      });
+
+  RaggedRight<int> graph;
+  graph.init_from_counts(counts);
+  Kokkos::parallel_for("renumber-graph-copy",
+      Kokkos::RangePolicy<HostExecSpace>(0, pl), [&](const int p) {
+        auto const row = candidates[p].first(counts[p]);
+        std::copy(row.begin(), row.end(), graph[p].begin());
+      });
+  return graph;
+}
+
+/* Label each point with the least point of its connected piece of the
+ * graph.  The root of each edge's larger label is hooked onto the smaller
+ * label, and then every label jumps to its root, until no edge joins two
+ * labels (Shiloach and Vishkin). */
+INTV_T point_components(RaggedRight<int> const &graph) {
+  int const pl = graph.num_rows();
+  INTV_T label(pl), next(pl);
+  Kokkos::parallel_for("renumber-cc-init",
+      Kokkos::RangePolicy<HostExecSpace>(0, pl),
+      [&](const int p) { label[p] = p; });
+
+  while (true) {
+    /* Hook.  Every label is a root, with label[root] == root. */
+    next = label;
+    int hooks = 0;
+    Kokkos::parallel_reduce("renumber-cc-hook",
+        Kokkos::RangePolicy<HostExecSpace>(0, pl),
+        [&](const int p, int &num_hooks) {
+          for (int const q : graph[p]) {
+            int const lp = label[p];
+            int const lq = label[q];
+            if (lp == lq)
+              continue;
+#if defined(UME_SERIAL)
+            next[std::max(lp, lq)] =
+                std::min(next[std::max(lp, lq)], std::min(lp, lq));
+#else
+            Kokkos::atomic_min(&next[std::max(lp, lq)], std::min(lp, lq));
+#endif
+            num_hooks += 1;
+          }
+        },
+        hooks);
+    if (hooks == 0)
+      break;
+
+    /* Jump to the roots */
+    int jumps;
+    do {
+      std::swap(label, next);
+      jumps = 0;
+      Kokkos::parallel_reduce("renumber-cc-jump",
+          Kokkos::RangePolicy<HostExecSpace>(0, pl),
+          [&](const int p, int &num_jumps) {
+            next[p] = label[label[p]];
+            if (next[p] != label[p])
+              num_jumps += 1;
+          },
+          jumps);
+    } while (jumps > 0);
+  }
+  return label;
+}
+
+/* The seed point of each connected piece: the point with the most iotas,
+ * or the least such point if there is a tie.  The pieces are listed in
+ * the same order, so that the seed of each is the unnumbered point with
+ * the most iotas once the pieces before it are numbered. */
+INTV_T wave_seeds(Mesh const &mesh, RaggedRight<int> const &p_to_as,
+    INTV_T const &label) {
+  int const pl = mesh.points.local_size();
+  auto const &point_type = mesh.points.mask;
+  std::uint32_t const last_idx = std::numeric_limits<std::uint32_t>::max();
+
+  std::vector<std::uint64_t> seed_key(pl, 0);
+  Kokkos::parallel_for("renumber-seeds",
+      Kokkos::RangePolicy<HostExecSpace>(0, pl), [&](const int p) {
+        if (point_type[p] == 0)
+          return;
+        std::uint64_t const key = group_key(p_to_as.size(p), 0) |
+            (last_idx - static_cast<std::uint32_t>(p));
+#if defined(UME_SERIAL)
+        seed_key[label[p]] = std::max(seed_key[label[p]], key);
+#else
+        Kokkos::atomic_max(&seed_key[label[p]], key);
+#endif
+      });
+
+  std::vector<Keyed> pieces;
+  for (int p : mesh.points.local_indices())
+    if (point_type[p] != 0 && label[p] == p)
+      pieces.push_back(Keyed{~seed_key[p],
+          static_cast<int>(last_idx - static_cast<std::uint32_t>(seed_key[p]))});
+  std::sort(pieces.begin(), pieces.end());
+
+  INTV_T seeds(pieces.size());
+  for (size_t i = 0; i < pieces.size(); ++i)
+    seeds[i] = pieces[i].idx;
+  return seeds;
+}
+
+/* Group the elements of x by the entity that map_name takes them to,
+ * keeping their current order within each group */
+void regroup(Mesh &mesh, Entity &x, std::string const &x_tag,
+    char const *const map_name) {
+  auto const &x_to_y_map = mesh.ds->caccess_intv(map_name);
+  INTV_T const x_to_xnew_map = order_by_key(
+      x, [&](int const i) { return group_key(x_to_y_map[i], i); });
+  reshape_entity(x, x_tag, x_to_xnew_map);
+}
+
+/* Number the local points in the order that the corners first reach
+ * them, and the rest after them, in their current order */
+INTV_T first_touch_points(Mesh const &mesh) {
+  int const pl = mesh.points.local_size();
+  auto const &c_to_p_map = mesh.ds->caccess_intv("m:c>p");
+  INTV_T p_to_pnew_map(mesh.points.size(), INVALID_INDEX);
+  int pnew = START_INDEX;
+  for (int c : mesh.corners.local_indices()) {
+    int const p = c_to_p_map[c];
+    if (p >= 0 && p < pl && INVALID_INDEX == p_to_pnew_map[p])
+      p_to_pnew_map[p] = pnew++;
+  }
+  for (int p : mesh.points.local_indices())
+    if (INVALID_INDEX == p_to_pnew_map[p])
+      p_to_pnew_map[p] = pnew++;
+  for (int p : mesh.points.ghost_indices())
+    p_to_pnew_map[p] = p;
+  return p_to_pnew_map;
+}
+
+/* The mean of |m[x] - m[x-1]| over the local x whose m are both valid */
+double mean_step(INTV_T const &x_to_y_map, int const xl) {
+  double sum = 0.0;
+  int num = 0;
+  for (int x = 1; x < xl; ++x) {
+    if (x_to_y_map[x - 1] < 0 || x_to_y_map[x] < 0)
+      continue;
+    sum += std::abs(x_to_y_map[x] - x_to_y_map[x - 1]);
+    num += 1;
+  }
+  return num > 0 ? sum / num : 0.0;
+}
+
+/* The registered strategies, by name */
+std::map<std::string, Renumber_Factory> &strategy_registry() {
+  static std::map<std::string, Renumber_Factory> registry{
+      {"wavefront", [] { return std::make_unique<Wavefront_Strategy>(); }},
+      {"hilbert",
+          [] { return std::make_unique<Curve_Strategy>(SFC_Curve::HILBERT); }},
+      {"morton",
+          [] { return std::make_unique<Curve_Strategy>(SFC_Curve::MORTON); }},
+      {"rcm", [] { return std::make_unique<RCM_Strategy>(); }},
+      {"bisection", [] { return std::make_unique<Bisection_Strategy>(); }},
+      {"bisection-l2",
+          [] { return std::make_unique<Bisection_Strategy>(1024 * 1024); }}};
+  return registry;
+}
+
+} // namespace
+
+std::unique_ptr<Renumber_Strategy> make_renumber_strategy(
+    std::string const &name) {
+  auto const &registry = strategy_registry();
+  auto const it = registry.find(name);
+  if (it == registry.end())
+    return nullptr;
+  return it->second();
+}
+
+void register_renumber_strategy(
+    std::string const &name, Renumber_Factory factory) {
+  strategy_registry()[name] = std::move(factory);
+}
+
+bool unregister_renumber_strategy(std::string const &name) {
+  return strategy_registry().erase(name) > 0;
+}
+
+std::vector<std::string> renumber_strategy_names() {
+  std::vector<std::string> names;
+  for (auto const &entry : strategy_registry())
+    names.push_back(entry.first);
+  return names;
+}
+
 /* Renumber_MeshMaps[RenumWaveMinMax]-->RenumWaveMinMax */
 void renumber_mesh(Mesh &mesh) {
   /* Broadcast each to the mesh handle. */
@@ -38,184 +397,404 @@ void renumber_mesh(Mesh &mesh) {
   renumber_a(mesh);
 }
 
-/* Renumber_P[kkpll]-->Renumb_P */
-void renumber_p(Mesh &mesh) {
-  /* Get sizes for general use. */
-  int const pll = mesh.points.size();
-  int const pgll = mesh.points.ghost_size();
-
-  /* Store new-to-old mappings for debugging/testing. After the reshape,
-   * these will represent current-to-old mappings. */
-  INTV_T p_to_pold_map(pll, INVALID_INDEX);
-  for (int p : mesh.points.all_indices())
-    p_to_pold_map[p] = p;
-
-  /* Initialize local storage for new mappings. */
-  INTV_T p_to_pnew_map(pll, INVALID_INDEX);
-  INTV_T pg_to_pgnew_map(pgll, INVALID_INDEX);
+std::uint64_t morton_key(std::array<std::uint32_t, 3> const &ijk) {
+  return spread_bits(ijk[0]) << 2 | spread_bits(ijk[1]) << 1 |
+      spread_bits(ijk[2]);
+}
 
-  { /* Renumber_PMaps[RenumWaveMinMax]-->RenumWaveMinMaxP */
-    int const all = mesh.iotas.size();
-    auto const &iota_type = mesh.iotas.mask;
-    auto const &a_to_p_map = mesh.ds->caccess_intv("m:a>p");
+std::uint64_t hilbert_key(std::array<std::uint32_t, 3> const &ijk) {
+  std::array<std::uint32_t, 3> x{
+      ijk[0] & curve_max, ijk[1] & curve_max, ijk[2] & curve_max};
+  std::uint32_t const m = std::uint32_t{1} << (curve_bits - 1);
+
+  /* Inverse undo */
+  for (std::uint32_t q = m; q > 1; q >>= 1) {
+    std::uint32_t const p = q - 1;
+    for (int i = 0; i < 3; ++i) {
+      if (x[i] & q) {
+        x[0] ^= p; // invert
+      } else {
+        std::uint32_t const t = (x[0] ^ x[i]) & p; // exchange
+        x[0] ^= t;
+        x[i] ^= t;
+      }
+    }
+  }
 
-    INTV_T p_to_a1_map(pll, INVALID_INDEX), a1_to_a2_map(all, INVALID_INDEX);
+  /* Gray encode */
+  x[1] ^= x[0];
+  x[2] ^= x[1];
+  std::uint32_t t = 0;
+  for (std::uint32_t q = m; q > 1; q >>= 1)
+    if (x[2] & q)
+      t ^= q - 1;
+  for (auto &xi : x)
+    xi ^= t;
+
+  return morton_key(x);
+}
 
-    /* Construct P->A linked list. */
-    { /* LinkedList */
-      int const al = mesh.iotas.local_size();
-      INTV_T last(pll, INVALID_INDEX);
-      int prev;
+void renumber_sfc(Mesh &mesh, SFC_Curve const curve) {
+  auto const key = (curve == SFC_Curve::HILBERT) ? hilbert_key : morton_key;
+  /* Every coordinate lies within the bounds of the points */
+  Curve_Grid const grid(
+      mesh.ds->caccess_vec3v("pcoord"), mesh.points.local_size());
+  auto const by_coord = [&](Entity &x, std::string const &x_tag,
+                            char const *const coord_name) {
+    auto const &coord = mesh.ds->caccess_vec3v(coord_name);
+    INTV_T const x_to_xnew_map =
+        order_by_key(x, [&](int const i) { return key(grid(coord[i])); });
+    reshape_entity(x, x_tag, x_to_xnew_map);
+  };
+
+  by_coord(mesh.points, "p", "pcoord");
+  by_coord(mesh.zones, "z", "zcoord");
+  regroup(mesh, mesh.sides, "s", "m:s>z");
+  regroup(mesh, mesh.corners, "c", "m:c>z");
+  by_coord(mesh.faces, "f", "fcoord");
+  by_coord(mesh.edges, "e", "ecoord");
+  regroup(mesh, mesh.iotas, "a", "m:a>s");
+}
 
-      for (int a = 0; a < al; ++a) { /* Sequential only */
-        if (iota_type[a] == 0)
-          continue;
+void renumber_rcm(Mesh &mesh) {
+  int const pl = mesh.points.local_size();
+  auto const &point_type = mesh.points.mask;
+
+  /* The graph of the local points that are joined by a local side, in
+   * compressed rows without duplicate edges */
+  INTV_T offsets(pl + 1, 0), adjacent;
+  {
+    auto const &side_type = mesh.sides.mask;
+    auto const &s_to_p1_map = mesh.ds->caccess_intv("m:s>p1");
+    auto const &s_to_p2_map = mesh.ds->caccess_intv("m:s>p2");
+    std::vector<std::pair<int, int>> edges;
+    for (int s : mesh.sides.local_indices()) {
+      if (side_type[s] == 0)
+        continue; // Ignore null sides
+      int const p1 = s_to_p1_map[s];
+      int const p2 = s_to_p2_map[s];
+      if (p1 == p2 || p1 < 0 || p2 < 0 || p1 >= pl || p2 >= pl)
+        continue;
+      if (point_type[p1] == 0 || point_type[p2] == 0)
+        continue;
+      edges.emplace_back(p1, p2);
+      edges.emplace_back(p2, p1);
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    adjacent.resize(edges.size());
+    for (size_t i = 0; i < edges.size(); ++i) {
+      offsets[edges[i].first + 1] += 1;
+      adjacent[i] = edges[i].second;
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  }
 
-        int const p = a_to_p_map[a];
-        if (INVALID_INDEX == p_to_a1_map[p]) {
-          p_to_a1_map[p] = a;
-        } else {
-          prev = last[p];
-          a1_to_a2_map[prev] = a;
+  /* Visit the neighbors of each point in order of increasing degree */
+  auto const degree = [&](int const p) { return offsets[p + 1] - offsets[p]; };
+  auto const by_degree = [&](int const a, int const b) {
+    return degree(a) < degree(b) || (degree(a) == degree(b) && a < b);
+  };
+  for (int p = 0; p < pl; ++p)
+    std::sort(adjacent.begin() + offsets[p], adjacent.begin() + offsets[p + 1],
+        by_degree);
+
+  /* Breadth-first search from root over the points that are not yet
+   * numbered.  Returns the number of levels, and leaves the points in
+   * queue, with the last level starting at queue[last_level]. */
+  INTV_T visited(pl, INVALID_INDEX), queue;
+  INTV_T p_to_pnew_map(mesh.points.size(), INVALID_INDEX);
+  int stamp = 0;
+  auto const bfs = [&](int const root, int &last_level) {
+    stamp += 1;
+    queue.assign(1, root);
+    visited[root] = stamp;
+    int num_levels = 0;
+    size_t head = 0;
+    while (head < queue.size()) {
+      last_level = static_cast<int>(head);
+      size_t const level_end = queue.size();
+      for (; head < level_end; ++head) {
+        int const p = queue[head];
+        for (int i = offsets[p]; i < offsets[p + 1]; ++i) {
+          int const q = adjacent[i];
+          if (visited[q] != stamp && INVALID_INDEX == p_to_pnew_map[q]) {
+            visited[q] = stamp;
+            queue.push_back(q);
+          }
         }
-        last[p] = a;
       }
+      num_levels += 1;
+    }
+    return num_levels;
+  };
+
+  /* Start each connected piece at the point of least degree that is not
+   * yet numbered */
+  INTV_T starts;
+  for (int p : mesh.points.local_indices())
+    if (point_type[p] != 0)
+      starts.push_back(p);
+  std::sort(starts.begin(), starts.end(), by_degree);
+
+  INTV_T order;
+  order.reserve(pl);
+  for (int const start : starts) {
+    if (INVALID_INDEX != p_to_pnew_map[start])
+      continue;
+
+    /* Find a pseudo-peripheral point (George and Liu): move to the point
+     * of least degree in the last level for as long as that makes the
+     * level structure deeper */
+    int root = start;
+    int last_level;
+    int num_levels = bfs(root, last_level);
+    while (true) {
+      int const candidate = *std::min_element(
+          queue.begin() + last_level, queue.end(), by_degree);
+      int candidate_last_level;
+      int const candidate_levels = bfs(candidate, candidate_last_level);
+      if (candidate_levels <= num_levels)
+        break;
+      root = candidate;
+      num_levels = candidate_levels;
+      last_level = candidate_last_level;
     }
 
-    /* Number of a connected to p for each p */
-    INTV_T num_a_to_p(pll, 0);
-    for (int a : mesh.iotas.local_indices()) {
-      if (iota_type[a] == 0)
-        continue;
-
-      int const p = a_to_p_map[a];
-      num_a_to_p[p] += 1;
+    /* Cuthill-McKee: the breadth-first order from the root */
+    bfs(root, last_level);
+    for (int const p : queue) {
+      p_to_pnew_map[p] = START_INDEX;
+      order.push_back(p);
     }
+  }
 
-    { /* Wave_main */
-      /* Access database */
-      auto const &point_type = mesh.points.mask;
-      auto const &a_to_s_map = mesh.ds->caccess_intv("m:a>s");
-      auto const &s_to_p1_map = mesh.ds->caccess_intv("m:s>p1");
-      auto const &s_to_p2_map = mesh.ds->caccess_intv("m:s>p2");
-      int const sll = mesh.sides.size();
+  /* Reverse the order, and number the null points last */
+  int const num_ordered = static_cast<int>(order.size());
+  for (int i = 0; i < num_ordered; ++i)
+    p_to_pnew_map[order[i]] = num_ordered - 1 - i;
+  int pnew = num_ordered;
+  for (int p : mesh.points.local_indices())
+    if (point_type[p] == 0)
+      p_to_pnew_map[p] = pnew++;
+  for (int p : mesh.points.ghost_indices())
+    p_to_pnew_map[p] = p;
 
-      /* Use simple map for ghosts. */
-      for (int pg : mesh.points.ghost_indices_offset())
-        pg_to_pgnew_map[pg] = pg;
+  { /* ReshapeP() */
+    reshape_entity(mesh.points, "p", p_to_pnew_map);
+  }
 
-      /* Count number of non-null points. We'll use this to determine
-       * if all points were considered. */
-      int totp = 0;
-      for (int p : mesh.points.local_indices()) {
-        if (point_type[p] != 0)
-          totp += 1;
+  renumber_s(mesh);
+  renumber_z(mesh);
+  renumber_f(mesh);
+  renumber_e(mesh);
+  renumber_c(mesh);
+  renumber_a(mesh);
+}
+
+void renumber_bisection(Mesh &mesh, std::size_t const block_bytes) {
+  int const zl = mesh.zones.local_size();
+  int const cl = mesh.corners.local_size();
+  auto const &zone_type = mesh.zones.mask;
+
+  /* The block size in zones, from the corner data that gradzatz reads:
+   * m:c>z, m:c>p, corner_vol and corner_csurf */
+  std::size_t const corner_bytes =
+      2 * sizeof(int) + sizeof(double) + sizeof(Vec3);
+  std::size_t const corners_per_zone =
+      zl > 0 ? std::max(1, (cl + zl - 1) / zl) : 1;
+  int const block_zones = static_cast<int>(std::max<std::size_t>(
+      1, block_bytes / (corners_per_zone * corner_bytes)));
+
+  /* Bisect the zones, keeping the null zones last */
+  INTV_T order(zl);
+  std::iota(order.begin(), order.end(), 0);
+  int const num_real = static_cast<int>(
+      std::stable_partition(order.begin(), order.end(),
+          [&](int const z) { return zone_type[z] != 0; }) -
+      order.begin());
+  {
+    auto const &zcoord = mesh.ds->caccess_vec3v("zcoord");
+    std::vector<std::pair<int, int>> pending{{0, num_real}};
+    while (!pending.empty()) {
+      auto const [lo, hi] = pending.back();
+      pending.pop_back();
+      auto const first = order.begin() + lo;
+      auto const last = order.begin() + hi;
+      if (hi - lo <= block_zones) {
+        std::sort(first, last);
+        continue;
       }
 
-      /* Find first seed point */
-      int pseed;
-      { /* Wave_seed */
-        pseed = 0;
-        int max_s = 0, num_s;
-
-        /* Take as the seed point the inactive point with the maximum
-         * number of surrounding sides. */
-        for (int p : mesh.points.local_indices()) {
-          if (point_type[p] == 0)
-            continue;
-
-          num_s = num_a_to_p[p];
-          if (num_s > max_s && INVALID_INDEX == p_to_pnew_map[p]) {
-            pseed = p;
-            max_s = num_s;
-          }
+      /* Split at the median along the longest side of the bounding box */
+      Vec3 zmin = zcoord[*first], zmax = zcoord[*first];
+      for (auto it = first; it != last; ++it) {
+        for (int d = 0; d < 3; ++d) {
+          zmin[d] = std::min(zmin[d], zcoord[*it][d]);
+          zmax[d] = std::max(zmax[d], zcoord[*it][d]);
         }
       }
+      int axis = 0;
+      for (int d = 1; d < 3; ++d)
+        if (zmax[d] - zmin[d] > zmax[axis] - zmin[axis])
+          axis = d;
+      int const mid = lo + (hi - lo) / 2;
+      std::nth_element(
+          first, order.begin() + mid, last, [&](int const a, int const b) {
+            return zcoord[a][axis] < zcoord[b][axis] ||
+                (zcoord[a][axis] == zcoord[b][axis] && a < b);
+          });
+      pending.emplace_back(mid, hi);
+      pending.emplace_back(lo, mid);
+    }
+  }
 
-      /* Load the first point into the front. */
-      INTV_T currfront_p(pll, START_INDEX);
-      currfront_p[START_INDEX] = pseed;
-      int pnew = INVALID_INDEX;
-
-      /* Loop until wavefront has encountered all points. This will be
-       * true when the number of points in the current front is zero. */
-      INTV_T newfront_p(pll, START_INDEX), side_tag(sll, 0);
-      int num_p_currfront = 1;
-      while (num_p_currfront > 0) {
-        int num_p_newfront = 0;
-        int p_newfront_idx = INVALID_INDEX;
-        for (int ip = START_INDEX; ip < num_p_currfront; ++ip) {
-          int const p = currfront_p[ip];
-
-          /* Loop over all a connected to p. */
-          int a = p_to_a1_map[p];
-          while (a != INVALID_INDEX) {
-            /* Only treat each side once. */
-            int const s = a_to_s_map[a];
-            if (side_tag[s] == 1) {
-              a = a1_to_a2_map[a];
-              continue;
-            }
-
-            /* Fetch the other point and add it to the next front if it
-             * has not been encountered. */
-            int sp = s_to_p1_map[s];
-            if (p == sp)
-              sp = s_to_p2_map[s];
-            if (INVALID_INDEX == p_to_pnew_map[sp]) {
-              num_p_newfront += 1;
-              p_newfront_idx += 1;
-              newfront_p[p_newfront_idx] = sp;
-              pnew += 1;
-              p_to_pnew_map[sp] = pnew;
-            }
-
-            side_tag[s] = 1;
-            a = a1_to_a2_map[a];
-          }
-        }
+  INTV_T z_to_znew_map(mesh.zones.size(), INVALID_INDEX);
+  for (int i = 0; i < zl; ++i)
+    z_to_znew_map[order[i]] = i;
+  for (int z : mesh.zones.ghost_indices())
+    z_to_znew_map[z] = z;
 
-        /* Rebuild the front for the next pass. */
-        for (int ip = 0; ip < num_p_newfront; ++ip)
-          currfront_p[ip] = newfront_p[ip];
-        num_p_currfront = num_p_newfront;
-
-        /* If there is a slideline or if the sub-domain is
-         * discontiguous, an advancing wavefront will be required for
-         * each disjoint piece. */
-        if (num_p_currfront == 0 && (pnew + 1) != totp) {
-          /* Find a new seed point. */
-          { /* Wave_seed */
-            pseed = 0;
-            int max_s = 0, num_s;
-
-            /* Take as the seed point the inactive point with the
-             * maximum number of surrounding sides. */
-            for (int p : mesh.points.local_indices()) {
-              if (point_type[p] == 0)
-                continue;
-
-              num_s = num_a_to_p[p];
-              if (num_s > max_s && INVALID_INDEX == p_to_pnew_map[p]) {
-                pseed = p;
-                max_s = num_s;
-              }
-            }
-          }
+  { /* ReshapeZ() */
+    reshape_entity(mesh.zones, "z", z_to_znew_map);
+  }
 
-          /* Rebuild front for next pass if not finished yet. */
-          if (pseed != 0) {
-            num_p_currfront = 1;
-            currfront_p[START_INDEX] = pseed;
-            pnew += 1;
-            p_to_pnew_map[pseed] = pnew;
-          }
+  regroup(mesh, mesh.corners, "c", "m:c>z");
+  { /* ReshapeP() */
+    reshape_entity(mesh.points, "p", first_touch_points(mesh));
+  }
+  regroup(mesh, mesh.sides, "s", "m:s>z");
+  renumber_f(mesh);
+  renumber_e(mesh);
+  regroup(mesh, mesh.iotas, "a", "m:a>s");
+}
+
+Locality_Metrics locality_metrics(Mesh const &mesh) {
+  Locality_Metrics metrics;
+  int const cl = mesh.corners.local_size();
+  int const sl = mesh.sides.local_size();
+  metrics.c2p = mean_step(mesh.ds->caccess_intv("m:c>p"), cl);
+  metrics.c2z = mean_step(mesh.ds->caccess_intv("m:c>z"), cl);
+  metrics.s2z = mean_step(mesh.ds->caccess_intv("m:s>z"), sl);
+
+  auto const &side_type = mesh.sides.mask;
+  auto const &s_to_p1_map = mesh.ds->caccess_intv("m:s>p1");
+  auto const &s_to_p2_map = mesh.ds->caccess_intv("m:s>p2");
+  double sum = 0.0;
+  int num = 0;
+  for (int s = 0; s < sl; ++s) {
+    if (side_type[s] == 0 || s_to_p1_map[s] < 0 || s_to_p2_map[s] < 0)
+      continue;
+    sum += std::abs(s_to_p1_map[s] - s_to_p2_map[s]);
+    num += 1;
+  }
+  metrics.point_bandwidth = num > 0 ? sum / num : 0.0;
+  return metrics;
+}
+
+/* Renumber_P[kkpll]-->Renumb_P */
+void renumber_p(Mesh &mesh) {
+  /* Get sizes for general use. */
+  int const pll = mesh.points.size();
+  int const pl = mesh.points.local_size();
+
+  /* Initialize local storage for new mappings. */
+  INTV_T p_to_pnew_map(pll, INVALID_INDEX);
+
+  { /* Renumber_PMaps[RenumWaveMinMax]-->RenumWaveMinMaxP */
+    auto const &iota_type = mesh.iotas.mask;
+    auto const &a_to_p_map = mesh.ds->caccess_intv("m:a>p");
+
+    /* The iotas of each point, in order, and the graph of the points
+     * that they lead to. */
+    RaggedRight<int> p_to_as;
+    invert_map(
+        p_to_as, pll, mesh.iotas.local_size(),
+        [&](int const a) { return iota_type[a] == 0 ? -1 : a_to_p_map[a]; },
+        [](int const a) { return a; });
+    RaggedRight<int> const graph = point_graph(mesh, p_to_as);
+
+    /* If there is a slideline or if the sub-domain is discontiguous, an
+     * advancing wavefront will be required for each disjoint piece. */
+    INTV_T const seeds =
+        wave_seeds(mesh, p_to_as, point_components(graph));
+
+    { /* Wave_main */
+      /* Ghosts keep their numbers. */
+      for (int pg : mesh.points.ghost_indices())
+        p_to_pnew_map[pg] = pg;
+
+      /* Advance the wavefront from each seed a level at a time.  Each
+       * point of the next front is claimed by the first point of the
+       * current front that meets it, i.e. the one with the lowest new
+       * number, and is numbered in the order that its claimant meets it,
+       * so that the ordering is the same as for a serial front. */
+      INTV_T claim(pl, std::numeric_limits<int>::max());
+      INTV_T front;
+      int pnew = START_INDEX;
+      for (int const pseed : seeds) {
+        p_to_pnew_map[pseed] = pnew++;
+        front.assign(1, pseed);
+        while (!front.empty()) {
+          int const nf = static_cast<int>(front.size());
+          Kokkos::parallel_for("renumber-wave-claim",
+              Kokkos::RangePolicy<HostExecSpace>(0, nf), [&](const int i) {
+                int const p = front[i];
+                for (int const sp : graph[p]) {
+                  if (INVALID_INDEX != p_to_pnew_map[sp])
+                    continue;
+#if defined(UME_SERIAL)
+                  claim[sp] = std::min(claim[sp], p_to_pnew_map[p]);
+#else
+                  Kokkos::atomic_min(&claim[sp], p_to_pnew_map[p]);
+#endif
+                }
+              });
+
+          /* The points that each point of the front claims */
+          std::vector<int> counts(nf, 0);
+          Kokkos::parallel_for("renumber-wave-count",
+              Kokkos::RangePolicy<HostExecSpace>(0, nf), [&](const int i) {
+                int const p = front[i];
+                for (int const sp : graph[p])
+                  if (claim[sp] == p_to_pnew_map[p])
+                    counts[i] += 1;
+              });
+          RaggedRight<int> claimed;
+          claimed.init_from_counts(counts);
+          auto const offsets = claimed.row_offsets();
+          Kokkos::parallel_for("renumber-wave-number",
+              Kokkos::RangePolicy<HostExecSpace>(0, nf), [&](const int i) {
+                int const p = front[i];
+                int k = 0;
+                for (int const sp : graph[p]) {
+                  if (claim[sp] == p_to_pnew_map[p]) {
+                    claimed[i][k] = sp;
+                    p_to_pnew_map[sp] = pnew + offsets[i] + k;
+                    k += 1;
+                  }
+                }
+              });
+
+          /* Rebuild the front for the next pass. */
+          auto const next_front = claimed.values();
+          front.assign(next_front.begin(), next_front.end());
+          pnew += static_cast<int>(front.size());
+        }
+      }
+
+      /* Null points go last. */
+      for (int p : mesh.points.local_indices()) {
+        if (INVALID_INDEX == p_to_pnew_map[p]) {
+          p_to_pnew_map[p] = pnew;
+          pnew += 1;
         }
       }
     }
   }
 
   { /* ReshapeP() */
+    reshape_entity(mesh.points, "p", p_to_pnew_map);
   }
 }
 
@@ -223,18 +802,9 @@ void renumber_p(Mesh &mesh) {
 void renumber_s(Mesh &mesh) {
   /* Get sizes for general use. */
   int const sll = mesh.sides.size();
-  int const sgl = mesh.sides.ghost_local_size();
-  int const sgll = mesh.sides.ghost_size();
-
-  /* Store new-to-old mappings for debugging/testing. After the reshape,
-   * these will represent current-to-old mappings. */
-  INTV_T s_to_sold_map(sll, INVALID_INDEX);
-  for (int s : mesh.sides.all_indices())
-    s_to_sold_map[s] = s;
 
   /* Initialize local storage for new mappings. */
   INTV_T s_to_snew_map(sll, INVALID_INDEX);
-  INTV_T sg_to_sgnew_map(sgll, INVALID_INDEX);
 
   { /* Renumber_SMaps[RenumWaveMinMax]-->RenumWaveMinMaxS */
     /* Initialize new indices to current indices. */
@@ -245,17 +815,11 @@ void renumber_s(Mesh &mesh) {
     do { /* Sides_minmax */
       /* Access database. */
       auto const &side_type = mesh.sides.mask;
-      auto const &ghost_side_type = mesh.sides.ghost_mask;
       auto const &s_to_p1_map = mesh.ds->caccess_intv("m:s>p1");
       auto const &s_to_p2_map = mesh.ds->caccess_intv("m:s>p2");
-      auto const &sg_to_s_map = mesh.sides.cpy_idx;
-
-      /* Use simple map for ghosts. */
-      for (int sg : mesh.sides.ghost_indices_offset())
-        sg_to_sgnew_map[sg] = sg;
 
       /* Create new s->p mappings. */
-      INTV_T s_to_p_map_new(sll, 0);
+      INTV_T s_to_p_map_new(sll, INVALID_INDEX);
 
       /* Fill help array based on min/max point number and flag. */
       for (int s : mesh.sides.local_indices()) {
@@ -274,32 +838,16 @@ void renumber_s(Mesh &mesh) {
       }
 
       /* Generate the new numbers. */
-      int s_max = 0;
-      INTV_T snew_to_snew2_map(sll, 0);
+      INTV_T snew_to_snew2_map(sll, INVALID_INDEX);
       new_numbering(
-          mesh.sides, mesh.points, s_to_p_map_new, s_max, snew_to_snew2_map);
+          mesh.sides, mesh.points, s_to_p_map_new, snew_to_snew2_map);
 
       /* The first iteration translates X->XNEW and the second iteration
        * translates XNEW->XNEW2. The X->XNEW map contains both
        * translations X->XNEW->XNEW2. */
-      for (int s : mesh.sides.all_indices()) {
+      for (int s : mesh.sides.local_indices()) {
         int const snew = s_to_snew_map[s];
-        if (snew == 0)
-          continue;
-
-        int const snew2 = snew_to_snew2_map[snew];
-        s_to_snew_map[s] = snew2;
-      }
-
-      if (sgl > 0) { // Set new ghost indices, if there are ghosts
-        for (int sg : mesh.sides.ghost_indices_offset()) {
-          if (ghost_side_type[sg] == 0)
-            continue;
-
-          int const s = sg_to_s_map[sg];
-          s_max += 1;
-          s_to_snew_map[s] = s_max;
-        }
+        s_to_snew_map[s] = snew_to_snew2_map[snew];
       }
 
       op += 1;
@@ -312,56 +860,7 @@ void renumber_s(Mesh &mesh) {
    * the entity data have not changed, only the ordering. */
 
   { /* ReshapeS() */
-    /* Set masks to 1 or 0 depending on map value */
-    INTV_T side_type_new(sll, 0);
-    for (int s : mesh.sides.all_indices()) {
-      side_type_new[s] = std::max(0, std::min(s_to_snew_map[s], 1));
-      s_to_snew_map[s] = std::abs(s_to_snew_map[s]);
-    }
-
-    INTV_T ghost_side_type_new(sgll, 0);
-    auto const &ghost_side_type = mesh.sides.ghost_mask;
-    if (sgl > 0) {
-      for (int sg : mesh.sides.ghost_indices_offset()) {
-        if (ghost_side_type[sg] == 0)
-          continue;
-        ghost_side_type_new[sg] = std::max(0, std::min(sg_to_sgnew_map[sg], 1));
-        sg_to_sgnew_map[sg] = std::abs(sg_to_sgnew_map[sg]);
-      }
-    }
-
-    /* Update MPI stuff: upKKSSLVPELL() */
-
-    /* We must now renumber all the database maps and variables for
-     * this entity. To do this, we emulate the broadcasts to mesh
-     * entities of the form m:x>y and m:y>x along with all variables
-     * beginning with the letter x. */
-
-    /* ReshapeS[Mesh]-->(potentially lots of things) */
-
-    { /* Reshape m:y>x maps. */
-      std::vector<std::string> entity_names;
-      mesh.ds->to_entity_map_names("s", entity_names);
-
-      for (size_t x = 0; x < entity_names.size(); ++x) {
-      }
-    }
-
-    { /* Reshape m:x>y maps. */
-      std::vector<std::string> entity_names;
-      mesh.ds->from_entity_map_names("s", entity_names);
-
-      for (size_t x = 0; x < entity_names.size(); ++x) {
-      }
-    }
-
-    { /* Reshape x vars. */
-      std::vector<std::string> entity_names;
-      mesh.ds->entity_var_names("s", entity_names);
-
-      for (size_t x = 0; x < entity_names.size(); ++x) {
-      }
-    }
+    reshape_entity(mesh.sides, "s", s_to_snew_map);
   }
 }
 
@@ -369,18 +868,10 @@ void renumber_s(Mesh &mesh) {
 void renumber_z(Mesh &mesh) {
   /* Get sizes for general use. */
   int const zll = mesh.zones.size();
-  int const zgl = mesh.zones.ghost_local_size();
-  int const zgll = mesh.zones.ghost_size();
-
-  /* Store new-to-old mappings for debugging/testing. After the reshape,
-   * these will represent current-to-old mappings. */
-  INTV_T z_to_zold_map(zll, INVALID_INDEX);
-  for (int z : mesh.zones.all_indices())
-    z_to_zold_map[z] = z;
+  int const zl = mesh.zones.local_size();
 
   /* Initialize local storage for new mappings. */
   INTV_T z_to_znew_map(zll, INVALID_INDEX);
-  INTV_T zg_to_zgnew_map(zgll, INVALID_INDEX);
 
   { /* Renumber_ZMaps[RenumWaveMinMax]-->RenumWaveMinMaxZ */
     /* Initialize new indices to current indices. */
@@ -391,22 +882,17 @@ void renumber_z(Mesh &mesh) {
     do { /* Zones_minmax */
       /* Access database. */
       auto const &side_type = mesh.sides.mask;
-      auto const &ghost_zone_type = mesh.zones.ghost_mask;
       auto const &s_to_z_map = mesh.ds->caccess_intv("m:s>z");
       auto const &s_to_p1_map = mesh.ds->caccess_intv("m:s>p1");
       auto const &s_to_p2_map = mesh.ds->caccess_intv("m:s>p2");
-      auto const &zg_to_z_map = mesh.zones.cpy_idx;
-
-      /* Use simple map for ghosts. */
-      for (int zg : mesh.zones.ghost_indices_offset())
-        zg_to_zgnew_map[zg] = zg;
 
       /* Create new z->p mappings. */
-      INTV_T z_to_p_map_new(zll, 0);
+      INTV_T z_to_p_map_new(zll, INVALID_INDEX);
 
-      /* Set the initial point number for each zone to be  either zero
-       * (for max sort) or 2*kkpll (for min sort). */
-      int p = 0;
+      /* Set the initial point number for each zone to be either invalid
+       * (for max sort) or 2*kkpll (for min sort), so that zones without
+       * sides are numbered last. */
+      int p = INVALID_INDEX;
 
       if (MIN == op)
         p = 2 * mesh.points.size();
@@ -421,6 +907,9 @@ void renumber_z(Mesh &mesh) {
           continue;
 
         int const z = s_to_z_map[s];
+        if (z >= zl)
+          continue;
+
         int const p1 = s_to_p1_map[s];
         int const p2 = s_to_p2_map[s];
         int const znew = z_to_znew_map[z];
@@ -436,32 +925,16 @@ void renumber_z(Mesh &mesh) {
       }
 
       /* Generate the new numbers. */
-      int z_max = 0;
-      INTV_T znew_to_znew2_map(zll, 0);
+      INTV_T znew_to_znew2_map(zll, INVALID_INDEX);
       new_numbering(
-          mesh.zones, mesh.points, z_to_p_map_new, z_max, znew_to_znew2_map);
+          mesh.zones, mesh.points, z_to_p_map_new, znew_to_znew2_map);
 
       /* The first iteration translates X->XNEW and the second iteration
        * translates XNEW->XNEW2. The X->XNEW map contains both
        * translations X->XNEW->XNEW2. */
-      for (int z : mesh.zones.all_indices()) {
+      for (int z : mesh.zones.local_indices()) {
         int const znew = z_to_znew_map[z];
-        if (znew == 0)
-          continue;
-
-        int const znew2 = znew_to_znew2_map[znew];
-        z_to_znew_map[z] = znew2;
-      }
-
-      if (zgl > 0) { // Set new ghost indices, if there are ghosts
-        for (int zg : mesh.zones.ghost_indices_offset()) {
-          if (ghost_zone_type[zg] == 0)
-            continue;
-
-          int const z = zg_to_z_map[zg];
-          z_max += 1;
-          z_to_znew_map[z] = z_max;
-        }
+        z_to_znew_map[z] = znew_to_znew2_map[znew];
       }
 
       op += 1;
@@ -469,6 +942,7 @@ void renumber_z(Mesh &mesh) {
   }
 
   { /* ReshapeZ() */
+    reshape_entity(mesh.zones, "z", z_to_znew_map);
   }
 }
 
@@ -476,17 +950,10 @@ void renumber_z(Mesh &mesh) {
 void renumber_f(Mesh &mesh) {
   /* Get sizes for general use. */
   int const fll = mesh.faces.size();
-  int const fgll = mesh.faces.ghost_size();
-
-  /* Store new-to-old mappings for debugging/testing. After the reshape,
-   * these will represent current-to-old mappings. */
-  INTV_T f_to_fold_map(fll, INVALID_INDEX);
-  for (int f : mesh.faces.all_indices())
-    f_to_fold_map[f] = f;
+  int const fl = mesh.faces.local_size();
 
   /* Initialize local storage for new mappings. */
   INTV_T f_to_fnew_map(fll, INVALID_INDEX);
-  INTV_T fg_to_fgnew_map(fgll, INVALID_INDEX);
 
   { /* Renumber_FMaps[RenumWaveMinMax]-->RenumWaveMinMaxF */
     /* Faces get renumbered by minimum side number (only have to do it
@@ -498,10 +965,6 @@ void renumber_f(Mesh &mesh) {
       auto const &s_to_f_map = mesh.ds->caccess_intv("m:s>f");
       auto const &s_to_s2_map = mesh.ds->caccess_intv("m:s>s2");
 
-      /* Use simple map for ghosts. */
-      for (int fg : mesh.faces.ghost_indices_offset())
-        fg_to_fgnew_map[fg] = fg;
-
       /* Create new f->s mappings. */
       INTV_T f_to_s_map_new(fll, mesh.sides.size() + 1);
       for (int s : mesh.sides.local_indices()) {
@@ -509,19 +972,21 @@ void renumber_f(Mesh &mesh) {
           continue;
 
         int const f = s_to_f_map[s];
+        if (f >= fl)
+          continue;
+
         int const s2 = s_to_s2_map[s];
-        int const temp = std::min(s, s2);
+        int const temp = (s2 >= 0) ? std::min(s, s2) : s;
         f_to_s_map_new[f] = std::min(temp, f_to_s_map_new[f]);
       }
 
       /* Generate the new numbers. */
-      int f_max = 0;
-      new_numbering(
-          mesh.faces, mesh.sides, f_to_s_map_new, f_max, f_to_fnew_map);
+      new_numbering(mesh.faces, mesh.sides, f_to_s_map_new, f_to_fnew_map);
     }
   }
 
   { /* ReshapeF() */
+    reshape_entity(mesh.faces, "f", f_to_fnew_map);
   }
 }
 
@@ -529,17 +994,9 @@ void renumber_f(Mesh &mesh) {
 void renumber_e(Mesh &mesh) {
   /* Get sizes for general use. */
   int const ell = mesh.edges.size();
-  int const egll = mesh.edges.ghost_size();
-
-  /* Store new-to-old mappings for debugging/testing. After the reshape,
-   * these will represent current-to-old mappings. */
-  INTV_T e_to_eold_map(ell, INVALID_INDEX);
-  for (int e : mesh.edges.all_indices())
-    e_to_eold_map[e] = e;
 
   /* Initialize local storage for new mappings. */
   INTV_T e_to_enew_map(ell, INVALID_INDEX);
-  INTV_T eg_to_egnew_map(egll, INVALID_INDEX);
 
   { /* Renumber_EMaps[RenumWaveMinMax]-->RenumWaveMinMaxE */
     /* Initialize new indices to current indices. */
@@ -553,12 +1010,8 @@ void renumber_e(Mesh &mesh) {
       auto const &e_to_p1_map = mesh.ds->caccess_intv("m:e>p1");
       auto const &e_to_p2_map = mesh.ds->caccess_intv("m:e>p2");
 
-      /* Use simple map for ghosts. */
-      for (int eg : mesh.edges.ghost_indices_offset())
-        eg_to_egnew_map[eg] = eg;
-
       /* Create new e->p mappings. */
-      INTV_T e_to_p_map_new(ell, 0);
+      INTV_T e_to_p_map_new(ell, INVALID_INDEX);
 
       /* Fill help array based on min/max point number and flag. */
       for (int e : mesh.edges.local_indices()) {
@@ -577,21 +1030,16 @@ void renumber_e(Mesh &mesh) {
       }
 
       /* Generate the new numbers. */
-      int e_max = 0;
-      INTV_T enew_to_enew2_map(ell, 0);
+      INTV_T enew_to_enew2_map(ell, INVALID_INDEX);
       new_numbering(
-          mesh.edges, mesh.points, e_to_p_map_new, e_max, enew_to_enew2_map);
+          mesh.edges, mesh.points, e_to_p_map_new, enew_to_enew2_map);
 
       /* The first iteration translates X->XNEW and the second iteration
        * translates XNEW->XNEW2. The X->XNEW map contains both
        * translations X->XNEW->XNEW2. */
-      for (int e : mesh.edges.all_indices()) {
+      for (int e : mesh.edges.local_indices()) {
         int const enew = e_to_enew_map[e];
-        if (enew == 0)
-          continue;
-
-        int const enew2 = enew_to_enew2_map[enew];
-        e_to_enew_map[e] = enew2;
+        e_to_enew_map[e] = enew_to_enew2_map[enew];
       }
 
       op += 1;
@@ -599,108 +1047,161 @@ void renumber_e(Mesh &mesh) {
   }
 
   { /* ReshapeE() */
+    reshape_entity(mesh.edges, "e", e_to_enew_map);
   }
 }
 
 /* Renumber_C[kkcll]-->Renumb_C */
 void renumber_c(Mesh &mesh) {
-  /* Get sizes for general use. */
-  int const cll = mesh.corners.size();
-  int const cgl = mesh.corners.ghost_local_size();
-  int const cgll = mesh.corners.ghost_size();
-
-  /* Store new-to-old mappings for debugging/testing. After the reshape,
-   * these will represent current-to-old mappings. */
-  INTV_T c_to_cold_map(cll, INVALID_INDEX);
-  for (int c : mesh.corners.all_indices())
-    c_to_cold_map[c] = c;
-
   /* Initialize local storage for new mappings. */
-  INTV_T c_to_cnew_map(cll, INVALID_INDEX);
-  INTV_T cg_to_cgnew_map(cgll, INVALID_INDEX);
+  INTV_T c_to_cnew_map(mesh.corners.size(), INVALID_INDEX);
 
   { /* Renumber_CMaps[RenumWaveMinMax]-->RenumWaveMinMaxC */
     /* Renumber corners based on point number. */
     { /* Corner_minmax */
       /* Access database. */
       auto const &c_to_p_map = mesh.ds->caccess_intv("m:c>p");
-      auto const &ghost_corner_type = mesh.corners.ghost_mask;
-      auto const &cg_to_c_map = mesh.corners.cpy_idx;
-
-      /* Use simple map for ghosts. */
-      for (int cg : mesh.corners.ghost_indices_offset())
-        cg_to_cgnew_map[cg] = cg;
 
       /* Generate the new numbers. */
-      int c_max = 0;
-      new_numbering(
-          mesh.corners, mesh.points, c_to_p_map, c_max, c_to_cnew_map);
-
-      if (cgl > 0) { // Set new ghost indices, if there are ghosts
-        for (int cg : mesh.corners.ghost_indices_offset()) {
-          if (ghost_corner_type[cg] == 0)
-            continue;
-
-          int const c = cg_to_c_map[cg];
-          c_max += 1;
-          c_to_cnew_map[c] = c_max;
-        }
-      }
+      new_numbering(mesh.corners, mesh.points, c_to_p_map, c_to_cnew_map);
     }
   }
 
   { /* ReshapeC() */
+    reshape_entity(mesh.corners, "c", c_to_cnew_map);
   }
 }
 
 /* Renumber_A[kkall]-->Renumb_A */
 void renumber_a(Mesh &mesh) {
-  /* Get sizes for general use. */
-  int const all = mesh.iotas.size();
-  int const agl = mesh.iotas.ghost_local_size();
-  int const agll = mesh.iotas.ghost_size();
-
-  /* Store new-to-old mappings for debugging/testing. After the reshape,
-   * these will represent current-to-old mappings. */
-  INTV_T a_to_aold_map(all, INVALID_INDEX);
-  for (int a : mesh.iotas.all_indices())
-    a_to_aold_map[a] = a;
-
   /* Initialize local storage for new mappings. */
-  INTV_T a_to_anew_map(all, INVALID_INDEX);
-  INTV_T ag_to_agnew_map(agll, INVALID_INDEX);
+  INTV_T a_to_anew_map(mesh.iotas.size(), INVALID_INDEX);
 
   { /* Renumber_AMaps[RenumWaveMinMax]-->RenumWaveMinMaxA */
     /* Renumber iotas based on point number. */
     { /* Iota_minmax */
       /* Access database. */
       auto const &a_to_p_map = mesh.ds->caccess_intv("m:a>p");
-      auto const &ghost_iota_type = mesh.iotas.ghost_mask;
-      auto const &ag_to_a_map = mesh.iotas.cpy_idx;
-
-      /* Use simple map for ghosts. */
-      for (int ag : mesh.iotas.ghost_indices_offset())
-        ag_to_agnew_map[ag] = ag;
 
       /* Generate the new numbers. */
-      int a_max = 0;
-      new_numbering(mesh.iotas, mesh.points, a_to_p_map, a_max, a_to_anew_map);
+      new_numbering(mesh.iotas, mesh.points, a_to_p_map, a_to_anew_map);
+    }
+  }
 
-      if (agl > 0) { // Set new ghost indices, if there are ghosts
-        for (int ag : mesh.iotas.ghost_indices_offset()) {
-          if (ghost_iota_type[ag] == 0)
-            continue;
+  { /* ReshapeA() */
+    reshape_entity(mesh.iotas, "a", a_to_anew_map);
+  }
+}
 
-          int const a = ag_to_a_map[ag];
-          a_max += 1;
-          a_to_anew_map[a] = a_max;
-        }
+/* ReshapeX[kkxll] */
+void reshape_entity(
+    Entity &x, std::string const &x_tag, INTV_T const &x_to_xnew_map) {
+  /* Get sizes for general use. */
+  int const xll = x.size();
+  int const xl = x.local_size();
+
+  /* Check that the new numbering is a permutation of the local entities
+   * that leaves the ghosts in place, and invert it. */
+  INTV_T xnew_to_x_map(xll, INVALID_INDEX);
+  bool valid = static_cast<int>(x_to_xnew_map.size()) == xll;
+  for (int i = 0; valid && i < xll; ++i) {
+    int const xnew = x_to_xnew_map[i];
+    valid = (i < xl) ? (xnew >= 0 && xnew < xl) : (xnew == i);
+    valid = valid && INVALID_INDEX == xnew_to_x_map[xnew];
+    if (valid)
+      xnew_to_x_map[xnew] = i;
+  }
+  if (!valid) {
+    std::string const msg = "reshape_entity: the new numbering of entity \"" +
+        x_tag + "\" is not a permutation of its local indices";
+    error_stop(msg.c_str());
+  }
+
+  { /* Update MPI stuff: upKKSSLVPELL() */
+    /* The sources of our ghosts may have been renumbered by their
+     * owners, so scatter the new numbers from the sources to the copies
+     * before the communication lists themselves are renumbered. */
+    INTV_T src_new(x_to_xnew_map);
+    x.scatter(src_new);
+    for (size_t g = 0; g < x.cpy_idx.size(); ++g)
+      x.src_idx[g] = src_new[x.cpy_idx[g]];
+
+    for (int &xi : x.cpy_idx)
+      xi = x_to_xnew_map[xi];
+    for (auto *neighbors : {&x.myCpys, &x.mySrcs})
+      for (auto &n : *neighbors)
+        for (int &xi : n.elements)
+          xi = x_to_xnew_map[xi];
+  }
+
+  for (auto &subset : x.subsets)
+    for (int &xi : subset.elements)
+      xi = x_to_xnew_map[xi];
+
+  permute(x.mask, xnew_to_x_map);
+  permute(x.comm_type, xnew_to_x_map);
+
+  /* We must now renumber all the database maps and variables for this
+   * entity. To do this, we emulate the broadcasts to mesh entities of
+   * the form m:x>y and m:y>x along with all variables beginning with
+   * the letter x. Only primary data is renumbered: derived fields are
+   * invalidated below and rebuilt on their next access. */
+  Datastore &ds = x.ds();
+
+  /* ReshapeX[Mesh]-->(potentially lots of things) */
+
+  { /* Reshape m:y>x maps. */
+    std::vector<std::string> entity_names;
+    ds.to_entity_map_names(x_tag, entity_names);
+
+    /* Values that are not valid indices of x (e.g. the bad m:c>z values
+     * at some ghost corners) are left as they are, as the inverse map
+     * builders skip them. */
+    for (auto const &name : entity_names) {
+      if (!ds.is_primary(name, Types::INTV))
+        continue;
+      for (int &xi : ds.access_intv(name.c_str())) {
+        if (xi >= 0 && xi < xll)
+          xi = x_to_xnew_map[xi];
       }
     }
   }
 
-  { /* ReshapeA() */
+  { /* Reshape m:x>y maps. */
+    std::vector<std::string> entity_names;
+    ds.from_entity_map_names(x_tag, entity_names);
+
+    for (auto const &name : entity_names) {
+      if (!ds.is_primary(name, Types::INTV))
+        continue;
+      auto &map = ds.access_intv(name.c_str());
+      if (static_cast<int>(map.size()) == xll)
+        permute(map, xnew_to_x_map);
+    }
+  }
+
+  { /* Reshape x vars. */
+    std::vector<std::string> entity_names;
+    ds.entity_var_names(x_tag, entity_names);
+
+    for (auto const &name : entity_names) {
+      if (ds.is_primary(name, Types::INTV)) {
+        auto &var = ds.access_intv(name.c_str());
+        if (static_cast<int>(var.size()) == xll)
+          permute(var, xnew_to_x_map);
+      } else if (ds.is_primary(name, Types::DBLV)) {
+        auto &var = ds.access_dblv(name.c_str());
+        if (static_cast<int>(var.size()) == xll)
+          permute(var, xnew_to_x_map);
+      } else if (ds.is_primary(name, Types::VEC3V)) {
+        auto &var = ds.access_vec3v(name.c_str());
+        if (static_cast<int>(var.size()) == xll)
+          permute(var, xnew_to_x_map);
+      }
+    }
   }
+
+  ds.invalidate_derived();
 }
 
 } // namespace Ume
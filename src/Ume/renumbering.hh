@@ -29,21 +29,160 @@
  *
  * NOTE: broadcast dispatch is sequential and follows a canonical order
  * that may not be done in parallel.
+ *
+ * Other orderings are provided as Renumber_Strategy's, which are
+ * selected by name with make_renumber_strategy():
+ *
+ *   wavefront     wavefront min/max, as above (needs iotas)
+ *   hilbert       sort along a Hilbert curve (see renumber_sfc)
+ *   morton        sort along a Morton curve (see renumber_sfc)
+ *   rcm           reverse Cuthill-McKee on the point graph, with the
+ *                 other entities ordered by min/max point number
+ *   bisection     recursive coordinate bisection of the zones into
+ *                 blocks that fit in the L1 cache (see renumber_bisection)
+ *   bisection-l2  the same, with L2-sized blocks
+ *
+ * locality_metrics() measures how well an ordering keeps related data
+ * together, so that the strategies can be compared on each machine.
 */
 #ifndef UME_RENUMBERING_HH
 #define UME_RENUMBERING_HH 1
 
 #include "Ume/SOA_Idx_Mesh.hh"
 #include "Ume/DS_Types.hh"
+#include <array>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace Ume {
 
 //! Mesh renumbering driver routine.
+/*! This is the wavefront min/max renumbering. */
 void renumber_mesh(SOA_Idx::Mesh &mesh);
 
+//! A mesh renumbering strategy
+/*! A strategy computes new orderings for the mesh entities, and applies
+ * each one with reshape_entity(). */
+class Renumber_Strategy {
+public:
+  virtual ~Renumber_Strategy() = default;
+  //! Return true if this strategy needs the iotas
+  virtual bool needs_iotas() const { return false; }
+  //! Renumber every entity of `mesh`; every rank must call this together
+  virtual void renumber(SOA_Idx::Mesh &mesh) const = 0;
+};
+
+//! Make a new Renumber_Strategy
+using Renumber_Factory = std::function<std::unique_ptr<Renumber_Strategy>()>;
+
+//! Make the strategy registered as `name`, or return nullptr
+std::unique_ptr<Renumber_Strategy> make_renumber_strategy(
+    std::string const &name);
+
+//! Register a strategy as `name`, replacing any that has that name
+void register_renumber_strategy(
+    std::string const &name, Renumber_Factory factory);
+
+//! Remove the strategy `name`; returns false if there was none
+bool unregister_renumber_strategy(std::string const &name);
+
+//! Return the names of the registered strategies
+std::vector<std::string> renumber_strategy_names();
+
+//! Wavefront min/max renumbering: renumber_mesh()
+class Wavefront_Strategy : public Renumber_Strategy {
+public:
+  bool needs_iotas() const override { return true; }
+  void renumber(SOA_Idx::Mesh &mesh) const override { renumber_mesh(mesh); }
+};
+
+//! The space-filling curves for renumber_sfc()
+enum class SFC_Curve { HILBERT, MORTON };
+
+//! Renumber the mesh along a Hilbert or Morton curve.
+/*! Points are sorted by the curve position of pcoord, zones by that of
+ * zcoord, faces by fcoord and edges by ecoord. Sides and corners are
+ * grouped by zone, and iotas by side, keeping their current order
+ * within each group. Ties are broken by the current index, so the
+ * ordering is deterministic. */
+void renumber_sfc(SOA_Idx::Mesh &mesh, SFC_Curve curve);
+
+//! Space-filling curve renumbering: renumber_sfc()
+class Curve_Strategy : public Renumber_Strategy {
+public:
+  explicit Curve_Strategy(SFC_Curve const curve) : curve_{curve} {}
+  void renumber(SOA_Idx::Mesh &mesh) const override {
+    renumber_sfc(mesh, curve_);
+  }
+
+private:
+  SFC_Curve curve_;
+};
+
+//! Renumber the mesh by reverse Cuthill-McKee on the point graph.
+/*! The graph joins the two points of each local side (m:s>p1, m:s>p2).
+ * Each connected piece is started from a pseudo-peripheral point of
+ * minimum degree, and neighbors are visited in order of increasing
+ * degree. The other entities then follow the points, as in wavefront
+ * min/max renumbering. */
+void renumber_rcm(SOA_Idx::Mesh &mesh);
+
+//! Reverse Cuthill-McKee renumbering: renumber_rcm()
+class RCM_Strategy : public Renumber_Strategy {
+public:
+  void renumber(SOA_Idx::Mesh &mesh) const override { renumber_rcm(mesh); }
+};
+
+//! Renumber the mesh by recursive coordinate bisection of the zones.
+/*! The local zones are split at the median of zcoord along the longest
+ * side of their bounding box, and then each half is split in turn, until
+ * the corner data that the gradient kernels read for a block of zones
+ * fits in `block_bytes`. The zones are numbered block by block, so every
+ * subtree of blocks (e.g. a group of L1-sized blocks that fits in L2) is
+ * contiguous too. Corners and sides are grouped by zone, points are
+ * numbered in the order that the corners first reach them, and faces,
+ * edges and iotas follow as in wavefront min/max renumbering. */
+void renumber_bisection(SOA_Idx::Mesh &mesh, std::size_t block_bytes);
+
+//! Recursive bisection renumbering: renumber_bisection()
+class Bisection_Strategy : public Renumber_Strategy {
+public:
+  explicit Bisection_Strategy(std::size_t const block_bytes = 32 * 1024)
+      : block_bytes_{block_bytes} {}
+  void renumber(SOA_Idx::Mesh &mesh) const override {
+    renumber_bisection(mesh, block_bytes_);
+  }
+
+private:
+  std::size_t block_bytes_;
+};
+
+//! Average index distances, which measure the locality of an ordering
+/*! Along a map m:x>y, this is the mean of |m[x] - m[x-1]| over the
+ * local x: how far apart the entries of y are that a loop over x
+ * touches in turn. Smaller is better. */
+struct Locality_Metrics {
+  double c2p{0.0}; //!< along m:c>p
+  double c2z{0.0}; //!< along m:c>z
+  double s2z{0.0}; //!< along m:s>z
+  //! The mean of |p1 - p2| over the local sides, which RCM reduces
+  double point_bandwidth{0.0};
+};
+
+//! Measure the locality of the current ordering of `mesh`
+Locality_Metrics locality_metrics(SOA_Idx::Mesh const &mesh);
+
 //! Get a new mesh ordering for points.
-/*! Renumber points via advancing wavefront. */
+/*! Renumber points via advancing wavefront. Each front is advanced in
+ * parallel over the graph of points that share a side, and gives the
+ * same ordering as a serial front. A new front is seeded in each
+ * connected piece of the graph, in turn, at its point with the most
+ * iotas. */
 void renumber_p(SOA_Idx::Mesh &mesh);
 
 //! Get a new mesh ordering for sides.
@@ -71,45 +210,66 @@ void renumber_c(SOA_Idx::Mesh &mesh);
 /*! Renumber iotas based on point order. */
 void renumber_a(SOA_Idx::Mesh &mesh);
 
+//! The 63-bit Morton key of a point on a 2^21 grid in each dimension
+std::uint64_t morton_key(std::array<std::uint32_t, 3> const &ijk);
+
+//! The 63-bit Hilbert key of a point on a 2^21 grid in each dimension
+/*! This uses Skilling's transform ("Programming the Hilbert curve",
+ * AIP Conf. Proc. 707, 2004) to map the point to its transposed curve
+ * index, whose bits are then interleaved as for morton_key(). */
+std::uint64_t hilbert_key(std::array<std::uint32_t, 3> const &ijk);
+
+//! Apply a new ordering to a mesh entity.
+/*! This is the ReshapeX operation. `x_to_xnew_map` must map the local
+ * elements of `x` onto a permutation of [0, x.local_size()), and each
+ * ghost to itself. The masks, communication lists and subsets of `x`
+ * are renumbered, as are the Datastore entries for it: the m:x>y maps
+ * and the x vars are permuted, and the values of the m:y>x maps are
+ * translated. Derived fields are invalidated. `x_tag` is the letter
+ * that the Datastore names use for the entity (e.g. "s" for sides).
+ *
+ * Every rank must call this together, since the new indices of ghost
+ * sources are fetched from their owners. */
+void reshape_entity(SOA_Idx::Entity &x, std::string const &x_tag,
+                    DS_Types::INTV_T const &x_to_xnew_map);
+
 //! Renumber entity X based on Y.
 /*! Assumes that Y is already renumbered smoothly, so that ordering X
- * based on Y will produce a smooth ordering of X. */
+ * based on Y will produce a smooth ordering of X. This is a stable
+ * counting sort of the local X by their Y, so the result is a
+ * permutation of [0, x.local_size()). Ghosts keep their numbers, and
+ * local X whose Y is not a valid index (e.g. null elements) are
+ * numbered after the rest, in their current order. */
 template <typename MeshEntity1, typename MeshEntity2>
 void new_numbering(MeshEntity1 const &x, MeshEntity2 const &y,
                     DS_Types::INTV_T const &x_to_y_map,
-                    int &x_max, DS_Types::INTV_T &x_to_xnew_map) {
+                    DS_Types::INTV_T &x_to_xnew_map) {
   static_assert(std::is_base_of<SOA_Idx::Entity, MeshEntity1>::value);
   static_assert(std::is_base_of<SOA_Idx::Entity, MeshEntity2>::value);
   assert(x.size() == static_cast<int>(x_to_y_map.size()));
   assert(x.size() == static_cast<int>(x_to_xnew_map.size()));
 
-  int const yl1 = y.local_size() + 1;
-  DS_Types::INTV_T storage_locations(yl1, 0);
+  /* The last bucket holds the x without a valid y. */
+  int const yll = y.size();
+  auto const bucket = [&](int const x_idx) {
+    int const y_idx = x_to_y_map[x_idx];
+    return (y_idx < 0 || y_idx >= yll) ? yll : y_idx;
+  };
+  DS_Types::INTV_T storage_locations(yll + 2, 0);
 
-  auto const &x_type = x.mask;
   /* Count x attached to each y. */
-  for (int x_idx : x.local_indices()) {
-    if (x_type[x_idx] == 0)
-      continue;
-
-    int const y_idx = x_to_y_map[x_idx];
-    storage_locations[y_idx + 1] += 1;
-  }
+  for (int x_idx : x.local_indices())
+    storage_locations[bucket(x_idx) + 1] += 1;
 
   /* Sum storage locations. */
-  for (int y_idx : std::ranges::iota_view{1, yl1 - 1}) {
+  for (int y_idx : std::ranges::iota_view{1, yll + 2})
     storage_locations[y_idx] += storage_locations[y_idx - 1];
-  }
 
   /* Set new numbers. */
-  for (int x_idx : x.local_indices()) {
-    if (x_type[x_idx] == 0)
-      continue;
-
-    int const y_idx = x_to_y_map[x_idx];
-    x_to_xnew_map[x_idx] = storage_locations[y_idx];
-    x_max = std::max(x_max, storage_locations[y_idx]);
-  }
+  for (int x_idx : x.local_indices())
+    x_to_xnew_map[x_idx] = storage_locations[bucket(x_idx)]++;
+  for (int x_idx : x.ghost_indices())
+    x_to_xnew_map[x_idx] = x_idx;
 }
 
 } // namespace Ume
@@ -27,6 +27,8 @@
 #define EQOP(N) (ds().caccess_intv(N) == rhs.ds().caccess_intv(N))
 #define IVWRITE(N) write_bin(os, ds().caccess_intv(N))
 #define IVREAD(N) read_bin(is, ds().access_intv(N))
+#define IVSWRITE(T, N) w.add(T "/" N, ds().caccess_intv(N))
+#define IVSREAD(T, N) r.read(T "/" N, ds().access_intv(N))
 #define RESIZE(N, S) (ds().access_intv(N)).resize(S)
 
 #if TRACE_INIT
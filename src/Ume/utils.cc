@@ -13,8 +13,12 @@
   \file Ume/utils.cc
 */
 
+#include "Ume/utils.hh"
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <iostream>
+#include <thread>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -48,6 +52,28 @@ void debug_attach_point(int const mype) {
 #endif
 }
 
+void run_tasks(int const num_threads, size_t const num_tasks,
+    std::function<void(size_t)> const &task) {
+  size_t const nthreads =
+      std::min(num_tasks, static_cast<size_t>(std::max(num_threads, 1)));
+  if (nthreads <= 1) {
+    for (size_t i = 0; i < num_tasks; ++i)
+      task(i);
+    return;
+  }
+  std::atomic<size_t> next{0};
+  auto const worker = [&]() {
+    for (size_t i = next++; i < num_tasks; i = next++)
+      task(i);
+  };
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < nthreads; ++t)
+    threads.emplace_back(worker);
+  worker();
+  for (auto &t : threads)
+    t.join();
+}
+
 int init_depth(int const delta) {
   static int depth = 0;
   return depth += delta;
@@ -13,6 +13,7 @@
 \file Ume/utils.hh
 */
 
+#include <functional>
 #include <istream>
 #include <limits>
 #include <memory>
@@ -62,8 +63,8 @@ inline void read_bin<std::string>(std::istream &is, std::string &data) {
 }
 
 //! Binary write for std::vector
-template <class T>
-void write_bin(std::ostream &os, std::vector<T> const &data) {
+template <class T, class A>
+void write_bin(std::ostream &os, std::vector<T, A> const &data) {
   write_bin(os, data.size());
   if (!data.empty()) {
     os.write(reinterpret_cast<const char *>(data.data()),
@@ -73,11 +74,12 @@ void write_bin(std::ostream &os, std::vector<T> const &data) {
 }
 
 //! Binary read for std::vector
-template <class T> void read_bin(std::istream &is, std::vector<T> &data) {
+template <class T, class A>
+void read_bin(std::istream &is, std::vector<T, A> &data) {
   size_t len;
   read_bin(is, len);
   if (len == 0) {
-    std::vector<T> foo;
+    std::vector<T, A> foo;
     data.swap(foo);
   } else {
     data.resize(len);
@@ -101,6 +103,12 @@ inline std::string rtrim(const std::string &s) {
 
 inline std::string trim(const std::string &s) { return rtrim(ltrim(s)); }
 
+/*! Call task(i) for each i in [0, num_tasks) on up to num_threads threads,
+    which take the next task as they finish the last.  This is meant for
+    coarse, blocking work such as file I/O, rather than compute kernels. */
+void run_tasks(int num_threads, size_t num_tasks,
+    std::function<void(size_t)> const &task);
+
 int init_depth(int const delta);
 void debug_attach_point(int const mype);
 
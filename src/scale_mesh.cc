@@ -12,47 +12,104 @@
 /*!
   \file scale_mesh.cc
 
-  This is an example of MPI-based driver that reads one partition of an Ume
-  binary mesh into each rank, and then performs (and tests) a gradient
-  operation.
+  This is an MPI-based driver that reads one partition of an Ume binary mesh
+  into each rank, replicates it nx x ny x nz times, offsetting the copies by
+  the extent of the whole mesh in each dimension, and writes the result.
 
   Note that there must be as many *.ume files as there are MPI ranks, and they
   should have filenames of the form '<basename>.<pe>.ume', where <basename> is
   an arbitray string provided on the command line, and <pe> is a rank number
   with a printf format of "%05d" (zero-filled, five digits)
+
+  The sizes of the scaled entities are computed up front, so each array is
+  allocated once, and the replicas are filled in parallel on the host.
+
+  Replica r on every rank is a piece of the same copy of the original mesh,
+  so the copies in replica r take their values from replica r of their source
+  rank, and the neighbor lists and subsets hold each replica in turn.  With
+  MPI, the result is checked with a gathscat on each entity before it is
+  written.
+
+  The replicas are not stitched together: where two copies meet, each keeps
+  its own boundary points, edges and faces, and there is no connectivity or
+  communication between them.  The result is nx x ny x nz disjoint copies of
+  the mesh that happen to touch, each of which is consistent on its own.
 */
 
 #include "Ume/Comm_MPI.hh"
 #include "Ume/DS_Types.hh"
 #include "Ume/SOA_Idx_Mesh.hh"
+#include "Ume/Timer.hh"
+#include "Ume/mem_exec_spaces.hh"
 #include "Ume/utils.hh"
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <climits>
+#include <cmath>
 #include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#ifdef HAVE_MPI
+#include <mpi.h>
+#endif
+
+//! The number of replicas in each dimension
+using Factors = std::array<int, 3>;
 
 bool read_mesh(
     char const *const basename, int const mype, Ume::SOA_Idx::Mesh &mesh);
 
-void scale_mesh(int const scale, Ume::SOA_Idx::Mesh &mesh);
+Factors split_scale(int scale);
+
+void scale_mesh(Factors const &n, Ume::SOA_Idx::Mesh &mesh);
+
+bool check_comm(Ume::SOA_Idx::Mesh &mesh);
 
 bool write_mesh(char const *const basename, int const mype, int const scale,
     Ume::SOA_Idx::Mesh &mesh);
 
 int main(int argc, char *argv[]) {
 
-  if (argc != 3) {
+  if (argc != 3 && argc != 5) {
     std::cerr << "Usage: ./scale_mesh <input-basename> <scale-factor>"
               << std::endl;
+    std::cerr << "       ./scale_mesh <input-basename> <nx> <ny> <nz>"
+              << std::endl;
     std::cerr << "<input-basename> is the UME Input File Basename (exclude "
                  "rank number and file extension"
               << std::endl;
-    std::cerr << "<scale-factor> is the amount to scale the original mesh by. "
-                 "Only powers of 2 are valid."
+    std::cerr << "<scale-factor> is the amount to scale the original mesh by, "
+                 "which is split between the dimensions."
+              << std::endl;
+    std::cerr << "<nx> <ny> <nz> are the number of copies in each dimension."
               << std::endl;
     return 1;
   }
 
+  Factors n{1, 1, 1};
+  if (argc == 3) {
+    int const scale = atoi(argv[2]);
+    if (scale < 1) {
+      std::cerr << "Scale must be a positive integer" << std::endl;
+      return 1;
+    }
+    n = split_scale(scale);
+  } else {
+    for (int dim = 0; dim < 3; ++dim) {
+      n[dim] = atoi(argv[2 + dim]);
+      if (n[dim] < 1) {
+        std::cerr << "The factors must be positive integers" << std::endl;
+        return 1;
+      }
+    }
+  }
+  int const scale = n[0] * n[1] * n[2];
+
   Ume::SOA_Idx::Mesh mesh;
 
   int mype = 0;
@@ -62,6 +119,7 @@ int main(int argc, char *argv[]) {
 
   mype = comm.pe();
 #endif
+  Kokkos::initialize(argc, argv);
   if (mype == 0)
     std::cout << "Initializing mesh..." << std::endl;
 
@@ -70,16 +128,21 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
-  int scale = atoi(argv[2]);
-  if ((scale == 0) || ((scale & (scale - 1)) != 0)) {
-    std::cerr << "Scale must be a power of 2" << std::endl;
-    return 1;
-  }
+  if (mype == 0)
+    std::cout << "Scaling mesh by a factor of " << scale << " (" << n[0]
+              << " x " << n[1] << " x " << n[2] << ")..." << std::endl;
 
+  scale_mesh(n, mesh);
+
+#ifdef HAVE_MPI
   if (mype == 0)
-    std::cout << "Scaling mesh by a factor of " << scale << "..." << std::endl;
+    std::cout << "Checking communication..." << std::endl;
 
-  scale_mesh(scale, mesh);
+  if (!check_comm(mesh)) {
+    std::cerr << "Aborting." << std::endl;
+    return 1;
+  }
+#endif
 
   if (mype == 0)
     std::cout << "Writing scaled mesh..." << std::endl;
@@ -91,6 +154,7 @@ int main(int argc, char *argv[]) {
 
   if (mype == 0)
     std::cout << "Done." << std::endl;
+  Kokkos::finalize();
 #ifdef HAVE_MPI
   comm.stop();
 #endif
@@ -101,207 +165,355 @@ bool read_mesh(
     char const *const basename, int const mype, Ume::SOA_Idx::Mesh &mesh) {
   char fname[80];
   sprintf(fname, "%s.%05d.ume", basename, mype);
-  std::ifstream is(fname);
-  if (!is) {
+  if (!mesh.read(fname)) {
     std::cerr << "Unable to open file \"" << fname << "\" for reading."
               << std::endl;
+    return false;
   }
-  mesh.read(is);
-  is.close();
   return true;
 }
 
-double get_bounding_dim(Ume::SOA_Idx::Mesh &mesh, int dim) {
-  auto const &pcoord = mesh.ds->caccess_vec3v("pcoord");
-
-  double num_points = mesh.points.size();
-  double p_max = 0;
-  for (int p = 0; p < num_points; ++p) {
-    double x = pcoord[p][dim];
-
-    if (x > p_max)
-      p_max = x;
+/* Split a scale factor into per-dimension factors, giving each prime factor
+   (largest first) to the dimension with the smallest factor so far.  Powers
+   of 2 double x, y, z, x, ... in turn. */
+Factors split_scale(int scale) {
+  std::vector<int> primes;
+  for (int p = 2; p * p <= scale; ++p) {
+    for (; scale % p == 0; scale /= p)
+      primes.push_back(p);
   }
-
-  return p_max;
+  if (scale > 1)
+    primes.push_back(scale);
+  Factors n{1, 1, 1};
+  for (auto p = primes.rbegin(); p != primes.rend(); ++p)
+    *std::min_element(n.begin(), n.end()) *= *p;
+  return n;
 }
 
-void double_entity_count(Ume::SOA_Idx::Entity &entity) {
-  int original_local = entity.local_size();
-  int original_total = entity.size();
-  int original_ghost = original_total - original_local;
+/* The extent of the points of all ranks in each dimension */
+Ume::DS_Types::VEC3_T get_bounding_box(Ume::SOA_Idx::Mesh &mesh) {
+  auto const &pcoord = mesh.ds->caccess_vec3v("pcoord");
+  double lo[3], hi[3];
+  for (int dim = 0; dim < 3; ++dim) {
+    lo[dim] = std::numeric_limits<double>::max();
+    hi[dim] = std::numeric_limits<double>::lowest();
+    for (auto const &x : pcoord) {
+      lo[dim] = std::min(lo[dim], x[dim]);
+      hi[dim] = std::max(hi[dim], x[dim]);
+    }
+  }
+#ifdef HAVE_MPI
+  MPI_Allreduce(MPI_IN_PLACE, lo, 3, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+  MPI_Allreduce(MPI_IN_PLACE, hi, 3, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+#endif
+  Ume::DS_Types::VEC3_T width{0.0};
+  for (int dim = 0; dim < 3; ++dim)
+    if (hi[dim] > lo[dim])
+      width[dim] = hi[dim] - lo[dim];
+  return width;
+}
 
-  int new_local = original_local * 2;
-  int new_total = original_total * 2;
-  int new_ghost = original_ghost * 2;
-  entity.resize(new_local, new_total, new_ghost);
+/* Where the elements of each replica of an entity go: the local elements of
+   all of the replicas come first, followed by all of their ghosts, so that
+   the result is laid out like any other entity. */
+struct Replica_Layout {
+  int num_replicas;
+  int local; //!< per replica
+  int total; //!< per replica
+
+  Replica_Layout(int const r, int const l, int const t)
+      : num_replicas{r}, local{l}, total{t} {}
+  explicit Replica_Layout(Ume::SOA_Idx::Entity const &e, int const r)
+      : Replica_Layout(r, e.local_size(), e.size()) {}
+
+  //! The new index of element i of replica r
+  int operator()(int const i, int const r) const {
+    return i < local ? r * local + i
+                     : num_replicas * local + r * (total - local) + i - local;
+  }
+  //! A connectivity value of replica r
+  /*! Values that are not indices of this entity (negative for none, or out
+      of range, like the bad m:c>z values at some ghost corners) are passed
+      through unchanged. */
+  int map(int const i, int const r) const {
+    return (i < 0 || i >= total) ? i : (*this)(i, r);
+  }
+};
+
+/* Replace v, the per-element array of an entity with the given layout, with
+   one holding every replica, whose element i of replica r is
+   value(v[i], r).  This allocates the result once, and fills it in
+   parallel. */
+template <class V, class F>
+void replicate(V &v, Replica_Layout const &e, F const &value) {
+  V out(v.size() * static_cast<size_t>(e.num_replicas));
+  Kokkos::parallel_for("replicate",
+      Kokkos::RangePolicy<HostExecSpace>(0, static_cast<int>(out.size())),
+      [&](const int j) {
+        int const r = j / e.total;
+        int const i = j % e.total;
+        out[e(i, r)] = value(v[i], r);
+      });
+  v = std::move(out);
 }
 
-void update_coords(Ume::DS_Types::VEC3V_T &coords, const int iter_start,
-    const int iter_end, const double delta, const int dim) {
-  for (int c = iter_start; c < iter_end; ++c) {
-    coords[c][dim] = coords[c - iter_start][dim] + delta;
+/* The layout of an entity on each rank, indexed by the rank number in the
+   mesh files.  Without MPI, only our own is known; the others have a negative
+   total. */
+std::vector<Replica_Layout> gather_layouts(
+    Ume::SOA_Idx::Entity const &entity, int const num_replicas) {
+  int const mine[3] = {
+      entity.mesh().mype, entity.local_size(), entity.size()};
+  int numpe = 1;
+#ifdef HAVE_MPI
+  MPI_Comm_size(MPI_COMM_WORLD, &numpe);
+#endif
+  std::vector<int> all(3 * static_cast<size_t>(numpe));
+#ifdef HAVE_MPI
+  MPI_Allgather(mine, 3, MPI_INT, all.data(), 3, MPI_INT, MPI_COMM_WORLD);
+#else
+  std::copy(mine, mine + 3, all.begin());
+#endif
+  std::vector<Replica_Layout> layouts(
+      std::max(entity.mesh().numpe, mine[0] + 1),
+      Replica_Layout(num_replicas, 0, -1));
+  for (int pe = 0; pe < numpe; ++pe) {
+    int const *const l = &all[3 * static_cast<size_t>(pe)];
+    if (l[0] >= static_cast<int>(layouts.size()))
+      layouts.resize(l[0] + 1, Replica_Layout(num_replicas, 0, -1));
+    layouts[l[0]] = Replica_Layout(num_replicas, l[1], l[2]);
   }
+  return layouts;
 }
 
-void update_entity(Ume::DS_Types::INTV_T &map, const int iter_start,
-    const int iter_end, const int delta) {
-  for (int e = iter_start; e < iter_end; ++e) {
-    map[e] = map[e - iter_start] + delta;
+/* Each neighbor exchanges the same elements of every replica, in replica
+   order on both sides */
+void replicate_neighbors(
+    Ume::Comm::Neighbors &neighbors, Replica_Layout const &e) {
+  for (auto &n : neighbors) {
+    std::vector<int> elements;
+    elements.reserve(n.elements.size() * e.num_replicas);
+    for (int r = 0; r < e.num_replicas; ++r)
+      for (int const i : n.elements)
+        elements.push_back(e(i, r));
+    n.elements = std::move(elements);
   }
 }
 
-void stitch(Ume::SOA_Idx::Mesh &mesh, const int dim) {
-  //! ----- Points -----
-  // Double Number of Points
-  double p_max = get_bounding_dim(mesh, dim);
-
-  int original_points_total = mesh.points.size();
-  int new_points_total = original_points_total * 2;
-  double_entity_count(mesh.points);
-
-  // Update Point Coordinates of new Points
-  auto &new_pcoords = mesh.ds->access_vec3v("pcoord");
-  update_coords(
-      new_pcoords, original_points_total, new_points_total, p_max, dim);
-
-  //! ----- Zones -----
-  // Double Number of Zones
-  int original_zones_total = mesh.zones.size();
-  // int new_zones_total = original_zones_total * 2;
-  double_entity_count(mesh.zones);
-
-  //! ----- Edges -----
-  // Double Number of Edges
-  int original_edges_total = mesh.edges.size();
-  int new_edges_total = original_edges_total * 2;
-  double_entity_count(mesh.edges);
-
-  // Update Edge Maps of new Edges
-  auto &e_to_p1_map = mesh.ds->access_intv("m:e>p1");
-  auto &e_to_p2_map = mesh.ds->access_intv("m:e>p2");
-
-  update_entity(e_to_p1_map, original_edges_total, new_edges_total,
-      original_points_total);
-  update_entity(e_to_p2_map, original_edges_total, new_edges_total,
-      original_points_total);
-
-  //! ----- Faces -----
-  // Double Number of Faces
-  int original_faces_total = mesh.faces.size();
-  int new_faces_total = original_faces_total * 2;
-  double_entity_count(mesh.faces);
-
-  // Update Face Maps of new Faces
-  auto &f_to_z1_map = mesh.ds->access_intv("m:f>z1");
-  auto &f_to_z2_map = mesh.ds->access_intv("m:f>z2");
-
-  update_entity(
-      f_to_z1_map, original_faces_total, new_faces_total, original_zones_total);
-  update_entity(
-      f_to_z2_map, original_faces_total, new_faces_total, original_zones_total);
-
-  //! ----- Corners -----
-  // Double Number of Corners
-  int original_corners_total = mesh.corners.size();
-  int new_corners_total = original_corners_total * 2;
-  double_entity_count(mesh.corners);
-
-  // Update Corner Maps of new Corners
-  auto &c_to_p_map = mesh.ds->access_intv("m:c>p");
-  auto &c_to_z_map = mesh.ds->access_intv("m:c>z");
-
-  update_entity(c_to_p_map, original_corners_total, new_corners_total,
-      original_points_total);
-  update_entity(c_to_z_map, original_corners_total, new_corners_total,
-      original_zones_total);
-
-  //! ----- Sides -----
-  // Double Number of Sides
-  int original_sides_total = mesh.sides.size();
-  int new_sides_total = original_sides_total * 2;
-  double_entity_count(mesh.sides);
-
-  // Update Side Maps of new Sides
-  auto &s_to_z_map = mesh.ds->access_intv("m:s>z");
-  auto &s_to_e_map = mesh.ds->access_intv("m:s>e");
-  auto &s_to_p1_map = mesh.ds->access_intv("m:s>p1");
-  auto &s_to_p2_map = mesh.ds->access_intv("m:s>p2");
-  auto &s_to_f_map = mesh.ds->access_intv("m:s>f");
-  auto &s_to_c1_map = mesh.ds->access_intv("m:s>c1");
-  auto &s_to_c2_map = mesh.ds->access_intv("m:s>c2");
-  auto &s_to_s2_map = mesh.ds->access_intv("m:s>s2");
-  auto &s_to_s3_map = mesh.ds->access_intv("m:s>s3");
-  auto &s_to_s4_map = mesh.ds->access_intv("m:s>s4");
-  auto &s_to_s5_map = mesh.ds->access_intv("m:s>s5");
-
-  update_entity(
-      s_to_z_map, original_sides_total, new_sides_total, original_zones_total);
-  update_entity(
-      s_to_e_map, original_sides_total, new_sides_total, original_edges_total);
-  update_entity(s_to_p1_map, original_sides_total, new_sides_total,
-      original_points_total);
-  update_entity(s_to_p2_map, original_sides_total, new_sides_total,
-      original_points_total);
-  update_entity(
-      s_to_f_map, original_sides_total, new_sides_total, original_faces_total);
-  update_entity(s_to_c1_map, original_sides_total, new_sides_total,
-      original_corners_total);
-  update_entity(s_to_c2_map, original_sides_total, new_sides_total,
-      original_corners_total);
-  update_entity(
-      s_to_s2_map, original_sides_total, new_sides_total, original_sides_total);
-  update_entity(
-      s_to_s3_map, original_sides_total, new_sides_total, original_sides_total);
-  update_entity(
-      s_to_s4_map, original_sides_total, new_sides_total, original_sides_total);
-  update_entity(
-      s_to_s5_map, original_sides_total, new_sides_total, original_sides_total);
-
-  //! ----- Iotas -----
-  // Double Number of Iotas
-  int original_iotas_total = mesh.iotas.size();
-  int new_iotas_total = original_iotas_total * 2;
-  double_entity_count(mesh.iotas);
-
-  // Update Corner Maps of new Corners
-  if (mesh.dump_iotas) {
-    auto &a_to_z_map = mesh.ds->access_intv("m:a>z");
-    auto &a_to_f_map = mesh.ds->access_intv("m:a>f");
-    auto &a_to_p_map = mesh.ds->access_intv("m:a>p");
-    auto &a_to_e_map = mesh.ds->access_intv("m:a>e");
-    auto &a_to_s_map = mesh.ds->access_intv("m:a>s");
-
-    update_entity(a_to_z_map, original_iotas_total, new_iotas_total,
-        original_zones_total);
-    update_entity(a_to_f_map, original_iotas_total, new_iotas_total,
-        original_faces_total);
-    update_entity(a_to_p_map, original_iotas_total, new_iotas_total,
-        original_points_total);
-    update_entity(a_to_e_map, original_iotas_total, new_iotas_total,
-        original_edges_total);
-    update_entity(a_to_s_map, original_iotas_total, new_iotas_total,
-        original_sides_total);
+/* Subsets list their local elements first, like the entities */
+void replicate_subsets(std::vector<Ume::SOA_Idx::Entity::Subset> &subsets,
+    Replica_Layout const &e) {
+  for (auto &ss : subsets) {
+    size_t const num_elements = ss.elements.size();
+    std::vector<int> elements;
+    std::vector<short> mask;
+    elements.reserve(num_elements * e.num_replicas);
+    mask.reserve(ss.mask.size() * e.num_replicas);
+    for (int part = 0; part < 2; ++part) {
+      size_t const first = part == 0 ? 0 : ss.lsize;
+      size_t const last = part == 0 ? ss.lsize : num_elements;
+      for (int r = 0; r < e.num_replicas; ++r) {
+        for (size_t j = first; j < last; ++j) {
+          elements.push_back(e.map(ss.elements[j], r));
+          if (j < ss.mask.size())
+            mask.push_back(ss.mask[j]);
+        }
+      }
+    }
+    ss.elements = std::move(elements);
+    ss.mask = std::move(mask);
+    ss.lsize *= e.num_replicas;
   }
 }
 
-void scale_mesh(int const scale, Ume::SOA_Idx::Mesh &mesh) {
-  int current_scale = 1;
-  int dim = 0;
+/* Replicate an entity's own arrays, and any connectivity maps given as
+   {name, target layout}.  `sources` holds the entity's layout on each rank. */
+void replicate_entity(Ume::SOA_Idx::Entity &entity, Replica_Layout const &e,
+    std::vector<Replica_Layout> const &sources,
+    std::vector<std::pair<char const *, Replica_Layout>> const &maps) {
+  auto const copy = [](auto const &x, int) { return x; };
+  replicate(entity.mask, e, copy);
+  replicate(entity.comm_type, e, copy);
+
+  /* The copies are listed in replica order */
+  int const num_cpys = static_cast<int>(entity.cpy_idx.size());
+  Replica_Layout const c(e.num_replicas, num_cpys, num_cpys);
+  replicate(entity.cpy_idx, c, [&e](int const i, int const r) {
+    return e.map(i, r);
+  });
+  replicate(entity.src_pe, c, copy);
+  replicate(entity.src_idx, c, copy);
+  replicate(entity.ghost_mask, c, copy);
+
+  /* A copy in replica r has its source in replica r of the source rank */
+  for (int const pe : entity.src_pe) {
+    if (pe < 0 || pe >= static_cast<int>(sources.size()) ||
+        sources[pe].total < 0) {
+      std::cerr << "The entity sizes on rank " << pe
+                << " are unknown; run scale_mesh with one MPI rank per file"
+                << std::endl;
+      exit(1);
+    }
+  }
+  Kokkos::parallel_for("remap sources",
+      Kokkos::RangePolicy<HostExecSpace>(
+          0, static_cast<int>(entity.src_idx.size())),
+      [&](const int j) {
+        entity.src_idx[j] =
+            sources[entity.src_pe[j]](entity.src_idx[j], j / num_cpys);
+      });
+  replicate_neighbors(entity.myCpys, e);
+  replicate_neighbors(entity.mySrcs, e);
+  replicate_subsets(entity.subsets, e);
+
+  for (auto const &[name, target] : maps) {
+    replicate(entity.ds().access_intv(name), e,
+        [&target](int const i, int const r) { return target.map(i, r); });
+  }
 
+  /* The arrays are the new sizes already, so this just sets local_size */
+  entity.resize(e.num_replicas * e.local, e.num_replicas * e.total,
+      e.num_replicas * num_cpys);
+}
+
+void scale_mesh(Factors const &n, Ume::SOA_Idx::Mesh &mesh) {
   std::cout << "Original Mesh Stats:" << std::endl;
   mesh.print_stats(std::cout);
   std::cout << std::endl;
-  while (current_scale < scale) {
-    dim = dim % 3;
-    stitch(mesh, dim);
-    current_scale *= 2;
-    dim += 1;
+
+  int const num_replicas = n[0] * n[1] * n[2];
+  Ume::SOA_Idx::Entity const *const entities[] = {&mesh.points, &mesh.edges,
+      &mesh.faces, &mesh.sides, &mesh.corners, &mesh.zones, &mesh.iotas};
+  for (Ume::SOA_Idx::Entity const *e : entities) {
+    if (static_cast<long>(e->size()) * num_replicas > INT_MAX) {
+      std::cerr << "The scaled mesh would have more than " << INT_MAX
+                << " elements of an entity on a rank" << std::endl;
+      exit(1);
+    }
   }
+
+  Ume::Timer timer;
+  timer.start();
+  /* The layouts all come from the original sizes */
+  Replica_Layout const p(mesh.points, num_replicas);
+  Replica_Layout const e(mesh.edges, num_replicas);
+  Replica_Layout const f(mesh.faces, num_replicas);
+  Replica_Layout const s(mesh.sides, num_replicas);
+  Replica_Layout const c(mesh.corners, num_replicas);
+  Replica_Layout const z(mesh.zones, num_replicas);
+  Replica_Layout const a(mesh.iotas, num_replicas);
+
+  /* Replica r is at (r % nx, r / nx % ny, r / (nx * ny)) */
+  auto const width = get_bounding_box(mesh);
+  std::vector<Ume::DS_Types::VEC3_T> shift(num_replicas);
+  for (int r = 0; r < num_replicas; ++r) {
+    int const pos[3] = {r % n[0], r / n[0] % n[1], r / (n[0] * n[1])};
+    for (int dim = 0; dim < 3; ++dim)
+      shift[r][dim] = pos[dim] * width[dim];
+  }
+  replicate(mesh.ds->access_vec3v("pcoord"), p,
+      [&shift](auto const &x, int const r) { return x + shift[r]; });
+
+  auto const sources = [num_replicas](Ume::SOA_Idx::Entity const &entity) {
+    return gather_layouts(entity, num_replicas);
+  };
+  replicate_entity(mesh.points, p, sources(mesh.points), {});
+  replicate_entity(
+      mesh.edges, e, sources(mesh.edges), {{"m:e>p1", p}, {"m:e>p2", p}});
+  replicate_entity(
+      mesh.faces, f, sources(mesh.faces), {{"m:f>z1", z}, {"m:f>z2", z}});
+  replicate_entity(
+      mesh.corners, c, sources(mesh.corners), {{"m:c>p", p}, {"m:c>z", z}});
+  replicate_entity(mesh.sides, s, sources(mesh.sides),
+      {{"m:s>z", z}, {"m:s>e", e}, {"m:s>p1", p}, {"m:s>p2", p}, {"m:s>f", f},
+          {"m:s>c1", c}, {"m:s>c2", c}, {"m:s>s2", s}, {"m:s>s3", s},
+          {"m:s>s4", s}, {"m:s>s5", s}});
+  replicate_entity(mesh.zones, z, sources(mesh.zones), {});
+  if (mesh.dump_iotas)
+    replicate_entity(mesh.iotas, a, sources(mesh.iotas),
+        {{"m:a>z", z}, {"m:a>f", f}, {"m:a>p", p}, {"m:a>e", e},
+            {"m:a>s", s}});
+  timer.stop();
+
   std::cout << "Final Mesh Stats:" << std::endl;
   mesh.print_stats(std::cout);
+  std::cout << "Replication took " << timer << std::endl;
+}
+
+#ifdef HAVE_MPI
+/* Check an entity's communication pattern with a gathscat: each copy adds -1
+   to the sum, and each source the number of its copies, so every shared
+   element should end up 0, and the others unchanged. */
+bool check_gathscat(Ume::SOA_Idx::Entity &entity, char const *const name) {
+  int const background_val = 100;
+  Ume::DS_Types::INTV_T int_field(entity.size(), background_val);
+  for (auto const &n : entity.mySrcs)
+    for (int const i : n.elements)
+      int_field[i] = 0;
+  for (auto const &n : entity.mySrcs)
+    for (int const i : n.elements)
+      int_field[i] += 1;
+  for (auto const &n : entity.myCpys)
+    for (int const i : n.elements)
+      int_field[i] = -1;
+  std::vector<char> shared(entity.size(), 0);
+  for (auto const *neighbors : {&entity.mySrcs, &entity.myCpys})
+    for (auto const &n : *neighbors)
+      for (int const i : n.elements)
+        shared[i] = 1;
+
+  entity.gathscat(Ume::Comm::Op::SUM, int_field);
+
+  int num_bad = 0;
+  for (int i = 0; i < entity.size(); ++i) {
+    int const expected = shared[i] ? 0 : background_val;
+    if (int_field[i] != expected && num_bad++ < 5)
+      std::cout << "Rank " << entity.mesh().mype << " expecting " << name
+                << "[" << i << "] == " << expected << ", got " << int_field[i]
+                << '\n';
+  }
+  return num_bad == 0;
 }
 
+/* Check the scaled mesh's communication patterns on all ranks.  The points
+   are also checked by scattering their coordinates, which only agree if every
+   rank shifted each replica by the same amount. */
+bool check_comm(Ume::SOA_Idx::Mesh &mesh) {
+  std::pair<Ume::SOA_Idx::Entity *, char const *> const entities[] = {
+      {&mesh.points, "points"}, {&mesh.edges, "edges"}, {&mesh.faces, "faces"},
+      {&mesh.sides, "sides"}, {&mesh.corners, "corners"},
+      {&mesh.zones, "zones"}, {&mesh.iotas, "iotas"}};
+  int ok = 1;
+  for (auto const &[entity, name] : entities)
+    if (!check_gathscat(*entity, name))
+      ok = 0;
+
+  auto const &pcoord = mesh.ds->caccess_vec3v("pcoord");
+  Ume::DS_Types::VEC3V_T x(pcoord);
+  mesh.points.scatter(x);
+  int num_bad = 0;
+  for (auto const &n : mesh.points.myCpys) {
+    for (int const i : n.elements) {
+      bool match = true;
+      for (int dim = 0; dim < 3; ++dim)
+        match = match &&
+            std::abs(x[i][dim] - pcoord[i][dim]) <=
+                1.0e-9 * (1.0 + std::abs(pcoord[i][dim]));
+      if (!match && num_bad++ < 5)
+        std::cout << "Rank " << mesh.mype << " point " << i
+                  << " is not where its source is" << '\n';
+    }
+  }
+  if (num_bad > 0)
+    ok = 0;
+
+  MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+  if (mesh.mype == 0)
+    std::cout << "Communication check " << (ok ? "PASS" : "FAIL") << std::endl;
+  return ok != 0;
+}
+#endif
+
 bool write_mesh(char const *const basename, int const mype, int const scale,
     Ume::SOA_Idx::Mesh &mesh) {
   char fname[80];
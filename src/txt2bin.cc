@@ -15,57 +15,278 @@
   This reads a file in the LAP ASCII UmeDump format (see
   `$OPUS/DELFI/Output/UmeDump`), and creates a binary file for use with
   `Ume/SOA_Idx_Mesh.hh`.  Note that this only reads 3-D meshes.
+
+  The binary file is written in the UME_VERSION_3 sectioned layout, or with
+  `--v2`, in the older layout of the text file's input version.  With
+  `--compress`, the integer arrays of a version 3 file are compressed.
+
+  The text file is memory-mapped, and the large per-entity tables are split
+  into line-aligned chunks that are parsed concurrently with std::from_chars
+  on `--threads` threads (by default, one per hardware thread).  Each table
+  row must be on a single line.
+
+  With `--batch`, each argument is a glob (or a prefix, to which
+  `*.umetxt` is appended) of text files, which are converted to `.ume` files
+  alongside them, `--jobs` at a time.  Verification then defaults to
+  `--verify checksum`, which rereads each section of the binary file and
+  compares it to the checksum in its TOC, rather than reading a second Mesh.
+
+  With `--stream`, each entity is written as soon as its table is parsed,
+  and then released (see Mesh::write_streaming), and the text pages are
+  dropped once parsed, so memory use is bounded by the largest entity rather
+  than the whole mesh.  The output is identical, and is verified by checksum.
 */
 
 #include "Ume/SOA_Idx_Mesh.hh"
 #include "Ume/Timer.hh"
+#include "Ume/mapped_file.hh"
+#include "Ume/mesh_sections.hh"
 #include "Ume/utils.hh"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
 #include <cstring>
+#include <fcntl.h>
 #include <fstream>
+#include <functional>
+#include <glob.h>
 #include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <sys/resource.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 using namespace Ume::SOA_Idx;
-using Ume::skip_line;
 
-int read(std::istream &is, Mesh &m);
+//! A position in the memory-mapped text file
+struct Text_Cursor {
+  char const *pos;
+  char const *end;
+  //! If set, the mapping, whose pages are dropped once their rows are parsed
+  Ume::Mapped_File const *file = nullptr;
+
+  bool at_end() const { return pos >= end; }
+  char const *line_end() const {
+    auto const nl = static_cast<char const *>(
+        std::memchr(pos, '\n', static_cast<size_t>(end - pos)));
+    return nl ? nl : end;
+  }
+  //! Move to the start of the next line
+  void skip_line() {
+    pos = line_end();
+    if (pos < end)
+      ++pos;
+  }
+  //! Return the rest of the current line, and move to the next
+  std::string_view get_line() {
+    char const *const b = pos;
+    char const *const e = line_end();
+    skip_line();
+    return {b, static_cast<size_t>(e - b)};
+  }
+  //! Skip whitespace, including newlines (like `std::ws`)
+  void skip_ws() {
+    while (pos < end && std::isspace(static_cast<unsigned char>(*pos)))
+      ++pos;
+  }
+  //! Read the next whitespace-delimited number (like `operator>>`)
+  template <class T> bool number(T &val) {
+    skip_ws();
+    auto const [p, ec] = std::from_chars(pos, end, val);
+    if (ec != std::errc{})
+      return false;
+    pos = p;
+    return true;
+  }
+};
+
+//! The number of threads used to parse tables and check files
+int num_threads = 0;
+
+//! A malformed text file
+/*! The readers throw this rather than exiting, so that in --batch mode a
+    bad file fails only its own conversion.  convert() catches it. */
+struct Read_Error : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+//! An entity table located, but not parsed, by read()
+struct Text_Table {
+  Entity *e;
+  Text_Cursor start;
+  char const *end;
+  std::function<void(Text_Cursor &)> parse;
+};
+
+/* Read a text file into m.  Given `tables`, the entity tables are skipped
+   and listed there, to be parsed later, and only the scalars, communication
+   lists and materials are read. */
+int read(
+    Text_Cursor &t, Mesh &m, std::vector<Text_Table> *tables = nullptr);
+
+//! How to check a converted file
+enum class Verify {
+  NONE,
+  CHECKSUM, //!< Reread the sections, comparing them to their TOC checksums
+  FULL //!< Read the binary file back into a Mesh, and compare the two
+};
+
+struct Convert_Options {
+  bool legacy = false;
+  bool compress = false;
+  bool stream = false;
+  Verify verify = Verify::FULL;
+};
+
+/* Reread each section of a version 3 file, and compare it to its checksum */
+int check_sections(char const *const outfile, std::ostream &log) {
+  log << "Checking section checksums of \"" << outfile << "\"" << std::endl;
+  std::ifstream is(outfile, std::ios::binary);
+  int const fd = ::open(outfile, O_RDONLY);
+  int tag = 0;
+  Ume::read_bin(is, tag);
+  if (!is || fd < 0 || tag != UME_VERSION_3) {
+    if (fd >= 0)
+      ::close(fd);
+    std::cerr << "Couldn't open \"" << outfile << "\" for reading"
+              << std::endl;
+    return 6;
+  }
+  Ume::Section_Reader r(is, sizeof(tag), fd);
+  Ume::Section_Info const *const bad = r.check(num_threads);
+  ::close(fd);
+  if (bad) {
+    std::cerr << "Error: section \"" << bad->name << "\" of \"" << outfile
+              << "\" failed its checksum." << std::endl;
+    return 5;
+  }
+  log << "Copy verified" << std::endl;
+  return 0;
+}
 
-int main(int argc, char *argv[]) {
-  if (argc != 3) {
-    std::cerr << "Usage: txt2bin <infile> <outfile>" << std::endl;
-    return 1;
+/* Convert one file, writing each entity as soon as it is parsed, so that
+   only one entity's arrays are in memory at a time.  The text is read twice:
+   first for everything but the tables, which are only located, and then a
+   table at a time, dropping the pages of each once it is parsed. */
+int convert_streaming(char const *const infile, char const *const outfile,
+    Convert_Options const &opts, std::ostream &log, size_t &text_bytes) {
+  Mesh m;
+  log << "Reading text file \"" << infile << "\"" << std::endl;
+  Ume::Mapped_File text(infile);
+  if (!text.is_open()) {
+    std::cerr << "Couldn't open \"" << infile << "\" for reading"
+              << std::endl;
+    return 2;
   }
+  text_bytes = text.size();
+  Ume::Timer timer;
+  timer.start();
+  Text_Cursor t{text.data(), text.data() + text.size()};
+  t.file = &text;
+  std::vector<Text_Table> tables;
+  int retval;
+  try {
+    retval = read(t, m, &tables);
+  } catch (Read_Error const &e) {
+    std::cerr << e.what() << std::endl;
+    retval = 1;
+  }
+  if (retval) {
+    std::cerr << "exiting due to read errors" << std::endl;
+    return 3;
+  }
+  m.ivtag = UME_VERSION_3;
+  m.compress = opts.compress;
+
+  log << "Writing binary file \"" << outfile << "\"" << std::endl;
+  std::ofstream os(outfile);
+  if (!os) {
+    std::cerr << "Couldn't open \"" << outfile << "\" for writing"
+              << std::endl;
+    return 4;
+  }
+  try {
+    m.write_streaming(os, [&](Entity &e) {
+      for (auto const &table : tables) {
+        if (table.e == &e) {
+          Text_Cursor c = table.start;
+          table.parse(c);
+        }
+      }
+    });
+  } catch (Read_Error const &e) {
+    /* Don't leave a partial file behind */
+    std::cerr << e.what() << std::endl;
+    os.close();
+    std::remove(outfile);
+    std::cerr << "exiting due to read errors" << std::endl;
+    return 3;
+  }
+  os.close();
+  timer.stop();
+  log << "Streaming conversion took " << timer << " ("
+      << static_cast<double>(text.size()) * 1e-9 / timer.seconds()
+      << " GB/s of text)\n";
+
+  /* There is no second mesh to compare with */
+  if (opts.verify == Verify::NONE)
+    return 0;
+  return check_sections(outfile, log);
+}
 
+/* Convert one file, logging progress to `log`.  Returns 0, or the exit code
+   for the first problem.  `text_bytes` is the size of the text file. */
+int convert(char const *const infile, char const *const outfile,
+    Convert_Options const &opts, std::ostream &log, size_t &text_bytes) {
+  if (opts.stream)
+    return convert_streaming(infile, outfile, opts, log, text_bytes);
   double txt_read_time;
   Mesh m;
   {
     int retval;
-    std::cout << "Reading text file \"" << argv[1] << "\"" << std::endl;
-    std::ifstream is(argv[1]);
-    if (!is) {
-      std::cerr << "Couldn't open \"" << argv[1] << "\" for reading"
+    log << "Reading text file \"" << infile << "\"" << std::endl;
+    Ume::Mapped_File text(infile);
+    if (!text.is_open()) {
+      std::cerr << "Couldn't open \"" << infile << "\" for reading"
                 << std::endl;
       return 2;
     }
+    text_bytes = text.size();
     Ume::Timer timer;
     timer.start();
-    retval = read(is, m);
+    Text_Cursor t{text.data(), text.data() + text.size()};
+    try {
+      retval = read(t, m);
+    } catch (Read_Error const &e) {
+      std::cerr << e.what() << std::endl;
+      retval = 1;
+    }
     timer.stop();
-    is.close();
     if (retval) {
       std::cerr << "exiting due to read errors" << std::endl;
       return 3;
     } else {
-      std::cout << "Text read took " << timer << "\n";
+      log << "Text read took " << timer << " ("
+          << static_cast<double>(text.size()) * 1e-9 / timer.seconds()
+          << " GB/s)\n";
       txt_read_time = timer.seconds();
     }
+    if (!opts.legacy)
+      m.ivtag = UME_VERSION_3;
+    m.compress = opts.compress;
   }
 
   {
-    std::cout << "Writing binary file \"" << argv[2] << "\"" << std::endl;
-    std::ofstream os(argv[2]);
+    log << "Writing binary file \"" << outfile << "\"" << std::endl;
+    std::ofstream os(outfile);
     if (!os) {
-      std::cerr << "Couldn't open \"" << argv[2] << "\" for writing"
+      std::cerr << "Couldn't open \"" << outfile << "\" for writing"
                 << std::endl;
       return 4;
     }
@@ -74,225 +295,310 @@ int main(int argc, char *argv[]) {
     m.write(os);
     timer.stop();
     os.close();
-    std::cout << "Binary write took " << timer << "\n";
+    log << "Binary write took " << timer << "\n";
   }
 
-  {
+  /* Older layouts have no checksums to check */
+  Verify const verify = opts.legacy && opts.verify == Verify::CHECKSUM
+      ? Verify::FULL
+      : opts.verify;
+
+  if (verify == Verify::CHECKSUM) {
+    if (int const retval = check_sections(outfile, log))
+      return retval;
+  } else if (verify == Verify::FULL) {
     Mesh m2;
-    std::cout << "Reading binary file \"" << argv[2] << "\" for verification"
-              << std::endl;
-    std::ifstream is(argv[2]);
-    Ume::Timer timer;
-    timer.start();
-    m2.read(is);
-    timer.stop();
-    std::cout << "Binary read took " << timer << " ("
-              << txt_read_time / timer.seconds() << "x speedup)\n";
-    is.close();
+    log << "Reading binary file \"" << outfile << "\" for verification"
+        << std::endl;
+    if (!m2.read(outfile, num_threads)) {
+      std::cerr << "Couldn't open \"" << outfile << "\" for reading"
+                << std::endl;
+      return 6;
+    }
+    log << "Binary read took " << m2.load_seconds << "s ("
+        << txt_read_time / m2.load_seconds << "x speedup)\n";
     if (!(m == m2)) {
       std::cerr << "Error: write/read test failed, meshes not equivalent."
                 << std::endl;
       return 5;
     } else {
-      std::cout << "Copy verified" << std::endl;
-      std::cout << "\nMesh Stats\n-------------------------------\n";
-      m2.print_stats(std::cout);
-      std::cout << std::endl;
+      log << "Copy verified" << std::endl;
+      log << "\nMesh Stats\n-------------------------------\n";
+      m2.print_stats(log);
+      log << std::endl;
     }
   }
 
   return 0;
 }
 
-int read_tag(std::istream &is, char const *const expect) {
-  char tagname[25];
-  is.get(tagname, 23);
-  std::string ts(tagname);
-
-  while (ts.back() == ':' || ts.back() == ' ')
-    ts.pop_back();
-  if (ts != std::string(expect)) {
-    std::cerr << "Expecting tag \"" << expect << "\", got \"" << ts << "\""
-              << std::endl;
-    exit(1);
-  }
-  int val{-1};
-  is >> val;
-  if (!is) {
-    std::cerr << "Didn't find an integer after tag \"" << ts << "\""
-              << std::endl;
-    exit(1);
+/* Expand the --batch arguments into a sorted list of text files.  An
+   argument that does not end in ".umetxt" is a prefix. */
+std::vector<std::string> batch_files(int const argc, char *argv[]) {
+  std::vector<std::string> files;
+  for (int i = 0; i < argc; ++i) {
+    std::string pattern{argv[i]};
+    if (!pattern.ends_with(".umetxt"))
+      pattern += "*.umetxt";
+    glob_t g;
+    if (glob(pattern.c_str(), 0, nullptr, &g) == 0) {
+      for (size_t j = 0; j < g.gl_pathc; ++j)
+        files.emplace_back(g.gl_pathv[j]);
+    }
+    globfree(&g);
   }
-  is >> std::ws;
-  return val;
+  std::sort(files.begin(), files.end());
+  files.erase(std::unique(files.begin(), files.end()), files.end());
+  return files;
 }
 
-int read_vtag(std::istream &is, char const *const expect) {
-  /* If "Input version" tag is absent, default to old input version. */
-  char const c1 = static_cast<char>(is.peek());
-  if (c1 != 'I')
-    return UME_VERSION_1;
-
-  char tagname[25];
-  is.get(tagname, 23);
-  std::string ts(tagname);
+/* Convert each file to one with the .ume extension, on num_jobs threads.
+   Each file's log is printed only if its conversion fails. */
+int convert_batch(std::vector<std::string> const &files, int const num_jobs,
+    Convert_Options const &opts) {
+  std::mutex out_mutex;
+  std::vector<int> retval(files.size(), 0);
+  size_t total_bytes = 0;
+  Ume::Timer timer;
+  timer.start();
+  Ume::run_tasks(num_jobs, files.size(), [&](size_t const i) {
+    std::string const &infile = files[i];
+    std::string const outfile =
+        infile.substr(0, infile.size() - std::strlen(".umetxt")) + ".ume";
+    std::ostringstream log;
+    size_t text_bytes = 0;
+    Ume::Timer file_timer;
+    file_timer.start();
+    retval[i] = convert(infile.c_str(), outfile.c_str(), opts, log, text_bytes);
+    file_timer.stop();
+
+    std::lock_guard<std::mutex> lock(out_mutex);
+    total_bytes += text_bytes;
+    if (retval[i]) {
+      std::cout << log.str();
+      std::cerr << "Failed to convert \"" << infile << "\"" << std::endl;
+    } else {
+      std::cout << infile << " -> " << outfile << ": " << file_timer
+                << std::endl;
+    }
+  });
+  timer.stop();
+
+  size_t const num_failed = static_cast<size_t>(
+      std::count_if(retval.begin(), retval.end(), [](int r) { return r; }));
+  double const gb = static_cast<double>(total_bytes) * 1e-9;
+  std::cout << "Converted " << files.size() - num_failed << " of "
+            << files.size() << " files, " << gb << " GB of text in " << timer
+            << " (" << gb / timer.seconds() << " GB/s)" << std::endl;
+  for (int const r : retval)
+    if (r)
+      return r;
+  return 0;
+}
 
-  while (ts.back() == ':' || ts.back() == ' ')
-    ts.pop_back();
+void usage() {
+  std::cerr << "Usage: txt2bin [--v2] [--compress] [--threads <n>] "
+               "[--verify full|checksum|none] [--stream] <infile> <outfile>\n"
+               "       txt2bin [--v2] [--compress] [--threads <n>] "
+               "[--verify full|checksum|none] [--stream] [--jobs <n>] --batch "
+               "<prefix|glob>...\n";
+}
 
-  if (ts != std::string(expect)) {
-    std::cerr << "Expecting tag \"" << expect << "\", got \"" << ts << "\""
-              << std::endl;
-    exit(EXIT_FAILURE);
+int main(int argc, char *argv[]) {
+  Convert_Options opts;
+  bool batch = false;
+  bool verify_given = false;
+  int num_jobs = 0;
+  int arg = 1;
+  for (; arg < argc && std::strncmp(argv[arg], "--", 2) == 0; ++arg) {
+    if (std::strcmp(argv[arg], "--v2") == 0) {
+      opts.legacy = true;
+    } else if (std::strcmp(argv[arg], "--compress") == 0) {
+      opts.compress = true;
+    } else if (std::strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc) {
+      num_threads = std::atoi(argv[++arg]);
+    } else if (std::strcmp(argv[arg], "--jobs") == 0 && arg + 1 < argc) {
+      num_jobs = std::atoi(argv[++arg]);
+    } else if (std::strcmp(argv[arg], "--verify") == 0 && arg + 1 < argc) {
+      std::string_view const v{argv[++arg]};
+      verify_given = true;
+      if (v == "full") {
+        opts.verify = Verify::FULL;
+      } else if (v == "checksum") {
+        opts.verify = Verify::CHECKSUM;
+      } else if (v == "none") {
+        opts.verify = Verify::NONE;
+      } else {
+        arg = argc; // print the usage
+      }
+    } else if (std::strcmp(argv[arg], "--stream") == 0) {
+      opts.stream = true;
+    } else if (std::strcmp(argv[arg], "--batch") == 0) {
+      batch = true;
+    } else {
+      arg = argc; // print the usage
+    }
   }
+  if (opts.stream && opts.legacy) {
+    std::cerr << "--stream writes only the version 3 layout" << std::endl;
+    return 1;
+  }
+  int const hw_threads =
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
 
-  int val = -1;
-  is >> val;
-  if (!is) {
-    std::cerr << "Didn't find an integer after tag \"" << ts << "\""
-              << std::endl;
-    exit(EXIT_FAILURE);
+  if (batch) {
+    if (arg >= argc) {
+      usage();
+      return 1;
+    }
+    std::vector<std::string> const files = batch_files(argc - arg, argv + arg);
+    if (files.empty()) {
+      std::cerr << "No .umetxt files found" << std::endl;
+      return 2;
+    }
+    /* Share the hardware threads between the files being converted */
+    if (num_jobs <= 0)
+      num_jobs = std::min(hw_threads, static_cast<int>(files.size()));
+    if (num_threads <= 0)
+      num_threads = std::max(1, hw_threads / num_jobs);
+    if (!verify_given)
+      opts.verify = Verify::CHECKSUM;
+    return convert_batch(files, num_jobs, opts);
+  }
+
+  if (argc - arg != 2) {
+    usage();
+    return 1;
   }
-  is >> std::ws;
-  return val;
+  if (num_threads <= 0)
+    num_threads = hw_threads;
+  size_t text_bytes = 0;
+  int const retval =
+      convert(argv[arg], argv[arg + 1], opts, std::cout, text_bytes);
+  struct rusage ru;
+  if (retval == 0 && getrusage(RUSAGE_SELF, &ru) == 0)
+    std::cout << "Peak memory: " << ru.ru_maxrss / 1024 << " MB"
+              << std::endl;
+  return retval;
 }
 
-bool read_bool_tag(std::istream &is, char const *const expect) {
-  char tagname[25];
-  is.get(tagname, 23);
-  std::string ts(tagname);
-
-  while (ts.back() == ':' || ts.back() == ' ')
+/* The fixed-width (22 character) tag at the start of a header line, without
+   its trailing colon and spaces */
+std::string tag_name(Text_Cursor &t, char const *const expect) {
+  char const *const e = std::min(t.line_end(), t.pos + 22);
+  std::string ts(t.pos, e);
+  t.pos = e;
+  while (!ts.empty() && (ts.back() == ':' || ts.back() == ' '))
     ts.pop_back();
+  if (ts != std::string(expect))
+    throw Read_Error(
+        "Expecting tag \"" + std::string(expect) + "\", got \"" + ts + "\"");
+  return ts;
+}
 
-  if (ts != std::string(expect)) {
-    std::cerr << "Expecting tag \"" << expect << "\", got \"" << ts << "\""
-              << std::endl;
-    exit(EXIT_FAILURE);
-  }
-
-  bool val = false;
-  is >> std::boolalpha >> val;
-  if (!is) {
-    std::cerr << "Didn't find an integer after tag \"" << ts << "\""
-              << std::endl;
-    exit(EXIT_FAILURE);
-  }
-  is >> std::ws;
+int read_tag(Text_Cursor &t, char const *const expect) {
+  std::string const ts = tag_name(t, expect);
+  int val{-1};
+  if (!t.number(val))
+    throw Read_Error("Didn't find an integer after tag \"" + ts + "\"");
+  t.skip_ws();
   return val;
 }
 
-std::string read_tag_str(std::istream &is, char const *const expect) {
-  char tagname[25];
-  is.get(tagname, 23);
-  std::string ts(tagname);
-
-  while (ts.back() == ':' || ts.back() == ' ')
-    ts.pop_back();
-  if (ts != std::string(expect)) {
-    std::cerr << "Expecting tag \"" << expect << "\", got \"" << ts << "\""
-              << std::endl;
-    exit(1);
-  }
-  std::string val;
-  if (!std::getline(is, val)) {
-    std::cerr << "Error reading string after tag \"" << ts << "\"" << std::endl;
-    exit(1);
-  }
-  is >> std::ws;
-  return Ume::trim(val);
+int read_vtag(Text_Cursor &t, char const *const expect) {
+  /* If "Input version" tag is absent, default to old input version. */
+  if (t.at_end() || *t.pos != 'I')
+    return UME_VERSION_1;
+  return read_tag(t, expect);
 }
 
-bool expect_line(std::istream &is, char const *const expect) {
-  const size_t bufsize{256};
-  char buf[bufsize];
-  buf[0] = '\0';
-  is.getline(buf, bufsize);
-  if (!is || std::strcmp(buf, expect)) {
-    std::cerr << "Expecting line \"" << expect << "\", got \"" << buf << '\n';
-    exit(1);
+bool read_bool_tag(Text_Cursor &t, char const *const expect) {
+  std::string const ts = tag_name(t, expect);
+  t.skip_ws();
+  std::string_view const rest{t.pos, static_cast<size_t>(t.end - t.pos)};
+  bool val = false;
+  if (rest.starts_with("true")) {
+    val = true;
+    t.pos += 4;
+  } else if (rest.starts_with("false")) {
+    t.pos += 5;
+  } else {
+    throw Read_Error("Didn't find a boolean after tag \"" + ts + "\"");
   }
-  is >> std::ws;
-  return true;
+  t.skip_ws();
+  return val;
 }
 
-bool skip_to_line(std::istream &is, char const *const expect) {
-  std::string buf;
-  std::string const search{expect};
+std::string read_tag_str(Text_Cursor &t, char const *const expect) {
+  tag_name(t, expect);
+  std::string const val{t.get_line()};
+  t.skip_ws();
+  return Ume::trim(val);
+}
 
-  while (is && buf != search) {
-    std::getline(is, buf);
-  }
-  if (!is)
-    return false;
+bool expect_line(Text_Cursor &t, char const *const expect) {
+  std::string_view const line = t.get_line();
+  if (line != expect)
+    throw Read_Error("Expecting line \"" + std::string(expect) + "\", got \"" +
+        std::string(line) + "\"");
+  t.skip_ws();
   return true;
 }
 
-void read_points(std::istream &is, Points &pts, const int kkpl, const int kkpll,
-    const int kkpgl, const int ndims) {
-
-  pts.resize(kkpl, kkpll, kkpgl);
-  auto &coords = pts.ds().access_vec3v("pcoord");
-
-  int idx;
-  for (int i = 0; i < kkpll; ++i) {
-    idx = -1;
-    is >> idx;
-    if (idx != i + 1) {
-      std::cerr << "Point " << i + 1 << " read error" << std::endl;
-      exit(1);
-    }
-    is >> pts.mask[i] >> pts.comm_type[i] >> coords[i][0];
-    for (int d = 1; d < ndims; ++d) {
-      is >> coords[i][d];
-    }
-    is >> std::ws;
-  }
-
-  expect_line(is, "Ghost Points");
-  skip_line(is);
-  for (int i = 0; i < kkpgl; ++i) {
-    idx = -1;
-    is >> idx;
-    if (idx != i + 1) {
-      std::cerr << "Ghost point " << i + 1 << " read error" << std::endl;
-      exit(1);
-    }
-    is >> pts.cpy_idx[i] >> pts.ghost_mask[i] >> pts.src_idx[i] >>
-        pts.src_pe[i] >> std::ws;
-    --pts.cpy_idx[i];
-    --pts.src_idx[i];
+void skip_to_line(Text_Cursor &t, char const *const expect) {
+  while (!t.at_end()) {
+    if (t.get_line() == expect)
+      return;
   }
+  throw Read_Error("Didn't find a line \"" + std::string(expect) + "\"");
 }
 
-void read_zones(std::istream &is, Zones &zones, const int kkzl, const int kkzll,
-    const int kkzgl) {
-  int idx;
-  zones.resize(kkzl, kkzll, kkzgl);
-  for (int i = 0; i < kkzll; ++i) {
-    idx = -1;
-    is >> idx;
-    if (idx != i + 1) {
-      std::cerr << "Zone " << i + 1 << " read error" << std::endl;
-      exit(1);
+/* Parse num_rows table rows, one per line, calling parse(i, row) with a
+   cursor over the line for row i.  The rows are split into chunks, which are
+   parsed concurrently.  If parse returns false, report the first bad row as
+   "<what> <row> read error" with a Read_Error. */
+template <class F>
+void parse_rows(Text_Cursor &t, int const num_rows, char const *const what,
+    F const &parse) {
+  /* Finding the lines is much faster than parsing them */
+  constexpr int rows_per_chunk = 4096;
+  std::vector<char const *> starts;
+  for (int i = 0; i < num_rows; ++i) {
+    if (i % rows_per_chunk == 0) {
+      if (t.file && !starts.empty())
+        t.file->drop(starts.back(), t.pos);
+      starts.push_back(t.pos);
     }
-    is >> zones.mask[i] >> zones.comm_type[i] >> std::ws;
-  }
-
-  expect_line(is, "Ghost Zones");
-  skip_line(is);
-  for (int i = 0; i < kkzgl; ++i) {
-    idx = -1;
-    is >> idx;
-    if (idx != i + 1) {
-      std::cerr << "Ghost zone " << i + 1 << " read error" << std::endl;
-      exit(1);
+    if (t.at_end())
+      throw Read_Error(
+          std::string(what) + " " + std::to_string(i + 1) + " read error");
+    t.skip_line();
+  }
+  starts.push_back(t.pos);
+
+  size_t const num_chunks = starts.size() - 1;
+  std::vector<int> bad_row(num_chunks, -1);
+  Ume::run_tasks(num_threads, num_chunks, [&](size_t const c) {
+    Text_Cursor lines{starts[c], starts[c + 1]};
+    int const first = static_cast<int>(c) * rows_per_chunk;
+    int const last = std::min(first + rows_per_chunk, num_rows);
+    for (int i = first; i < last; ++i) {
+      Text_Cursor row{lines.pos, lines.line_end()};
+      if (!parse(i, row)) {
+        bad_row[c] = i;
+        return;
+      }
+      lines.skip_line();
     }
-    is >> zones.cpy_idx[i] >> zones.ghost_mask[i] >> zones.src_idx[i] >>
-        zones.src_pe[i] >> std::ws;
-    --zones.cpy_idx[i];
-    --zones.src_idx[i];
-  }
+    if (t.file)
+      t.file->drop(starts[c], starts[c + 1]);
+  });
+  for (int const i : bad_row) {
+    if (i >= 0)
+      throw Read_Error(
+          std::string(what) + " " + std::to_string(i + 1) + " read error");
+  }
+  t.skip_ws();
 }
 
 /***********************************************************************
@@ -306,264 +612,172 @@ void read_zones(std::istream &is, Zones &zones, const int kkzl, const int kkzll,
  ***********************************************************************
 */
 
-void read_sides(std::istream &is, Sides &sides, const int kksl, const int kksll,
-    const int kksgl) {
-  int idx;
-  sides.resize(kksl, kksll, kksgl);
-  auto &z = sides.ds().access_intv("m:s>z");
-  auto &p1 = sides.ds().access_intv("m:s>p1");
-  auto &p2 = sides.ds().access_intv("m:s>p2");
-  auto &e = sides.ds().access_intv("m:s>e");
-  auto &f = sides.ds().access_intv("m:s>f");
-  auto &c1 = sides.ds().access_intv("m:s>c1");
-  auto &c2 = sides.ds().access_intv("m:s>c2");
-  auto &s2 = sides.ds().access_intv("m:s>s2");
-  auto &s3 = sides.ds().access_intv("m:s>s3");
-  auto &s4 = sides.ds().access_intv("m:s>s4");
-  auto &s5 = sides.ds().access_intv("m:s>s5");
-
-  for (int i = 0; i < kksll; ++i) {
-    idx = -1;
-    is >> idx;
-    if (idx != i + 1) {
-      std::cerr << "Side " << i + 1 << " read error" << std::endl;
-      exit(1);
+/* Rows of "index mask comm_type" followed by one index for each of cols */
+void read_rows(Text_Cursor &t, Entity &e, int const num_rows,
+    char const *const what, std::vector<Ume::DS_Types::INTV_T *> const &cols) {
+  parse_rows(t, num_rows, what, [&](int const i, Text_Cursor &row) {
+    int idx = -1;
+    if (!row.number(idx) || idx != i + 1 || !row.number(e.mask[i]) ||
+        !row.number(e.comm_type[i]))
+      return false;
+    for (auto *const col : cols) {
+      int &val = (*col)[i];
+      if (!row.number(val))
+        return false;
+      --val;
     }
-    is >> sides.mask[i] >> sides.comm_type[i];
-    is >> z[i] >> p1[i] >> p2[i] >> e[i] >> f[i] >> c1[i] >> c2[i] >> s2[i] >>
-        s3[i] >> s4[i] >> s5[i] >> std::ws;
-    --z[i];
-    --p1[i];
-    --p2[i];
-    --e[i];
-    --f[i];
-    --c1[i];
-    --c2[i];
-    --s2[i];
-    --s3[i];
-    --s4[i];
-    --s5[i];
-  }
-  expect_line(is, "Ghost Sides");
-  skip_line(is);
-  for (int i = 0; i < kksgl; ++i) {
-    idx = -1;
-    is >> idx;
-    if (idx != i + 1) {
-      std::cerr << "Ghost side " << i + 1 << " read error" << std::endl;
-      exit(1);
+    return true;
+  });
+}
+
+/* The ghost table, after the "Ghost <Entities>" line and its header */
+void read_ghosts(Text_Cursor &t, Entity &e, int const num_ghosts,
+    char const *const ghost_line, char const *const what) {
+  expect_line(t, ghost_line);
+  t.skip_line();
+  parse_rows(t, num_ghosts, what, [&](int const i, Text_Cursor &row) {
+    int idx = -1;
+    if (!row.number(idx) || idx != i + 1 || !row.number(e.cpy_idx[i]) ||
+        !row.number(e.ghost_mask[i]) || !row.number(e.src_idx[i]) ||
+        !row.number(e.src_pe[i]))
+      return false;
+    --e.cpy_idx[i];
+    --e.src_idx[i];
+    return true;
+  });
+}
+
+/* Move past a table like those read by read_rows and read_ghosts */
+void skip_table(Text_Cursor &t, int const num_rows, int const num_ghosts,
+    char const *const ghost_line) {
+  for (int i = 0; i < num_rows; ++i)
+    t.skip_line();
+  t.skip_ws();
+  expect_line(t, ghost_line);
+  t.skip_line();
+  for (int i = 0; i < num_ghosts; ++i)
+    t.skip_line();
+  t.skip_ws();
+}
+
+void read_points(Text_Cursor &t, Points &pts, const int kkpl, const int kkpll,
+    const int kkpgl, const int ndims) {
+  pts.resize(kkpl, kkpll, kkpgl);
+  auto &coords = pts.ds().access_vec3v("pcoord");
+  parse_rows(t, kkpll, "Point", [&](int const i, Text_Cursor &row) {
+    int idx = -1;
+    if (!row.number(idx) || idx != i + 1 || !row.number(pts.mask[i]) ||
+        !row.number(pts.comm_type[i]))
+      return false;
+    for (int d = 0; d < ndims; ++d) {
+      if (!row.number(coords[i][d]))
+        return false;
     }
-    is >> sides.cpy_idx[i] >> sides.ghost_mask[i] >> sides.src_idx[i] >>
-        sides.src_pe[i] >> std::ws;
-    --sides.cpy_idx[i];
-    --sides.src_idx[i];
-  }
+    return true;
+  });
+  read_ghosts(t, pts, kkpgl, "Ghost Points", "Ghost point");
 }
 
-void read_iotas(std::istream &is, Iotas &iotas, const int kkal, const int kkall,
+void read_zones(Text_Cursor &t, Zones &zones, const int kkzl, const int kkzll,
+    const int kkzgl) {
+  zones.resize(kkzl, kkzll, kkzgl);
+  read_rows(t, zones, kkzll, "Zone", {});
+  read_ghosts(t, zones, kkzgl, "Ghost Zones", "Ghost zone");
+}
+
+void read_sides(Text_Cursor &t, Sides &sides, const int kksl, const int kksll,
+    const int kksgl) {
+  sides.resize(kksl, kksll, kksgl);
+  auto &ds = sides.ds();
+  read_rows(t, sides, kksll, "Side",
+      {&ds.access_intv("m:s>z"), &ds.access_intv("m:s>p1"),
+          &ds.access_intv("m:s>p2"), &ds.access_intv("m:s>e"),
+          &ds.access_intv("m:s>f"), &ds.access_intv("m:s>c1"),
+          &ds.access_intv("m:s>c2"), &ds.access_intv("m:s>s2"),
+          &ds.access_intv("m:s>s3"), &ds.access_intv("m:s>s4"),
+          &ds.access_intv("m:s>s5")});
+  read_ghosts(t, sides, kksgl, "Ghost Sides", "Ghost side");
+}
+
+void read_iotas(Text_Cursor &t, Iotas &iotas, const int kkal, const int kkall,
     const int kkagl) {
-  int idx;
   iotas.resize(kkal, kkall, kkagl);
-  auto &z = iotas.ds().access_intv("m:a>z");
-  auto &f = iotas.ds().access_intv("m:a>f");
-  auto &p = iotas.ds().access_intv("m:a>p");
-  auto &e = iotas.ds().access_intv("m:a>e");
-  auto &s = iotas.ds().access_intv("m:a>s");
-
-  for (int i = 0; i < kkall; ++i) {
-    idx = -1;
-    is >> idx;
-    if (idx != i + 1) {
-      std::cerr << "Iota " << i + 1 << " read error" << std::endl;
-      exit(1);
-    }
-    is >> iotas.mask[i] >> iotas.comm_type[i];
-    is >> z[i] >> f[i] >> p[i] >> e[i] >> s[i] >> std::ws;
-    --z[i];
-    --f[i];
-    --p[i];
-    --e[i];
-    --s[i];
-  }
-  expect_line(is, "Ghost Iotas");
-  skip_line(is);
-  for (int i = 0; i < kkagl; ++i) {
-    idx = -1;
-    is >> idx;
-    if (idx != i + 1) {
-      std::cerr << "Ghost iota " << i + 1 << " read error" << std::endl;
-      exit(1);
-    }
-    is >> iotas.cpy_idx[i] >> iotas.ghost_mask[i] >> iotas.src_idx[i] >>
-        iotas.src_pe[i] >> std::ws;
-    --iotas.cpy_idx[i];
-    --iotas.src_idx[i];
-  }
+  auto &ds = iotas.ds();
+  read_rows(t, iotas, kkall, "Iota",
+      {&ds.access_intv("m:a>z"), &ds.access_intv("m:a>f"),
+          &ds.access_intv("m:a>p"), &ds.access_intv("m:a>e"),
+          &ds.access_intv("m:a>s")});
+  read_ghosts(t, iotas, kkagl, "Ghost Iotas", "Ghost iota");
 }
 
-void read_edges(std::istream &is, Edges &edges, const int kkel, const int kkell,
+void read_edges(Text_Cursor &t, Edges &edges, const int kkel, const int kkell,
     const int kkegl) {
-  int idx;
   edges.resize(kkel, kkell, kkegl);
-  auto &p1 = edges.ds().access_intv("m:e>p1");
-  auto &p2 = edges.ds().access_intv("m:e>p2");
-  for (int i = 0; i < kkell; ++i) {
-    idx = -1;
-    is >> idx;
-    if (idx != i + 1) {
-      std::cerr << "Edge " << i + 1 << " read error" << std::endl;
-      exit(1);
-    }
-    is >> edges.mask[i] >> edges.comm_type[i] >> p1[i] >> p2[i] >> std::ws;
-    --p1[i];
-    --p2[i];
-  }
-  expect_line(is, "Ghost Edges");
-  skip_line(is);
-  for (int i = 0; i < kkegl; ++i) {
-    idx = -1;
-    is >> idx;
-    if (idx != i + 1) {
-      std::cerr << "Ghost edge " << i + 1 << " read error" << std::endl;
-      exit(1);
-    }
-    is >> edges.cpy_idx[i] >> edges.ghost_mask[i] >> edges.src_idx[i] >>
-        edges.src_pe[i] >> std::ws;
-    --edges.cpy_idx[i];
-    --edges.src_idx[i];
-  }
+  auto &ds = edges.ds();
+  read_rows(t, edges, kkell, "Edge",
+      {&ds.access_intv("m:e>p1"), &ds.access_intv("m:e>p2")});
+  read_ghosts(t, edges, kkegl, "Ghost Edges", "Ghost edge");
 }
 
-void read_faces(std::istream &is, Faces &faces, const int kkfl, const int kkfll,
+void read_faces(Text_Cursor &t, Faces &faces, const int kkfl, const int kkfll,
     const int kkfgl) {
-  int idx;
   faces.resize(kkfl, kkfll, kkfgl);
-  auto &z1 = faces.ds().access_intv("m:f>z1");
-  auto &z2 = faces.ds().access_intv("m:f>z2");
-  for (int i = 0; i < kkfll; ++i) {
-    idx = -1;
-    is >> idx;
-    if (idx != i + 1) {
-      std::cerr << "Face " << i + 1 << " read error" << std::endl;
-      exit(1);
-    }
-    is >> faces.mask[i] >> faces.comm_type[i] >> z1[i] >> z2[i] >> std::ws;
-    --z1[i];
-    --z2[i];
-  }
-  expect_line(is, "Ghost Faces");
-  skip_line(is);
-  for (int i = 0; i < kkfgl; ++i) {
-    idx = -1;
-    is >> idx;
-    if (idx != i + 1) {
-      std::cerr << "Ghost face " << i + 1 << " read error" << std::endl;
-      exit(1);
-    }
-    is >> faces.cpy_idx[i] >> faces.ghost_mask[i] >> faces.src_idx[i] >>
-        faces.src_pe[i] >> std::ws;
-    --faces.cpy_idx[i];
-    --faces.src_idx[i];
-  }
+  auto &ds = faces.ds();
+  read_rows(t, faces, kkfll, "Face",
+      {&ds.access_intv("m:f>z1"), &ds.access_intv("m:f>z2")});
+  read_ghosts(t, faces, kkfgl, "Ghost Faces", "Ghost face");
 }
 
-void read_corners(std::istream &is, Corners &corners, const int kkcl,
+void read_corners(Text_Cursor &t, Corners &corners, const int kkcl,
     const int kkcll, const int kkcgl) {
-  int idx;
   corners.resize(kkcl, kkcll, kkcgl);
-  auto &p = corners.ds().access_intv("m:c>p");
-  auto &z = corners.ds().access_intv("m:c>z");
-  for (int i = 0; i < kkcll; ++i) {
-    idx = -1;
-    is >> idx;
-    if (idx != i + 1) {
-      std::cerr << "Face " << i + 1 << " read error" << std::endl;
-      exit(1);
-    }
-    is >> corners.mask[i] >> corners.comm_type[i] >> p[i] >> z[i] >> std::ws;
-    --p[i];
-    --z[i];
-  }
-  expect_line(is, "Ghost Corners");
-  skip_line(is);
-  for (int i = 0; i < kkcgl; ++i) {
-    idx = -1;
-    is >> idx;
-    if (idx != i + 1) {
-      std::cerr << "Ghost corner " << i + 1 << " read error" << std::endl;
-      exit(1);
-    }
-    is >> corners.cpy_idx[i] >> corners.ghost_mask[i] >> corners.src_idx[i] >>
-        corners.src_pe[i] >> std::ws;
-    --corners.cpy_idx[i];
-    --corners.src_idx[i];
-  }
+  auto &ds = corners.ds();
+  read_rows(t, corners, kkcll, "Corner",
+      {&ds.access_intv("m:c>p"), &ds.access_intv("m:c>z")});
+  read_ghosts(t, corners, kkcgl, "Ghost Corners", "Ghost corner");
 }
 
-void read_mpi(std::istream &is, Entity &e) {
-  expect_line(is, "Recv From");
-  int numpes = read_tag(is, "num PEs");
-  int total_elem = read_tag(is, "total elem");
-  e.myCpys.resize(numpes);
+void read_neighbors(Text_Cursor &t, Ume::Comm::Neighbors &nbrs,
+    char const *const what, char const *const name) {
+  int const numpes = read_tag(t, "num PEs");
+  int const total_elem = read_tag(t, "total elem");
+  nbrs.resize(numpes);
   int totalCount = 0;
   for (int i = 0; i < numpes; ++i) {
-    e.myCpys[i].pe = read_tag(is, "rmt PE");
-    int const elem_count = read_tag(is, "num elem");
-    e.myCpys[i].elements.resize(elem_count);
-    for (int j = 0; j < elem_count; ++j) {
-      is >> e.myCpys[i].elements[j];
-      if (!is) {
-        std::cerr << "read_mpi: input error on RecvFrom " << i << ' ' << j
-                  << std::endl;
-        exit(1);
-      }
-      --e.myCpys[i].elements[j];
-    }
-    is >> std::ws;
-    totalCount += elem_count;
-  }
-  if (totalCount != total_elem) {
-    std::cerr << "read_mpi error myCpys" << std::endl;
-    exit(1);
-  }
-  expect_line(is, "Send To");
-  numpes = read_tag(is, "num PEs");
-  total_elem = read_tag(is, "total elem");
-  e.mySrcs.resize(numpes);
-  totalCount = 0;
-  for (int i = 0; i < numpes; ++i) {
-    e.mySrcs[i].pe = read_tag(is, "rmt PE");
-    int const elem_count = read_tag(is, "num elem");
-    e.mySrcs[i].elements.resize(elem_count);
+    nbrs[i].pe = read_tag(t, "rmt PE");
+    int const elem_count = read_tag(t, "num elem");
+    nbrs[i].elements.resize(elem_count);
     for (int j = 0; j < elem_count; ++j) {
-      is >> e.mySrcs[i].elements[j];
-      if (!is) {
-        std::cerr << "read_mpi: input error on SendTo " << i << ' ' << j
-                  << std::endl;
-        exit(1);
-      }
-      --e.mySrcs[i].elements[j];
+      if (!t.number(nbrs[i].elements[j]))
+        throw Read_Error(std::string("read_mpi: input error on ") + what +
+            " " + std::to_string(i) + ' ' + std::to_string(j));
+      --nbrs[i].elements[j];
     }
-    is >> std::ws;
+    t.skip_ws();
     totalCount += elem_count;
   }
-  if (totalCount != total_elem) {
-    std::cerr << "read_mpi error mySrcs" << std::endl;
-    exit(1);
-  }
+  if (totalCount != total_elem)
+    throw Read_Error(std::string("read_mpi error ") + name);
+}
+
+void read_mpi(Text_Cursor &t, Entity &e) {
+  expect_line(t, "Recv From");
+  read_neighbors(t, e.myCpys, "RecvFrom", "myCpys");
+  expect_line(t, "Send To");
+  read_neighbors(t, e.mySrcs, "SendTo", "mySrcs");
 }
 
-int read(std::istream &is, Mesh &m) {
-  m.ivtag = read_vtag(is, "Input version");
-  m.numpe = read_tag(is, "Total ranks");
-  m.mype = read_tag(is, "This rank");
-  int ndims = read_tag(is, "Num dims");
+int read(Text_Cursor &t, Mesh &m, std::vector<Text_Table> *tables) {
+  m.ivtag = read_vtag(t, "Input version");
+  m.numpe = read_tag(t, "Total ranks");
+  m.mype = read_tag(t, "This rank");
+  int ndims = read_tag(t, "Num dims");
   if (ndims != 3) {
     std::cerr << "Error: Ume only works on 3-D meshes, and this input is "
               << ndims << "-D." << std::endl;
     return 1;
   }
-  int igeo = read_tag(is, "Geometry type");
+  int igeo = read_tag(t, "Geometry type");
   switch (igeo) {
   case 0:
     m.geo = Mesh::CARTESIAN;
@@ -579,7 +793,7 @@ int read(std::istream &is, Mesh &m) {
     return 2;
   }
   if (m.ivtag >= UME_VERSION_2) {
-    m.dump_iotas = read_bool_tag(is, "Iotas dumped");
+    m.dump_iotas = read_bool_tag(t, "Iotas dumped");
   } else {
     m.dump_iotas = false;
   }
@@ -593,104 +807,133 @@ int read(std::istream &is, Mesh &m) {
     $OPUS/DELFI/Mesh/MeshBase.dic for the meanings of kXtyp, which
     also differentiates between on/off processor information.
   */
-  const int kkpll = read_tag(is, "Point total");
-  const int kkpl = read_tag(is, "Point local");
-  const int kkpgl = read_tag(is, "Point ghost");
-  const int kkzll = read_tag(is, "Zone total");
-  const int kkzl = read_tag(is, "Zone local");
-  const int kkzgl = read_tag(is, "Zone ghost");
-  const int kksll = read_tag(is, "Side total");
-  const int kksl = read_tag(is, "Side local");
-  const int kksgl = read_tag(is, "Side ghost");
-  const int kkell = read_tag(is, "Edge total");
-  const int kkel = read_tag(is, "Edge local");
-  const int kkegl = read_tag(is, "Edge ghost");
-  const int kkfll = read_tag(is, "Face total");
-  const int kkfl = read_tag(is, "Face local");
-  const int kkfgl = read_tag(is, "Face ghost");
-  const int kkcll = read_tag(is, "Corner total");
-  const int kkcl = read_tag(is, "Corner local");
-  const int kkcgl = read_tag(is, "Corner ghost");
+  const int kkpll = read_tag(t, "Point total");
+  const int kkpl = read_tag(t, "Point local");
+  const int kkpgl = read_tag(t, "Point ghost");
+  const int kkzll = read_tag(t, "Zone total");
+  const int kkzl = read_tag(t, "Zone local");
+  const int kkzgl = read_tag(t, "Zone ghost");
+  const int kksll = read_tag(t, "Side total");
+  const int kksl = read_tag(t, "Side local");
+  const int kksgl = read_tag(t, "Side ghost");
+  const int kkell = read_tag(t, "Edge total");
+  const int kkel = read_tag(t, "Edge local");
+  const int kkegl = read_tag(t, "Edge ghost");
+  const int kkfll = read_tag(t, "Face total");
+  const int kkfl = read_tag(t, "Face local");
+  const int kkfgl = read_tag(t, "Face ghost");
+  const int kkcll = read_tag(t, "Corner total");
+  const int kkcl = read_tag(t, "Corner local");
+  const int kkcgl = read_tag(t, "Corner ghost");
   int kkall = 0;
   int kkal = 0;
   int kkagl = 0;
   if (m.ivtag >= UME_VERSION_2) {
-    kkall = read_tag(is, "Iota total");
-    kkal = read_tag(is, "Iota local");
-    kkagl = read_tag(is, "Iota ghost");
-  }
-
-  expect_line(is, "Points");
-  skip_line(is);
-  read_points(is, m.points, kkpl, kkpll, kkpgl, ndims);
-
-  skip_to_line(is, "Zones");
-  skip_line(is);
-  read_zones(is, m.zones, kkzl, kkzll, kkzgl);
-
-  skip_to_line(is, "Sides");
-  skip_line(is);
-  read_sides(is, m.sides, kksl, kksll, kksgl);
-
-  skip_to_line(is, "Edges");
-  skip_line(is);
-  read_edges(is, m.edges, kkel, kkell, kkegl);
-
-  skip_to_line(is, "Faces");
-  skip_line(is);
-  read_faces(is, m.faces, kkfl, kkfll, kkfgl);
-
-  skip_to_line(is, "Corners");
-  skip_line(is);
-  read_corners(is, m.corners, kkcl, kkcll, kkcgl);
+    kkall = read_tag(t, "Iota total");
+    kkal = read_tag(t, "Iota local");
+    kkagl = read_tag(t, "Iota ghost");
+  }
+
+  /* Parse each table, or with `tables`, just note where it is */
+  auto table = [&](Entity &e, int const num_rows, int const num_ghosts,
+                   char const *const ghost_line,
+                   std::function<void(Text_Cursor &)> parse) {
+    if (!tables) {
+      parse(t);
+      return;
+    }
+    Text_Cursor const start = t;
+    skip_table(t, num_rows, num_ghosts, ghost_line);
+    if (t.file)
+      t.file->drop(start.pos, t.pos);
+    tables->push_back({&e, start, t.pos, std::move(parse)});
+  };
+
+  expect_line(t, "Points");
+  t.skip_line();
+  table(m.points, kkpll, kkpgl, "Ghost Points", [=, &m](Text_Cursor &c) {
+    read_points(c, m.points, kkpl, kkpll, kkpgl, ndims);
+  });
+
+  skip_to_line(t, "Zones");
+  t.skip_line();
+  table(m.zones, kkzll, kkzgl, "Ghost Zones", [=, &m](Text_Cursor &c) {
+    read_zones(c, m.zones, kkzl, kkzll, kkzgl);
+  });
+
+  skip_to_line(t, "Sides");
+  t.skip_line();
+  table(m.sides, kksll, kksgl, "Ghost Sides", [=, &m](Text_Cursor &c) {
+    read_sides(c, m.sides, kksl, kksll, kksgl);
+  });
+
+  skip_to_line(t, "Edges");
+  t.skip_line();
+  table(m.edges, kkell, kkegl, "Ghost Edges", [=, &m](Text_Cursor &c) {
+    read_edges(c, m.edges, kkel, kkell, kkegl);
+  });
+
+  skip_to_line(t, "Faces");
+  t.skip_line();
+  table(m.faces, kkfll, kkfgl, "Ghost Faces", [=, &m](Text_Cursor &c) {
+    read_faces(c, m.faces, kkfl, kkfll, kkfgl);
+  });
+
+  skip_to_line(t, "Corners");
+  t.skip_line();
+  table(m.corners, kkcll, kkcgl, "Ghost Corners", [=, &m](Text_Cursor &c) {
+    read_corners(c, m.corners, kkcl, kkcll, kkcgl);
+  });
 
   if (m.dump_iotas) {
-    skip_to_line(is, "Iotas");
-    skip_line(is);
-    read_iotas(is, m.iotas, kkal, kkall, kkagl);
+    skip_to_line(t, "Iotas");
+    t.skip_line();
+    table(m.iotas, kkall, kkagl, "Ghost Iotas", [=, &m](Text_Cursor &c) {
+      read_iotas(c, m.iotas, kkal, kkall, kkagl);
+    });
   }
 
-  const int has_mpi = read_tag(is, "Has MPI connectivity");
+  const int has_mpi = read_tag(t, "Has MPI connectivity");
   if (has_mpi) {
-    skip_to_line(is, "C-MPI");
-    read_mpi(is, m.corners);
+    skip_to_line(t, "C-MPI");
+    read_mpi(t, m.corners);
 
-    skip_to_line(is, "E-MPI");
-    read_mpi(is, m.edges);
+    skip_to_line(t, "E-MPI");
+    read_mpi(t, m.edges);
 
-    skip_to_line(is, "F-MPI");
-    read_mpi(is, m.faces);
+    skip_to_line(t, "F-MPI");
+    read_mpi(t, m.faces);
 
-    skip_to_line(is, "P-MPI");
-    read_mpi(is, m.points);
+    skip_to_line(t, "P-MPI");
+    read_mpi(t, m.points);
 
-    skip_to_line(is, "S-MPI");
-    read_mpi(is, m.sides);
+    skip_to_line(t, "S-MPI");
+    read_mpi(t, m.sides);
 
-    skip_to_line(is, "Z-MPI");
-    read_mpi(is, m.zones);
+    skip_to_line(t, "Z-MPI");
+    read_mpi(t, m.zones);
 
     if (m.dump_iotas) {
-      skip_to_line(is, "A-MPI");
-      read_mpi(is, m.iotas);
+      skip_to_line(t, "A-MPI");
+      read_mpi(t, m.iotas);
     }
   }
 
-  const size_t num_mats = read_tag(is, "Num materials");
+  const size_t num_mats = read_tag(t, "Num materials");
   m.zones.subsets.resize(num_mats);
   for (size_t i = 0; i < num_mats; ++i) {
-    m.zones.subsets[i].name = read_tag_str(is, "Mat name");
-    const size_t num_elements = read_tag(is, "Num mat zones");
-    m.zones.subsets[i].lsize = read_tag(is, "Local mat zones");
+    m.zones.subsets[i].name = read_tag_str(t, "Mat name");
+    const size_t num_elements = read_tag(t, "Num mat zones");
+    m.zones.subsets[i].lsize = read_tag(t, "Local mat zones");
     m.zones.subsets[i].elements.resize(num_elements);
     for (size_t j = 0; j < num_elements; ++j) {
-      is >> m.zones.subsets[i].elements[j];
+      t.number(m.zones.subsets[i].elements[j]);
     }
     m.zones.subsets[i].mask.resize(num_elements);
     for (size_t j = 0; j < num_elements; ++j) {
-      is >> m.zones.subsets[i].mask[j];
+      t.number(m.zones.subsets[i].mask[j]);
     }
-    is >> std::ws;
+    t.skip_ws();
   }
 
   return 0;
@@ -20,21 +20,33 @@
   should have filenames of the form '<basename>.<pe>.ume', where <basename> is
   an arbitray string provided on the command line, and <pe> is a rank number
   with a printf format of "%05d" (zero-filled, five digits)
+
+  Alternatively, a mesh description such as "hex:64x64x64" or "tet:32" (see
+  Ume::Mesh_Spec::parse) in place of the basename generates the mesh in
+  memory, split across the ranks, with no file I/O.
 */
 
 #include "Ume/Comm_MPI.hh"
 #include "Ume/SOA_Idx_Mesh.hh"
 #include "Ume/Timer.hh"
 #include "Ume/face_area.hh"
+#include "Ume/generate_mesh.hh"
 #include "Ume/gradient.hh"
+#include "Ume/memory.hh"
 #include "Ume/renumbering.hh"
 #include "Ume/process_mgmt.hh"
 #include "Ume/utils.hh"
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdio>
-#include <fstream>
+#include <cstdlib>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
 #include <vector>
 
 using Mesh = Ume::SOA_Idx::Mesh;
@@ -43,11 +55,48 @@ using VEC3V_T = typename Ume::DS_Types::VEC3V_T;
 using VEC3_T = typename Ume::DS_Types::VEC3_T;
 
 bool read_mesh(char const *const basename, int const mype, Mesh &mesh);
+bool generate_mesh(
+    char const *const desc, int const mype, int const numpe, Mesh &mesh);
 bool test_point_gathscat(Mesh &mesh);
+bool check_renumbered_comm(Mesh &mesh);
+bool check_renumbered_gradzatz(Mesh &mesh, VEC3V_T const &zgrad,
+    VEC3V_T const &pgrad, VEC3V_T const &base_zgrad,
+    VEC3V_T const &base_pgrad);
 void check_gradzatz_diffs(Mesh const &mesh, int const &centered_zone_index,
     VEC3V_T const &zgrad, VEC3V_T const &zgrad_invert, VEC3V_T const &pgrad,
     VEC3V_T const &pgrad_invert);
 
+/* Time ic calls of the original or inverted gradient kernel, after an
+   untimed call that builds the derived fields that it uses */
+double time_gradzatz(Mesh &mesh, DBLV_T const &zfield, size_t const ic,
+    bool const invert, VEC3V_T &zgrad, VEC3V_T &pgrad) {
+  auto const kernel = invert ? Ume::gradzatz_invert : Ume::gradzatz;
+  kernel(mesh, zfield, zgrad, pgrad);
+  Ume::Timer timer;
+  timer.start();
+  for (size_t i = 0; i < ic; i++) {
+    kernel(mesh, zfield, zgrad, pgrad);
+    mesh.ds->evict_to_budget();
+  }
+  timer.stop();
+  GetMemPool().Pool().Shrink();
+  return timer.seconds();
+}
+
+/* The average number of memory pool claims made per kernel call, given the
+   pool's claim count before the timing loop */
+double pool_claims_per_call(size_t const claims_before, size_t const ic) {
+  size_t const claims = GetMemPool().Pool().NumClaims() - claims_before;
+  return ic > 0 ? static_cast<double>(claims) / static_cast<double>(ic) : 0.0;
+}
+
+/* Report the locality of the mesh ordering on this rank */
+void print_locality(std::string const &name, Ume::Locality_Metrics const &m) {
+  std::cout << "Locality of " << name << " ordering (mean index distance):"
+            << " c>p " << m.c2p << ", c>z " << m.c2z << ", s>z " << m.s2z
+            << ", s>p1-p2 " << m.point_bandwidth << "\n";
+}
+
 int main(int argc, char *argv[]) {
   /* Initialize MPI and instantiate the MPI Transport. */
   Ume::Comm::MPI comm(&argc, &argv);
@@ -56,17 +105,51 @@ int main(int argc, char *argv[]) {
    * after the call to MPI_Init for best performance. */
   Ume::initialize(argc, argv);
 
-  /* Create a mesh instance and attach the communicator to the mesh. */
-  Mesh mesh;
+  /* UME_RENUMBER selects the renumbering strategies to benchmark, as a
+   * comma-separated list of the names in Ume::renumber_strategy_names(),
+   * such as "wavefront,hilbert,rcm,bisection".  Each one renumbers the
+   * mesh as left by the last.  The names are checked before any work is
+   * done. */
+  std::vector<std::string> renumber_methods;
+  char const *const methods = std::getenv("UME_RENUMBER");
+  std::istringstream method_list(methods ? methods : "wavefront");
+  for (std::string name; std::getline(method_list, name, ',');) {
+    if (!Ume::make_renumber_strategy(name)) {
+      if (comm.pe() == 0) {
+        std::cerr << "Unknown renumbering method \"" << name
+                  << "\". The known methods are:";
+        for (auto const &known : Ume::renumber_strategy_names())
+          std::cerr << ' ' << known;
+        std::cerr << std::endl;
+      }
+      Ume::finalize();
+      comm.stop();
+      return EXIT_FAILURE;
+    }
+    renumber_methods.push_back(name);
+  }
+
+  /* Create a mesh instance and attach the communicator to the mesh.  The
+   * mesh holds Kokkos::Views (such as the device copies of its RaggedRight
+   * maps), so it is destroyed before Ume::finalize(). */
+  auto mesh_ptr = std::make_unique<Mesh>();
+  Mesh &mesh = *mesh_ptr;
   mesh.comm = &comm;
 
   if (comm.pe() == 0)
     std::cout << "Initializing mesh..." << std::endl;
 
-  /* Read the data file */
-  if (!read_mesh(argv[1], comm.pe(), mesh)) {
+  /* Generate the mesh, or read the data file */
+  if (generate_mesh(argv[1], comm.pe(), comm.numpe(), mesh)) {
+    if (comm.pe() == 0)
+      std::cout << "Mesh generation took: " << mesh.load_seconds << "s\n";
+  } else if (!read_mesh(argv[1], comm.pe(), mesh)) {
     std::cerr << "Aborting." << std::endl;
     return EXIT_FAILURE;
+  } else if (comm.pe() == 0) {
+    double const load_gb = static_cast<double>(mesh.load_bytes) * 1e-9;
+    std::cout << "Mesh read took: " << mesh.load_seconds << "s ("
+              << load_gb / mesh.load_seconds << " GB/s on rank 0)\n";
   }
 
   size_t ic = 1; // set iteration count to 1 for default
@@ -78,6 +161,13 @@ int main(int argc, char *argv[]) {
      UME_DEBUG_RANK environment variable. */
   Ume::debug_attach_point(comm.pe());
 
+  /* An optional limit (in MB) on the memory held by derived Datastore fields.
+     When set, the least-recently-used derived fields are evicted between
+     kernel calls and rebuilt on their next access. */
+  if (char const *budget = std::getenv("UME_DS_BUDGET_MB")) {
+    mesh.ds->set_memory_budget(std::strtoull(budget, nullptr, 10) << 20);
+  }
+
   /*
   if (test_point_gathscat(mesh)) {
     std::cout << comm.id() << ": test_point_gathscat PASS" << std::endl;
@@ -86,6 +176,19 @@ int main(int argc, char *argv[]) {
   }
   */
 
+  /* Time the construction of the inverse connectivity maps, which are
+     otherwise built on first use inside the kernels below. */
+  Ume::Timer inverse_time;
+  inverse_time.start();
+  for (char const *name :
+      {"m:p>zs", "m:p>rc", "m:z>p", "m:z>c", "m:z>pz", "m:c>s"}) {
+    [[maybe_unused]] auto const &map = mesh.ds->caccess_intrr(name);
+  }
+  inverse_time.stop();
+  if (comm.pe() == 0)
+    std::cout << "Inverse connectivity build took: " << inverse_time.seconds()
+              << "s\n";
+
   if (comm.pe() == 0)
     std::cout << "Creating zone field..." << std::endl;
 
@@ -114,24 +217,34 @@ int main(int argc, char *argv[]) {
   VEC3V_T pgrad, zgrad;
   Ume::Timer orig_time;
   Ume::gradzatz(mesh, zfield, zgrad, pgrad);
+  size_t const orig_claims = GetMemPool().Pool().NumClaims();
   orig_time.start();
   for (size_t i = 0; i < ic; i++) {
     Ume::gradzatz(mesh, zfield, zgrad, pgrad);
+    mesh.ds->evict_to_budget();
   }
   orig_time.stop();
+  double const orig_claims_per_call = pool_claims_per_call(orig_claims, ic);
+  GetMemPool().Pool().Shrink();
 
   VEC3V_T pgrad_invert, zgrad_invert;
   Ume::Timer invert_time;
   Ume::gradzatz_invert(mesh, zfield, zgrad_invert, pgrad_invert);
+  size_t const invert_claims = GetMemPool().Pool().NumClaims();
   invert_time.start();
   for (size_t i = 0; i < ic; i++) {
     Ume::gradzatz_invert(mesh, zfield, zgrad_invert, pgrad_invert);
+    mesh.ds->evict_to_budget();
   }
   invert_time.stop();
+  double const invert_claims_per_call = pool_claims_per_call(invert_claims, ic);
+  GetMemPool().Pool().Shrink();
 
   if (comm.pe() == 0) {
-    std::cout << "Original algorithm took: " << orig_time.seconds() << "s\n";
-    std::cout << "Inverted algorithm took: " << invert_time.seconds() << "s\n";
+    std::cout << "Original algorithm took: " << orig_time.seconds() << "s ("
+              << orig_claims_per_call << " pool claims/call)\n";
+    std::cout << "Inverted algorithm took: " << invert_time.seconds() << "s ("
+              << invert_claims_per_call << " pool claims/call)\n";
     std::cout << "Checking gradient result..." << std::endl;
   }
 
@@ -147,41 +260,106 @@ int main(int argc, char *argv[]) {
   DBLV_T face_area(mesh.faces.size(), -100000.0);
   Ume::Timer face_time;
   Ume::calc_face_area(mesh, face_area);
+  size_t const face_claims = GetMemPool().Pool().NumClaims();
   face_time.start();
   for (size_t i = 0; i < ic; i++) {
     Ume::calc_face_area(mesh, face_area);
+    mesh.ds->evict_to_budget();
   }
   face_time.stop();
+  double const face_claims_per_call = pool_claims_per_call(face_claims, ic);
+  GetMemPool().Pool().Shrink();
 
   if (comm.pe() == 0)
-    std::cout << "Face area computation took: " << face_time.seconds() << "s\n";
+    std::cout << "Face area computation took: " << face_time.seconds() << "s ("
+              << face_claims_per_call << " pool claims/call)\n";
 
   if (mesh.ivtag >= UME_VERSION_2) {
+    /* Keep the zone field in the Datastore, so that renumbering carries it
+     * along with the rest of the zone data. */
+    mesh.ds->insert("zfield",
+        std::make_unique<Ume::DS_Entry>(Ume::DS_Types::Types::DBLV));
+    mesh.ds->access_dblv("zfield").assign(zfield.begin(), zfield.end());
+    /* Likewise the original index of each zone and point, so that the
+     * gradients on the renumbered mesh can be checked against the ones
+     * above */
+    for (auto const &[var, size] : {std::pair{"zindex0", mesh.zones.size()},
+             std::pair{"pindex0", mesh.points.size()}}) {
+      mesh.ds->insert(
+          var, std::make_unique<Ume::DS_Entry>(Ume::DS_Types::Types::INTV));
+      auto &index = mesh.ds->access_intv(var);
+      index.resize(size);
+      std::iota(index.begin(), index.end(), 0);
+    }
+
     if (comm.pe() == 0)
-      std::cout << "Renumbering mesh entities..." << std::endl;
+      print_locality("original", Ume::locality_metrics(mesh));
+    for (auto const &name : renumber_methods) {
+      auto const strategy = Ume::make_renumber_strategy(name);
+      if (strategy->needs_iotas() && !mesh.dump_iotas) {
+        if (comm.pe() == 0)
+          std::cout << "Iotas must be present in the mesh for " << name
+                    << " renumbering. Skipping..." << std::endl;
+        continue;
+      }
+
+      if (comm.pe() == 0)
+        std::cout << "Renumbering mesh entities (" << name << ")..."
+                  << std::endl;
 
-    if (mesh.dump_iotas) {
       Ume::Timer renumber_time;
-      Ume::renumber_mesh(mesh);
       renumber_time.start();
-      for (size_t i = 0; i < ic; i++) {
-        Ume::renumber_mesh(mesh);
-      }
+      strategy->renumber(mesh);
       renumber_time.stop();
 
-      if (comm.pe() == 0)
+      if (comm.pe() == 0) {
         std::cout << "Renumbering algorithm took: " << renumber_time.seconds()
                   << "s\n";
-    } else {
-      if (comm.pe() == 0)
-        std::cout << "Iotas must be present in the mesh for renumbering."
-                  << " Skipping renumbering..." << std::endl;
+        print_locality(name, Ume::locality_metrics(mesh));
+      }
+      if (!check_renumbered_comm(mesh))
+        std::cout << "PE" << comm.pe() << " communication check after "
+                  << name << " renumbering FAIL" << std::endl;
+
+      /* Repeat the gradient benchmark on the renumbered mesh */
+      auto const &renum_zfield = mesh.ds->caccess_dblv("zfield");
+      int renum_czi = 0;
+      while (renum_zfield[renum_czi] == 0.0)
+        renum_czi += 1;
+
+      VEC3V_T renum_pgrad, renum_zgrad, renum_pgrad_invert, renum_zgrad_invert;
+      double const renum_orig_seconds = time_gradzatz(
+          mesh, renum_zfield, ic, false, renum_zgrad, renum_pgrad);
+      double const renum_invert_seconds = time_gradzatz(mesh, renum_zfield,
+          ic, true, renum_zgrad_invert, renum_pgrad_invert);
+
+      if (comm.pe() == 0) {
+        std::cout << "Original algorithm after " << name
+                  << " renumbering took: " << renum_orig_seconds
+                  << "s (speedup "
+                  << orig_time.seconds() / renum_orig_seconds << ")\n";
+        std::cout << "Inverted algorithm after " << name
+                  << " renumbering took: " << renum_invert_seconds
+                  << "s (speedup "
+                  << invert_time.seconds() / renum_invert_seconds << ")\n";
+        std::cout << "Checking renumbered gradient result..." << std::endl;
+      }
+      check_gradzatz_diffs(mesh, renum_czi, renum_zgrad, renum_zgrad_invert,
+          renum_pgrad, renum_pgrad_invert);
+      if (!check_renumbered_gradzatz(mesh, renum_zgrad, renum_pgrad, zgrad,
+              pgrad))
+        std::cout << "PE" << comm.pe() << " gradient check after " << name
+                  << " renumbering FAIL" << std::endl;
     }
   }
 
+  if (mesh.ds->memory_budget() > 0 && comm.pe() == 0)
+    mesh.ds->print_eviction_stats(std::cout);
+
   if (comm.pe() == 0)
     std::cout << "Done." << std::endl;
 
+  mesh_ptr.reset();
   Ume::finalize();
   comm.stop();
   return EXIT_SUCCESS;
@@ -190,17 +368,87 @@ int main(int argc, char *argv[]) {
 bool read_mesh(char const *const basename, int const mype, Mesh &mesh) {
   char fname[80];
   sprintf(fname, "%s.%05d.ume", basename, mype);
-  std::ifstream is(fname);
-  if (!is) {
+  if (!mesh.read(fname)) {
     std::cerr << "Unable to open file \"" << fname << "\" for reading."
               << std::endl;
     return false;
   }
-  mesh.read(is);
-  is.close();
   return true;
 }
 
+/* Generate the mesh if desc describes one; returns false if it does not */
+bool generate_mesh(
+    char const *const desc, int const mype, int const numpe, Mesh &mesh) {
+  Ume::Mesh_Spec spec;
+  if (!spec.parse(desc))
+    return false;
+  spec.split_ranks(numpe);
+  Ume::Timer timer;
+  timer.start();
+  Ume::generate_mesh(spec, mype, mesh);
+  timer.stop();
+  mesh.load_seconds = timer.seconds();
+  return true;
+}
+
+/* Check that renumbering kept the communication data of each entity
+   consistent: scattering the local indices must give each ghost the
+   src_idx of its source, and a point gathscat must still sum to zero on
+   the shared points. */
+bool check_renumbered_comm(Mesh &mesh) {
+  std::pair<Ume::SOA_Idx::Entity *, char const *> const entities[] = {
+      {&mesh.points, "points"}, {&mesh.edges, "edges"}, {&mesh.faces, "faces"},
+      {&mesh.sides, "sides"}, {&mesh.corners, "corners"},
+      {&mesh.zones, "zones"}, {&mesh.iotas, "iotas"}};
+  bool result = true;
+  for (auto const &[entity, name] : entities) {
+    typename Ume::DS_Types::INTV_T idx(entity->size(), -1);
+    for (int i : entity->local_indices())
+      idx[i] = i;
+    entity->scatter(idx);
+    int num_bad = 0;
+    for (size_t g = 0; g < entity->cpy_idx.size(); ++g) {
+      int const i = entity->cpy_idx[g];
+      if (idx[i] != entity->src_idx[g] && num_bad++ < 5)
+        std::cout << "PE" << mesh.mype << " " << name << " ghost " << i
+                  << " has source index " << idx[i] << ", expected "
+                  << entity->src_idx[g] << '\n';
+    }
+    if (num_bad > 0)
+      result = false;
+  }
+  return test_point_gathscat(mesh) && result;
+}
+
+/* Compare the gradients computed on the renumbered mesh with the ones
+   computed before renumbering, through the original indices of the local
+   zones and points (zindex0 and pindex0). */
+bool check_renumbered_gradzatz(Mesh &mesh, VEC3V_T const &zgrad,
+    VEC3V_T const &pgrad, VEC3V_T const &base_zgrad,
+    VEC3V_T const &base_pgrad) {
+  double const tol = 1e-6;
+  int num_bad = 0;
+  auto const check = [&](char const *const what, int const num_local,
+                         Ume::DS_Types::INTV_T const &index0,
+                         VEC3V_T const &grad, VEC3V_T const &base_grad) {
+    for (int i = 0; i < num_local; ++i) {
+      VEC3_T const &expected = base_grad[index0[i]];
+      VEC3_T const diff = grad[i] - expected;
+      double const scale =
+          std::max(1.0, std::sqrt(Ume::dotprod(expected, expected)));
+      if (std::sqrt(Ume::dotprod(diff, diff)) > tol * scale && num_bad++ < 5)
+        std::cout << "PE" << mesh.mype << " renumbered " << what << "[" << i
+                  << "] (originally " << index0[i] << "): " << grad[i]
+                  << " vs. " << expected << "\n";
+    }
+  };
+  check("zgrad", mesh.zones.local_size(), mesh.ds->caccess_intv("zindex0"),
+      zgrad, base_zgrad);
+  check("pgrad", mesh.points.local_size(), mesh.ds->caccess_intv("pindex0"),
+      pgrad, base_pgrad);
+  return num_bad == 0;
+}
+
 bool test_point_gathscat(Mesh &mesh) {
   int const mype = mesh.comm->id();
 
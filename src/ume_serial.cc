@@ -17,7 +17,6 @@
 */
 
 #include "Ume/SOA_Idx_Mesh.hh"
-#include <fstream>
 #include <iostream>
 #include <vector>
 
@@ -50,13 +49,11 @@ std::vector<Mesh> read_meshes(int const argc, char *argv[]) {
   }
   for (int i = 1; i < argc; ++i) {
     std::cout << "Reading: " << argv[i] << '\n';
-    std::ifstream is(argv[i]);
-    if (!is) {
+    if (!ranks[i - 1].read(argv[i])) {
       std::cerr << "Unable to open file \"" << argv[i] << "\" for reading."
                 << std::endl;
       return std::vector<Mesh>{};
     }
-    ranks[i - 1].read(is);
     if (ranks[i - 1].mype != i - 1)
       need_sort = true;
   }
@@ -10,9 +10,13 @@
 */
 
 #include "Ume/Datastore.hh"
+#include "Ume/utils.hh"
 
 #include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <vector>
 
 using dsptr = Ume::Datastore::dsptr;
@@ -107,3 +111,206 @@ TEST_CASE("DS boring insert", "[Datastore]") {
   auto const &d = root->caccess_intv("boring");
   REQUIRE(d.size() == 50);
 }
+
+/* A recomputable entry that counts how many times it has been built */
+class Derived : public Ume::DS_Entry {
+public:
+  explicit Derived(int len) : Ume::DS_Entry(Types::DBLV), len_{len} {}
+  bool recomputable() const override { return true; }
+  mutable int builds = 0;
+
+protected:
+  bool init_() const override {
+    if (init_state_ == Init_State::INITIALIZED)
+      return false;
+    std::get<DBLV_T>(data_).assign(len_, 1.0);
+    builds += 1;
+    init_state_ = Init_State::INITIALIZED;
+    return true;
+  }
+
+private:
+  int len_;
+};
+
+TEST_CASE("DS eviction", "[Datastore]") {
+  dsptr root = Ume::Datastore::create_root();
+  wptr child = Ume::Datastore::create_child(root.get(), "child");
+  auto a = std::make_unique<Derived>(1000);
+  auto b = std::make_unique<Derived>(1000);
+  Derived const &ra = *a;
+  Derived const &rb = *b;
+  root->insert("a", std::move(a));
+  child->insert("b", std::move(b));
+  root->insert("boring", std::make_unique<Boring>());
+
+  CHECK(child->caccess_dblv("a").size() == 1000);
+  CHECK(child->caccess_dblv("b").size() == 1000);
+  CHECK(root->caccess_intv("boring").size() == 50);
+
+  SECTION("No budget") {
+    CHECK(root->evict_to_budget() == 0);
+    CHECK(root->eviction_stats().evictions == 0);
+  }
+
+  SECTION("Evict least recently used") {
+    root->set_memory_budget(1000 * sizeof(double));
+    CHECK(root->evict_to_budget() >= 1000 * sizeof(double));
+    auto stats = root->eviction_stats();
+    CHECK(stats.evictions == 1);
+    CHECK(stats.recomputable_bytes <= 1000 * sizeof(double));
+    /* "a" was accessed first, so it is the one that was dropped */
+    CHECK(ra.builds == 1);
+    CHECK(root->caccess_dblv("a").size() == 1000);
+    CHECK(ra.builds == 2);
+    CHECK(rb.builds == 1);
+    stats = root->eviction_stats();
+    CHECK(stats.recomputes == 1);
+    /* Non-recomputable entries are never evicted */
+    root->set_memory_budget(1);
+    root->evict_to_budget();
+    CHECK(root->caccess_intv("boring").size() == 50);
+    CHECK(root->eviction_stats().evictions == 3);
+  }
+
+  SECTION("Shrink") {
+    root->access_intv("boring").resize(10);
+    CHECK(root->shrink_to_fit() == 40 * sizeof(int));
+    CHECK(root->caccess_intv("boring").size() == 10);
+    CHECK(root->shrink_to_fit() == 0);
+  }
+
+  SECTION("Invalidate derived") {
+    using T = Ume::Datastore::Types;
+    CHECK(root->is_primary("boring", T::INTV));
+    CHECK_FALSE(root->is_primary("boring", T::DBLV));
+    CHECK_FALSE(root->is_primary("a", T::DBLV));
+    CHECK_FALSE(root->is_primary("missing", T::INTV));
+    CHECK(root->invalidate_derived() >= 2000 * sizeof(double));
+    CHECK(root->caccess_intv("boring").size() == 50);
+    CHECK(child->caccess_dblv("b").size() == 1000);
+    CHECK(rb.builds == 2);
+    /* Rebuilding an invalidated field is not a recompute after eviction */
+    auto const stats = root->eviction_stats();
+    CHECK(stats.evictions == 0);
+    CHECK(stats.recomputes == 0);
+  }
+}
+
+/* Populate one entry of each DS_Type */
+void fill_all_types(Ume::Datastore &ds) {
+  using T = Ume::Datastore::Types;
+  char const *names[] = {"i", "iv", "irr", "d", "dv", "drr", "v", "vv", "vrr"};
+  T types[] = {T::INT, T::INTV, T::INTRR, T::DBL, T::DBLV, T::DBLRR, T::VEC3,
+      T::VEC3V, T::VEC3RR};
+  for (int i = 0; i < 9; ++i)
+    ds.insert(names[i], std::make_unique<Ume::DS_Entry>(types[i]));
+}
+
+TEST_CASE("DS snapshot", "[Datastore]") {
+  using Vec3 = Ume::Datastore::VEC3_T;
+  dsptr root = Ume::Datastore::create_root();
+  wptr child = Ume::Datastore::create_child(root.get(), "child");
+  fill_all_types(*root);
+  root->insert("derived", std::make_unique<Derived>(10));
+  child->insert("unused", std::make_unique<Derived>(10));
+
+  std::vector<int> const idx{1, 2, 3};
+  root->access_int("i") = 7;
+  root->access_intv("iv") = {1, 2, 3};
+  root->access_intrr("irr").init(2);
+  root->access_intrr("irr").assign(1, idx.begin(), idx.end());
+  root->access_dbl("d") = 2.5;
+  root->access_dblv("dv") = {0.5, 1.5};
+  root->access_dblrr("drr").init(1);
+  root->access_vec3("v") = Vec3(4.0);
+  root->access_vec3v("vv").assign(3, Vec3(1.0));
+  root->access_vec3rr("vrr").init(3);
+  CHECK(child->caccess_dblv("derived").size() == 10);
+
+  std::stringstream ss;
+  root->write_snapshot(ss);
+
+  dsptr root2 = Ume::Datastore::create_root();
+  wptr child2 = Ume::Datastore::create_child(root2.get(), "child");
+  fill_all_types(*root2);
+  auto d2 = std::make_unique<Derived>(10);
+  auto u2 = std::make_unique<Derived>(10);
+  Derived const &rd2 = *d2;
+  Derived const &ru2 = *u2;
+  root2->insert("derived", std::move(d2));
+  child2->insert("unused", std::move(u2));
+
+  REQUIRE(root2->read_snapshot(ss));
+  CHECK(root2->caccess_int("i") == 7);
+  CHECK(root2->caccess_intv("iv") == root->caccess_intv("iv"));
+  CHECK(root2->caccess_intrr("irr") == root->caccess_intrr("irr"));
+  CHECK(root2->caccess_intrr("irr").size(1) == 3);
+  CHECK(root2->caccess_dbl("d") == 2.5);
+  CHECK(root2->caccess_dblv("dv") == root->caccess_dblv("dv"));
+  CHECK(root2->caccess_dblrr("drr") == root->caccess_dblrr("drr"));
+  CHECK(root2->caccess_vec3("v") == Vec3(4.0));
+  CHECK(root2->caccess_vec3v("vv") == root->caccess_vec3v("vv"));
+  CHECK(root2->caccess_vec3rr("vrr") == root->caccess_vec3rr("vrr"));
+  /* The derived field was restored, not recomputed */
+  CHECK(child2->caccess_dblv("derived").size() == 10);
+  CHECK(rd2.builds == 0);
+  /* Entries that were never initialized are not in the snapshot */
+  CHECK(child2->caccess_dblv("unused").size() == 10);
+  CHECK(ru2.builds == 1);
+
+  SECTION("Asynchronous write") {
+    auto done = root->write_snapshot_async("test_ds_snapshot.bin");
+    root->access_int("i") = 8; // The snapshot was taken before this
+    REQUIRE(done.get());
+    std::ifstream is("test_ds_snapshot.bin", std::ios::binary);
+    dsptr root3 = Ume::Datastore::create_root();
+    fill_all_types(*root3);
+    REQUIRE(root3->read_snapshot(is));
+    CHECK(root3->caccess_int("i") == 7);
+    is.close();
+    std::remove("test_ds_snapshot.bin");
+  }
+
+  SECTION("Type mismatch") {
+    dsptr bad = Ume::Datastore::create_root();
+    for (char const *n : {"d", "i"})
+      bad->insert(n, std::make_unique<Ume::DS_Entry>(Ume::Datastore::Types::DBL));
+    bad->access_dbl("d") = 1.0;
+    ss.seekg(0);
+    CHECK(!bad->read_snapshot(ss));
+    /* "d" comes before "i" in the snapshot, but was not changed */
+    CHECK(bad->caccess_dbl("d") == 1.0);
+  }
+
+  SECTION("Damaged entries") {
+    auto snapshot = [](int const type, int const state) {
+      std::stringstream s;
+      Ume::write_bin(s, std::string{"ds_snapshot"});
+      Ume::write_bin(s, int{UME_DS_SNAPSHOT_1});
+      Ume::write_bin(s, std::string{"root"});
+      Ume::write_bin(s, size_t{1});
+      Ume::write_bin(s, std::string{"i"});
+      Ume::write_bin(s, type);
+      Ume::write_bin(s, state);
+      Ume::write_bin(s, int{5});
+      Ume::write_bin(s, size_t{0});
+      return s;
+    };
+    int const int_type = static_cast<int>(Ume::Datastore::Types::INT);
+    dsptr root3 = Ume::Datastore::create_root();
+    root3->insert(
+        "i", std::make_unique<Ume::DS_Entry>(Ume::Datastore::Types::INT));
+    root3->access_int("i") = 3;
+    auto s = snapshot(42, 2);
+    CHECK(!root3->read_snapshot(s));
+    s = snapshot(-1, 2);
+    CHECK(!root3->read_snapshot(s));
+    s = snapshot(int_type, 7);
+    CHECK(!root3->read_snapshot(s));
+    CHECK(root3->caccess_int("i") == 3);
+    s = snapshot(int_type, 2);
+    CHECK(root3->read_snapshot(s));
+    CHECK(root3->caccess_int("i") == 5);
+  }
+}
@@ -0,0 +1,242 @@
+/*
+  Copyright (c) 2023, Triad National Security, LLC. All rights reserved.
+
+  This is open source software; you can redistribute it and/or modify it under
+  the terms of the BSD-3 License. If software is modified to produce derivative
+  works, such modified software should be clearly marked, so as not to confuse
+  it with the version available from LANL. Full text of the BSD-3 License can be
+  found in the LICENSE.md file, and the full assertion of copyright in the
+  NOTICE.md file.
+*/
+
+#include "Ume/Comm_Transport.hh"
+#include "Ume/face_area.hh"
+#include "Ume/generate_mesh.hh"
+#include "Ume/gradient.hh"
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <vector>
+
+using Catch::Approx;
+using Ume::Mesh_Spec;
+using Ume::Vec3;
+using Mesh = Ume::SOA_Idx::Mesh;
+using Entity = Ume::SOA_Idx::Entity;
+
+namespace {
+
+Ume::Comm::Dummy_Transport dummy;
+
+void generate(Mesh_Spec const &spec, int const mype, Mesh &mesh) {
+  Ume::generate_mesh(spec, mype, mesh);
+  mesh.comm = &dummy;
+}
+
+double real_volume(Mesh &mesh) {
+  auto const &side_vol = mesh.ds->caccess_dblv("side_vol");
+  double vol = 0.0;
+  for (int s = 0; s < mesh.sides.local_size(); ++s)
+    if (mesh.sides.mask[s] > 0)
+      vol += side_vol[s];
+  return vol;
+}
+
+/* Check the gradient of a linear field at the points away from the boundary */
+void check_linear_gradient(Mesh &mesh) {
+  Vec3 const a{{1.0, -2.0, 3.0}};
+  auto const &zcoord = mesh.ds->caccess_vec3v("zcoord");
+  Ume::DS_Types::DBLV_T zone_field(mesh.zones.size());
+  for (int z = 0; z < mesh.zones.size(); ++z)
+    zone_field[z] = Ume::dotprod(a, zcoord[z]);
+  Ume::DS_Types::VEC3V_T zone_gradient(mesh.zones.size());
+  Ume::DS_Types::VEC3V_T point_gradient(mesh.points.size());
+  Ume::gradzatz(mesh, zone_field, zone_gradient, point_gradient);
+  int num_interior = 0;
+  for (int p = 0; p < mesh.points.local_size(); ++p) {
+    if (mesh.points.mask[p] <= 0)
+      continue;
+    ++num_interior;
+    for (int d = 0; d < 3; ++d)
+      CHECK(point_gradient[p][d] == Approx(a[d]));
+  }
+  CHECK(num_interior > 0);
+}
+
+/* A coordinate signature of an entity that the ranks can compare */
+Vec3 signature(Mesh &mesh, Entity const &e, int const i) {
+  auto const &pcoord = mesh.ds->caccess_vec3v("pcoord");
+  auto const map = [&](char const *name) {
+    return mesh.ds->caccess_intv(name)[i];
+  };
+  auto const zone_centroid = [&](int const z) {
+    auto const &c2z = mesh.ds->caccess_intv("m:c>z");
+    auto const &c2p = mesh.ds->caccess_intv("m:c>p");
+    Vec3 zc(0.0);
+    int n = 0;
+    for (int c = 0; c < mesh.corners.size(); ++c)
+      if (c2z[c] == z) {
+        zc += pcoord[c2p[c]];
+        ++n;
+      }
+    return zc / n;
+  };
+  if (&e == &mesh.points)
+    return pcoord[i];
+  if (&e == &mesh.edges)
+    return pcoord[map("m:e>p1")] + pcoord[map("m:e>p2")] * 2.0;
+  if (&e == &mesh.faces) {
+    auto const &s2f = mesh.ds->caccess_intv("m:s>f");
+    auto const &s2p1 = mesh.ds->caccess_intv("m:s>p1");
+    Vec3 fc(0.0);
+    int n = 0;
+    for (int s = 0; s < mesh.sides.size(); ++s)
+      if (s2f[s] == i) {
+        fc += pcoord[s2p1[s]];
+        ++n;
+      }
+    return fc / n;
+  }
+  if (&e == &mesh.zones)
+    return zone_centroid(i);
+  if (&e == &mesh.corners)
+    return pcoord[map("m:c>p")] + zone_centroid(map("m:c>z")) * 2.0;
+  if (&e == &mesh.sides)
+    return pcoord[map("m:s>p1")] + pcoord[map("m:s>p2")] * 2.0 +
+        zone_centroid(map("m:s>z")) * 4.0;
+  return pcoord[map("m:a>p")] + zone_centroid(map("m:a>z")) * 2.0 +
+      pcoord[mesh.ds->caccess_intv("m:s>p1")[map("m:a>s")]] * 4.0;
+}
+
+bool same(Vec3 const &a, Vec3 const &b) {
+  return Ume::vectormag(a - b) < 1.0e-12;
+}
+
+} // namespace
+
+TEST_CASE("Mesh_Spec parse", "[generate_mesh]") {
+  Mesh_Spec spec;
+  REQUIRE(spec.parse("tet:4x5x6"));
+  CHECK(spec.shape == Mesh_Spec::TET);
+  CHECK(spec.cells == std::array<int, 3>{4, 5, 6});
+  REQUIRE(spec.parse("hex:7"));
+  CHECK(spec.shape == Mesh_Spec::HEX);
+  CHECK(spec.cells == std::array<int, 3>{7, 7, 7});
+  CHECK_FALSE(spec.parse("mesh"));
+  CHECK_FALSE(spec.parse("hex:4x5"));
+  CHECK_FALSE(spec.parse("prism:4"));
+  CHECK_FALSE(spec.parse("hex:4x0x2"));
+
+  spec.cells = {64, 32, 16};
+  spec.split_ranks(8);
+  CHECK(spec.ranks == std::array<int, 3>{4, 2, 1});
+}
+
+TEST_CASE("generate_mesh hex", "[generate_mesh]") {
+  Mesh_Spec spec;
+  spec.cells = {4, 3, 2};
+  spec.extent = {2.0, 1.5, 1.0};
+  Mesh mesh;
+  generate(spec, 0, mesh);
+
+  CHECK(mesh.points.size() == 5 * 4 * 3);
+  CHECK(mesh.edges.size() == 4 * 4 * 3 + 5 * 3 * 3 + 5 * 4 * 2);
+  CHECK(mesh.faces.size() == 5 * 3 * 2 + 4 * 4 * 2 + 4 * 3 * 3);
+  /* The real zones, and an exterior zone per boundary face */
+  CHECK(mesh.zones.local_size() == 24 + 2 * (3 * 2 + 4 * 2 + 4 * 3));
+  CHECK(mesh.zones.ghost_local_size() == 0);
+  CHECK(mesh.sides.size() == 24 * 24 + 4 * 52);
+  CHECK(mesh.points.myCpys.empty());
+  CHECK(mesh.points.mySrcs.empty());
+
+  CHECK(real_volume(mesh) == Approx(3.0));
+
+  Ume::DS_Types::DBLV_T face_area(mesh.faces.size());
+  Ume::calc_face_area(mesh, face_area);
+  double total = 0.0;
+  for (double const area : face_area)
+    total += area;
+  CHECK(total == Approx(mesh.faces.size() * 0.25));
+
+  /* The normal at a corner of the box points out along its diagonal */
+  auto const &pcoord = mesh.ds->caccess_vec3v("pcoord");
+  auto const &point_norm = mesh.ds->caccess_vec3v("point_norm");
+  for (int p = 0; p < mesh.points.size(); ++p) {
+    if (pcoord[p] != Vec3(0.0))
+      continue;
+    CHECK(mesh.points.mask[p] == -1);
+    CHECK(point_norm[p][0] < 0.0);
+    CHECK(point_norm[p][0] == Approx(point_norm[p][1]));
+    CHECK(point_norm[p][0] == Approx(point_norm[p][2]));
+  }
+
+  check_linear_gradient(mesh);
+}
+
+TEST_CASE("generate_mesh tet", "[generate_mesh]") {
+  Mesh_Spec spec;
+  spec.shape = Mesh_Spec::TET;
+  spec.cells = {3, 3, 4};
+  Mesh mesh;
+  generate(spec, 0, mesh);
+
+  CHECK(mesh.zones.local_size() == 6 * 36 + 2 * 2 * (9 + 12 + 12));
+  auto const &side_vol = mesh.ds->caccess_dblv("side_vol");
+  for (int s = 0; s < mesh.sides.local_size(); ++s)
+    if (mesh.sides.mask[s] > 0)
+      REQUIRE(side_vol[s] > 0.0);
+  CHECK(real_volume(mesh) == Approx(1.0));
+
+  /* Every real side has a neighbor across its face */
+  auto const &s2s2 = mesh.ds->caccess_intv("m:s>s2");
+  for (int s = 0; s < mesh.sides.size(); ++s)
+    REQUIRE(s2s2[s2s2[s]] == s);
+
+  check_linear_gradient(mesh);
+}
+
+TEST_CASE("generate_mesh ranks", "[generate_mesh]") {
+  for (auto const shape : {Mesh_Spec::HEX, Mesh_Spec::TET}) {
+    Mesh_Spec spec;
+    spec.shape = shape;
+    spec.cells = {5, 4, 3};
+    spec.ranks = {3, 2, 1};
+    int const numpe = spec.num_ranks();
+    std::vector<Mesh> meshes(numpe);
+    double vol = 0.0;
+    for (int pe = 0; pe < numpe; ++pe) {
+      generate(spec, pe, meshes[pe]);
+      vol += real_volume(meshes[pe]);
+    }
+    CHECK(vol == Approx(1.0));
+
+    auto const entities = [](Mesh &m) {
+      return std::vector<Entity *>{&m.points, &m.edges, &m.faces, &m.zones,
+          &m.corners, &m.sides, &m.iotas};
+    };
+    for (int pe = 0; pe < numpe; ++pe) {
+      for (size_t k = 0; k < 7; ++k) {
+        Entity const &e = *entities(meshes[pe])[k];
+        /* Each copy list matches its source's list, element by element */
+        for (auto const &cpys : e.myCpys) {
+          Entity const &src = *entities(meshes[cpys.pe])[k];
+          auto const srcs = std::find_if(src.mySrcs.begin(), src.mySrcs.end(),
+              [&](auto const &n) { return n.pe == pe; });
+          REQUIRE(srcs != src.mySrcs.end());
+          REQUIRE(srcs->elements.size() == cpys.elements.size());
+          for (size_t j = 0; j < cpys.elements.size(); ++j)
+            REQUIRE(same(signature(meshes[pe], e, cpys.elements[j]),
+                signature(meshes[cpys.pe], src, srcs->elements[j])));
+        }
+        /* And each ghost's source is the same entity */
+        for (int g = 0; g < e.ghost_local_size(); ++g) {
+          REQUIRE(e.cpy_idx[g] == e.local_size() + g);
+          Entity const &src = *entities(meshes[e.src_pe[g]])[k];
+          REQUIRE(e.src_idx[g] < src.local_size());
+          REQUIRE(same(signature(meshes[pe], e, e.cpy_idx[g]),
+              signature(meshes[e.src_pe[g]], src, e.src_idx[g])));
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,72 @@
+/*
+  Copyright (c) 2023, Triad National Security, LLC. All rights reserved.
+
+  This is open source software; you can redistribute it and/or modify it under
+  the terms of the BSD-3 License. If software is modified to produce derivative
+  works, such modified software should be clearly marked, so as not to confuse
+  it with the version available from LANL. Full text of the BSD-3 License can be
+  found in the LICENSE.md file, and the full assertion of copyright in the
+  NOTICE.md file.
+*/
+
+#include "Ume/host_alloc.hh"
+#include "Ume/memory.hh"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+using Ume::Host_Pages;
+
+TEST_CASE("host_alloc", "[host_alloc]") {
+  for (auto const pages :
+      {Host_Pages::DEFAULT, Host_Pages::THP, Host_Pages::HUGETLB}) {
+    size_t const num_bytes = 3 * Ume::host_alloc_threshold + 100;
+    auto *const p = static_cast<char *>(Ume::host_alloc(num_bytes, pages));
+    REQUIRE(p != nullptr);
+    CHECK(reinterpret_cast<uintptr_t>(p) % Ume::host_alloc_threshold == 0);
+    p[0] = 1; // first-touched memory is zeroed and writable
+    p[num_bytes - 1] = 2;
+    CHECK(p[num_bytes - 2] == 0);
+    CHECK(Ume::host_free(p));
+    CHECK(!Ume::host_free(p));
+  }
+}
+
+TEST_CASE("host_alloc pinned", "[host_alloc]") {
+  size_t const num_bytes = Ume::host_alloc_threshold;
+  auto *const p =
+      static_cast<char *>(Ume::host_alloc(num_bytes, Host_Pages::PINNED));
+  REQUIRE(p != nullptr);
+  p[0] = 1;
+  p[num_bytes - 1] = 2;
+  CHECK(Ume::host_free(p));
+}
+
+TEST_CASE("Host_Allocator", "[host_alloc]") {
+  Host_Pages const save = Ume::host_pages();
+  Ume::host_pages() = Host_Pages::THP;
+  {
+    using HVec = std::vector<double, Ume::Host_Allocator<double>>;
+    HVec big(Ume::host_alloc_threshold / sizeof(double) + 1);
+    std::iota(big.begin(), big.end(), 0.0);
+    HVec small(16, 1.0);
+    CHECK(big.back() == static_cast<double>(big.size() - 1));
+    /* Changing the page kind must not break deallocation */
+    Ume::host_pages() = Host_Pages::DEFAULT;
+    big.resize(2 * big.size());
+    CHECK(big[10] == 10.0);
+  }
+  Ume::host_pages() = save;
+}
+
+TEST_CASE("Memory pool on huge pages", "[host_alloc]") {
+  constexpr unsigned block_size = 128;
+  MemoryPoolAllocation<HostSpace> pool(
+      Ume::host_alloc_threshold, block_size,
+      [](size_t const n) { return Ume::host_alloc(n, Host_Pages::THP); },
+      [](void *p) { Ume::host_free(p); });
+  void *a = pool.Claim(1000);
+  CHECK(reinterpret_cast<uintptr_t>(a) % Ume::host_alloc_threshold == 0);
+  CHECK(pool.Release(a) == 1024);
+}
@@ -10,10 +10,23 @@
 */
 
 #include "Ume/DS_Types.hh"
+#include "Ume/SOA_Idx_Mesh.hh"
+#include "Ume/checksum.hh"
+#include "Ume/int_codec.hh"
+#include "Ume/mapped_file.hh"
+#include "Ume/mesh_sections.hh"
 #include "Ume/utils.hh"
 
+#include <algorithm>
 #include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <limits>
 #include <sstream>
+#include <unistd.h>
 
 using INT_T = Ume::DS_Types::INT_T;
 using INTV_T = Ume::DS_Types::INTV_T;
@@ -65,3 +78,255 @@ TEST_CASE("vector<vecn>", "[IO]") {
   Ume::read_bin(iobuf, data_in);
   REQUIRE(data_out == data_in);
 }
+
+TEST_CASE("Mapped_Istream", "[IO]") {
+  INTV_T ints_out(1000), ints_in;
+  VEC3V_T vecs_out, vecs_in;
+  std::string str_in;
+  for (int i = 0; i < 1000; ++i)
+    ints_out[i] = 7 * i;
+  for (int i = 0; i < 20; ++i)
+    vecs_out.emplace_back(VEC3_T(i));
+
+  std::string const fname{"test_mapped_istream.bin"};
+  {
+    std::ofstream os(fname);
+    Ume::write_bin(os, std::string{"header"});
+    Ume::write_bin(os, ints_out);
+    Ume::write_bin(os, vecs_out);
+  }
+  {
+    Ume::Mapped_Istream is(fname);
+    REQUIRE(is.is_open());
+    Ume::read_bin(is, str_in);
+    auto const ints_pos = is.tellg();
+    Ume::read_bin(is, ints_in);
+    Ume::read_bin(is, vecs_in);
+    CHECK(str_in == "header");
+    CHECK(ints_in == ints_out);
+    CHECK(vecs_in == vecs_out);
+
+    /* Seek back and read the ints again */
+    is.seekg(ints_pos);
+    ints_in.clear();
+    Ume::read_bin(is, ints_in);
+    CHECK(ints_in == ints_out);
+  }
+  std::remove(fname.c_str());
+
+  Ume::Mapped_Istream missing("no_such_file.bin");
+  CHECK(!missing.is_open());
+  CHECK(!missing);
+}
+
+TEST_CASE("checksum64", "[IO]") {
+  /* Reference XXH64 values */
+  CHECK(Ume::checksum64("", 0) == 0xEF46DB3751D8E999ULL);
+  CHECK(Ume::checksum64("abc", 3) == 0x44BC2CF5AD770999ULL);
+
+  /* Incremental updates agree with a single pass */
+  std::vector<char> bytes(1000);
+  for (size_t i = 0; i < bytes.size(); ++i)
+    bytes[i] = static_cast<char>(i * 37);
+  Ume::Checksum c;
+  for (size_t i = 0; i < bytes.size(); i += 13)
+    c.update(bytes.data() + i, std::min<size_t>(13, bytes.size() - i));
+  CHECK(c.value() == Ume::checksum64(bytes.data(), bytes.size()));
+}
+
+TEST_CASE("Int_Codec", "[IO]") {
+  auto const round_trip = [](std::vector<int> const &in, int const threads) {
+    std::string const bytes = Ume::Int_Codec::encode(in.data(), in.size());
+    REQUIRE(Ume::Int_Codec::decoded_size(bytes.data(), bytes.size()) ==
+        in.size());
+    std::vector<int> out(in.size(), -1);
+    REQUIRE(Ume::Int_Codec::decode(
+        bytes.data(), bytes.size(), out.data(), threads));
+    CHECK(out == in);
+    return bytes.size();
+  };
+
+  round_trip({}, 1);
+  round_trip({42}, 1);
+
+  /* Slowly varying connectivity packs to a few bits per value */
+  std::vector<int> smooth(100000);
+  for (size_t i = 0; i < smooth.size(); ++i)
+    smooth[i] = static_cast<int>(i / 4 + (i % 3));
+  CHECK(round_trip(smooth, 4) < smooth.size() * sizeof(int) / 4);
+
+  /* Extreme differences wrap around correctly */
+  int const lo = std::numeric_limits<int>::min();
+  int const hi = std::numeric_limits<int>::max();
+  std::vector<int> wild(1000);
+  for (size_t i = 0; i < wild.size(); ++i)
+    wild[i] = (i % 2) ? hi - static_cast<int>(i) : lo + static_cast<int>(i);
+  round_trip(wild, 3);
+
+  std::string bytes = Ume::Int_Codec::encode(smooth.data(), smooth.size());
+  bytes.pop_back();
+  CHECK(!Ume::Int_Codec::decode(bytes.data(), bytes.size(), smooth.data()));
+
+  /* A damaged count is not trusted */
+  bytes = Ume::Int_Codec::encode(smooth.data(), smooth.size());
+  uint64_t const huge = uint64_t{1} << 62;
+  std::memcpy(bytes.data(), &huge, sizeof(huge));
+  CHECK(Ume::Int_Codec::decoded_size(bytes.data(), bytes.size()) == 0);
+  CHECK(!Ume::Int_Codec::decode(bytes.data(), bytes.size(), smooth.data()));
+}
+
+TEST_CASE("Mesh sections", "[IO]") {
+  INTV_T ints_out(1000), ints_in;
+  VEC3V_T vecs_out, vecs_in;
+  for (int i = 0; i < 1000; ++i)
+    ints_out[i] = 7 * i;
+  for (int i = 0; i < 20; ++i)
+    vecs_out.emplace_back(VEC3_T(i));
+  std::vector<short> empty_out, empty_in{1, 2};
+
+  std::string const fname{"test_mesh_sections.bin"};
+  {
+    std::ofstream os(fname);
+    int const tag = 42;
+    Ume::write_bin(os, tag);
+    Ume::Section_Writer w;
+    w.add_bytes("meta", "some bytes");
+    w.add("ints", ints_out);
+    w.add("empty", empty_out);
+    w.add("vecs", vecs_out);
+    w.write(os, sizeof(tag));
+  }
+  {
+    /* Read out of order through a seekable stream */
+    std::ifstream is(fname);
+    int tag;
+    Ume::read_bin(is, tag);
+    Ume::Section_Reader r(is, sizeof(tag));
+    REQUIRE(r.toc().size() == 4);
+    REQUIRE(r.find("missing") == nullptr);
+    for (auto const &s : r.toc())
+      CHECK(s.offset % Ume::section_alignment == 0);
+    r.read("vecs", vecs_in);
+    r.read("ints", ints_in);
+    r.read("empty", empty_in);
+    CHECK(r.read_bytes("meta") == "some bytes");
+    CHECK(vecs_in == vecs_out);
+    CHECK(ints_in == ints_out);
+    CHECK(empty_in.empty());
+  }
+  {
+    /* Array payloads are aligned in the file */
+    Ume::Mapped_Istream is(fname);
+    int tag;
+    Ume::read_bin(is, tag);
+    Ume::Section_Reader r(is, sizeof(tag));
+    Ume::Section_Info const *s = r.find("ints");
+    REQUIRE(s != nullptr);
+    CHECK(s->type == Ume::Section_Type::INT32);
+    char const *const payload = is.mapping().data() + s->offset;
+    auto const addr = reinterpret_cast<uintptr_t>(payload);
+    CHECK(addr % Ume::section_alignment == 0);
+    CHECK(std::memcmp(payload, ints_out.data(), s->length) == 0);
+  }
+  {
+    /* Check every payload against its checksum, then damage one */
+    int const fd = ::open(fname.c_str(), O_RDWR);
+    REQUIRE(fd >= 0);
+    std::ifstream is(fname);
+    int tag;
+    Ume::read_bin(is, tag);
+    Ume::Section_Reader r(is, sizeof(tag), fd);
+    CHECK(r.check(2) == nullptr);
+    Ume::Section_Info const *s = r.find("vecs");
+    char const junk = 'x';
+    REQUIRE(pwrite(fd, &junk, 1, static_cast<off_t>(s->offset + 5)) == 1);
+    CHECK(r.check(2) == s);
+    ::close(fd);
+  }
+  std::remove(fname.c_str());
+}
+
+TEST_CASE("Mesh versions", "[IO]") {
+  using Ume::SOA_Idx::Mesh;
+  Mesh m;
+  m.mype = 1;
+  m.numpe = 4;
+  m.geo = Mesh::CYLINDRICAL;
+  m.dump_iotas = false;
+  m.points.resize(5, 6, 1);
+  m.sides.resize(1000, 1000, 0);
+  m.zones.resize(2, 3, 1);
+  auto &pcoord = m.ds->access_vec3v("pcoord");
+  for (size_t i = 0; i < pcoord.size(); ++i)
+    pcoord[i] = VEC3_T(static_cast<double>(i));
+  auto &s2p1 = m.ds->access_intv("m:s>p1");
+  for (size_t i = 0; i < s2p1.size(); ++i)
+    s2p1[i] = static_cast<int>(i % 5);
+  m.zones.subsets.resize(1);
+  m.zones.subsets[0].name = "mat1";
+  m.zones.subsets[0].lsize = 1;
+  m.zones.subsets[0].elements = {0, 2};
+  m.zones.subsets[0].mask = {1, 0};
+  m.zones.mySrcs.resize(1);
+  m.zones.mySrcs[0].pe = 0;
+  m.zones.mySrcs[0].elements = {1};
+
+  for (int const version : {UME_VERSION_2, UME_VERSION_3}) {
+    m.ivtag = version;
+    std::stringstream iobuf;
+    m.write(iobuf);
+    Mesh m2;
+    m2.read(iobuf);
+    CHECK(m2.ivtag == version);
+    CHECK(m2 == m);
+  }
+
+  /* Reading from a path loads the version 3 sections in parallel */
+  std::string const fname{"test_mesh_versions.ume"};
+  for (int const version : {UME_VERSION_2, UME_VERSION_3}) {
+    for (bool const compress : {false, true}) {
+      m.ivtag = version;
+      m.compress = compress;
+      {
+        std::ofstream os(fname);
+        m.write(os);
+      }
+      Mesh m2;
+      REQUIRE(m2.read(fname, 3));
+      CHECK(m2 == m);
+      CHECK(m2.load_bytes > 0);
+      CHECK(m2.compress == (compress && version == UME_VERSION_3));
+
+      /* Compressed sections also read through a stream */
+      std::ifstream is(fname);
+      Mesh m3;
+      m3.read(is);
+      CHECK(m3 == m);
+    }
+  }
+  std::remove(fname.c_str());
+  Mesh m4;
+  CHECK(!m4.read("no_such_file.ume"));
+
+  /* Streaming gives the same file, loading and releasing one entity at a
+     time */
+  for (bool const compress : {false, true}) {
+    m.ivtag = UME_VERSION_3;
+    m.compress = compress;
+    std::stringstream whole;
+    m.write(whole);
+    Mesh m5;
+    m5.read(whole);
+    std::stringstream streamed;
+    std::vector<Ume::SOA_Idx::Entity const *> loaded;
+    m5.write_streaming(streamed, [&](Ume::SOA_Idx::Entity &e) {
+      loaded.push_back(&e);
+      CHECK(m5.ds->caccess_vec3v("pcoord").empty() == (&e != &m5.points));
+    });
+    CHECK(streamed.str() == whole.str());
+    std::vector<Ume::SOA_Idx::Entity const *> const order{&m5.points,
+        &m5.edges, &m5.faces, &m5.sides, &m5.corners, &m5.zones};
+    CHECK(loaded == order);
+    CHECK(m5.sides.mask.empty());
+  }
+}
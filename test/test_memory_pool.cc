@@ -0,0 +1,309 @@
+/*
+  Copyright (c) 2023, Triad National Security, LLC. All rights reserved.
+
+  This is open source software; you can redistribute it and/or modify it under
+  the terms of the BSD-3 License. If software is modified to produce derivative
+  works, such modified software should be clearly marked, so as not to confuse
+  it with the version available from LANL. Full text of the BSD-3 License can be
+  found in the LICENSE.md file, and the full assertion of copyright in the
+  NOTICE.md file.
+*/
+
+
+#include "Ume/Timer.hh"
+#include "Ume/array_types.hh"
+#include "Ume/mem_exec_spaces.hh"
+#include "Ume/memory.hh"
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr unsigned block_size = 128;
+constexpr int num_threads = 8;
+} // namespace
+
+TEST_CASE("Pool claim/release bookkeeping", "[MemoryPool]") {
+  MemoryPoolAllocation<HostSpace> pool(16 * block_size, block_size);
+  void *a = pool.Claim(4 * block_size);
+  void *b = pool.Claim(4 * block_size);
+  void *c = pool.Claim(8 * block_size);
+  REQUIRE(a != b);
+  REQUIRE(b != c);
+
+  /* Releasing from the middle, then the neighbors, must coalesce so that the
+     whole pool can be claimed again */
+  CHECK(pool.Release(b) == 4 * block_size);
+  CHECK(pool.Release(b) == 0);
+  void *b2 = pool.Claim(3 * block_size);
+  CHECK(b2 == b); // best fit reuses the hole
+  CHECK(pool.Release(b2) == 3 * block_size);
+  CHECK(pool.Release(c) == 8 * block_size);
+  CHECK(pool.Release(a) == 4 * block_size);
+  void *all = pool.Claim(16 * block_size);
+  CHECK(all == a);
+  CHECK(pool.Release(all) == 16 * block_size);
+  CHECK(pool.NumClaims() == 5);
+}
+
+TEST_CASE("Pool statistics", "[MemoryPool]") {
+  MemoryPoolAllocation<HostSpace> pool(16 * block_size, block_size);
+  void *a = pool.Claim(4 * block_size);
+  void *b = pool.Claim(2 * block_size);
+  void *c = pool.Claim(4 * block_size);
+  CHECK(pool.Release(b) == 2 * block_size);
+
+  /* Free space is the 2 block hole and the 6 blocks at the end */
+  auto stats = pool.Stats();
+  CHECK(stats.pool_bytes == 16 * block_size);
+  CHECK(stats.claimed_bytes == 8 * block_size);
+  CHECK(stats.peak_bytes == 10 * block_size);
+  CHECK(stats.num_claims == 3);
+  CHECK(stats.live_claims == 2);
+  CHECK(stats.free_bytes == 8 * block_size);
+  CHECK(stats.largest_free_bytes == 6 * block_size);
+  CHECK(stats.fragmentation() == 0.25);
+
+  /* Arena claims count until their scope closes; the arena does not */
+  pool.ResetPeak();
+  {
+    ScratchScope<HostSpace> scope(pool, 4 * block_size);
+    void *s = pool.Claim(3 * block_size);
+    CHECK(pool.Release(s) == 0);
+    stats = pool.Stats();
+    CHECK(stats.claimed_bytes == 11 * block_size);
+    CHECK(stats.live_claims == 2);
+  }
+  stats = pool.Stats();
+  CHECK(stats.claimed_bytes == 8 * block_size);
+  CHECK(stats.peak_bytes == 11 * block_size);
+
+  CHECK(pool.Release(a) == 4 * block_size);
+  CHECK(pool.Release(c) == 4 * block_size);
+  stats = pool.Stats();
+  CHECK(stats.claimed_bytes == 0);
+  CHECK(stats.largest_free_bytes == 16 * block_size);
+  CHECK(stats.fragmentation() == 0.0);
+}
+
+TEST_CASE("Pool growth and shrinking", "[MemoryPool]") {
+  MemoryPoolAllocation<HostSpace> pool(16 * block_size, block_size);
+  pool.SetGrowth(16 * block_size, 80 * block_size);
+  void *a = pool.Claim(10 * block_size);
+  void *b = pool.Claim(10 * block_size); // does not fit, adds a segment
+  void *c = pool.Claim(40 * block_size); // larger than a segment
+  auto stats = pool.Stats();
+  CHECK(stats.num_segments == 2);
+  CHECK(stats.pool_bytes == 32 * block_size);
+  CHECK(stats.direct_bytes == 40 * block_size);
+  CHECK(stats.claimed_bytes == 60 * block_size);
+  CHECK(stats.live_claims == 3);
+
+  /* Claims are contiguous within a segment, and never span two */
+  auto *pa = static_cast<unsigned char *>(a);
+  auto *pb = static_cast<unsigned char *>(b);
+  std::fill(pa, pa + 10 * block_size, 1);
+  std::fill(pb, pb + 10 * block_size, 2);
+  CHECK(pa[10 * block_size - 1] == 1);
+
+  CHECK(pool.Release(c) == 40 * block_size);
+  CHECK(pool.Shrink() == 0); // b is still live
+  CHECK(pool.Release(b) == 10 * block_size);
+  void *d = pool.Claim(16 * block_size); // a whole free segment
+  CHECK(d == b);
+  CHECK(pool.Release(d) == 16 * block_size);
+  CHECK(pool.Shrink() == 16 * block_size);
+  stats = pool.Stats();
+  CHECK(stats.num_segments == 1);
+  CHECK(stats.pool_bytes == 16 * block_size);
+  CHECK(stats.direct_bytes == 0);
+  CHECK(stats.peak_bytes == 60 * block_size);
+  CHECK(pool.Release(b) == 0); // no longer in the pool
+
+  CHECK(pool.Release(a) == 10 * block_size);
+  CHECK(pool.Shrink() == 0); // the first segment is kept
+}
+
+TEST_CASE("Pool multi-threaded claim/release", "[MemoryPool]") {
+  constexpr int iterations = 2000;
+  constexpr int max_live = 16;
+  constexpr size_t max_bytes = 8 * block_size;
+  MemoryPoolAllocation<HostSpace> pool(
+      num_threads * max_live * max_bytes, block_size);
+
+  std::vector<int> failures(num_threads, 0);
+  auto worker = [&](int const tid) {
+    std::mt19937 gen(tid);
+    std::uniform_int_distribution<size_t> size_dist(1, max_bytes);
+    std::vector<std::pair<unsigned char *, size_t>> live;
+    for (int i = 0; i < iterations; ++i) {
+      if (live.size() < max_live && (live.empty() || gen() % 3 != 0)) {
+        size_t const bytes = size_dist(gen);
+        auto *p = static_cast<unsigned char *>(pool.Claim(bytes));
+        std::memset(p, tid + 1, bytes);
+        live.emplace_back(p, bytes);
+      } else {
+        auto const idx = gen() % live.size();
+        auto [p, bytes] = live[idx];
+        /* Nobody else may have written into our claim */
+        for (size_t b = 0; b < bytes; ++b)
+          failures[tid] += (p[b] != tid + 1);
+        failures[tid] += (pool.Release(p) == 0);
+        live[idx] = live.back();
+        live.pop_back();
+      }
+    }
+    for (auto [p, bytes] : live)
+      failures[tid] += (pool.Release(p) == 0);
+  };
+
+  Ume::Timer t;
+  t.start();
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid)
+    threads.emplace_back(worker, tid);
+  for (auto &th : threads)
+    th.join();
+  t.stop();
+  std::cout << "Pool: " << num_threads * iterations << " claims/releases on "
+            << num_threads << " threads took " << t << std::endl;
+
+  for (int tid = 0; tid < num_threads; ++tid)
+    CHECK(failures[tid] == 0);
+  /* Everything was returned and coalesced */
+  void *all = pool.Claim(pool.SizeInBytes());
+  CHECK(pool.Release(all) == pool.SizeInBytes());
+}
+
+TEST_CASE("LifetimeWrapper threaded reference counting", "[MemoryPool]") {
+  constexpr int copies = 10000;
+  void *data{nullptr};
+  {
+    auto array = NewArrayRank1<int>("shared array", 1000);
+    data = array.data();
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; ++tid) {
+      threads.emplace_back([&array]() {
+        for (int i = 0; i < copies; ++i) {
+          auto copy = array;
+          auto moved = std::move(copy);
+          decltype(array) assigned = moved;
+          assigned = array;
+        }
+      });
+    }
+    for (auto &th : threads)
+      th.join();
+    /* All of the copies are gone, but our reference keeps the claim alive */
+    CHECK(array.data() == data);
+  }
+  /* The last reference released the claim back to the pool */
+  CHECK(GetMemPool().Pool().Release(data) == 0);
+}
+
+TEST_CASE("ScratchScope bump allocation", "[MemoryPool]") {
+  MemoryPoolAllocation<HostSpace> pool(64 * block_size, block_size);
+  void *keep = pool.Claim(block_size); // a claim outside of any scope
+  {
+    ScratchScope outer(pool, 16 * block_size);
+    auto *a = static_cast<char *>(pool.Claim(2 * block_size));
+    auto *b = static_cast<char *>(pool.Claim(block_size / 2));
+    CHECK(b == a + 2 * block_size); // bump allocated
+    void *inner_start{nullptr};
+    {
+      ScratchScope inner(pool);
+      inner_start = pool.Claim(4 * block_size);
+      CHECK(inner_start == b + block_size);
+      CHECK(pool.Release(inner_start) == 0); // returned at scope exit
+      /* Releasing a claim of the outer scope does not count against the
+         inner one */
+      CHECK(pool.Release(b) == 0);
+    }
+    /* The inner scope's memory is reused */
+    void *c = pool.Claim(block_size);
+    CHECK(c == inner_start);
+    /* A claim that does not fit in the arena takes the normal path, and
+       may outlive the scope */
+    void *big = pool.Claim(32 * block_size);
+    CHECK(pool.Stats().live_claims == 4); // keep, a, c and big
+    pool.Release(c);
+    pool.Release(a);
+    CHECK(pool.Release(big) == 32 * block_size);
+  }
+  /* The arena was returned in one piece */
+  CHECK(pool.Release(keep) == block_size);
+  void *all = pool.Claim(64 * block_size);
+  CHECK(pool.Release(all) == 64 * block_size);
+}
+
+TEST_CASE("ScratchScope is per thread", "[MemoryPool]") {
+  MemoryPoolAllocation<HostSpace> pool(64 * block_size, block_size);
+  {
+    /* Without a size, no arena is reserved */
+    ScratchScope scope(pool);
+    CHECK(pool.Stats().largest_free_bytes == 64 * block_size);
+    void *a = pool.Claim(block_size);
+    CHECK(pool.Release(a) == block_size);
+  }
+
+  void *other{nullptr};
+  {
+    ScratchScope scope(pool, 8 * block_size);
+    CHECK(pool.Stats().largest_free_bytes == 56 * block_size);
+    void *mine = pool.Claim(block_size);
+    /* Another thread's claim does not come from this thread's arena, so it
+       can outlive the scope */
+    std::thread([&]() { other = pool.Claim(block_size); }).join();
+    CHECK(static_cast<char *>(other) != static_cast<char *>(mine) + block_size);
+    pool.Release(mine);
+  }
+  CHECK(pool.Release(other) == block_size);
+  void *all = pool.Claim(64 * block_size);
+  CHECK(pool.Release(all) == 64 * block_size);
+
+  /* Each thread gets its own arena */
+  std::vector<int> failures(num_threads, 0);
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&pool, &failures, tid]() {
+      for (int i = 0; i < 100; ++i) {
+        ScratchScope scope(pool, 4 * block_size);
+        auto *a = static_cast<char *>(pool.Claim(2 * block_size));
+        auto *b = static_cast<char *>(pool.Claim(2 * block_size));
+        failures[tid] += (b != a + 2 * block_size);
+        std::fill(a, a + 4 * block_size, static_cast<char>(tid));
+        failures[tid] += std::count(a, a + 4 * block_size,
+                             static_cast<char>(tid)) != 4 * block_size;
+        pool.Release(b);
+        pool.Release(a);
+      }
+    });
+  }
+  for (auto &th : threads)
+    th.join();
+  for (int tid = 0; tid < num_threads; ++tid)
+    CHECK(failures[tid] == 0);
+  CHECK(pool.Stats().claimed_bytes == 0);
+}
+
+TEST_CASE("ScratchScope with pool arrays", "[MemoryPool]") {
+  void *first{nullptr};
+  {
+    ScratchScope scope(1 << 20);
+    auto a = NewArrayRank1<double>("a", 1000);
+    auto b = NewArrayRank1<double>("b", 1000, 1.0, MemOpts::DoNotCopyInit{});
+    first = a.data();
+    CHECK(static_cast<void *>(b.data()) > first);
+  }
+  size_t const claims = GetMemPool().Pool().NumClaims();
+  {
+    ScratchScope scope(1 << 20);
+    auto a = NewArrayRank1<double>("a", 1000);
+    CHECK(a.data() == first);
+  }
+  CHECK(GetMemPool().Pool().NumClaims() == claims + 1);
+}
@@ -0,0 +1,125 @@
+/*
+  Copyright (c) 2023, Triad National Security, LLC. All rights reserved.
+
+  This is open source software; you can redistribute it and/or modify it under
+  the terms of the BSD-3 License. If software is modified to produce derivative
+  works, such modified software should be clearly marked, so as not to confuse
+  it with the version available from LANL. Full text of the BSD-3 License can be
+  found in the LICENSE.md file, and the full assertion of copyright in the
+  NOTICE.md file.
+*/
+
+
+#include "Ume/RaggedRight.hh"
+#include "Ume/mem_exec_spaces.hh"
+#include <catch2/catch_test_macros.hpp>
+#include <sstream>
+#include <vector>
+
+using RR = Ume::RaggedRight<int>;
+
+TEST_CASE("RaggedRight init_from_counts", "[RaggedRight]") {
+  std::vector<int> const counts{2, 0, 3, 1};
+  RR rr;
+  rr.init_from_counts(counts);
+  REQUIRE(rr.num_rows() == 4);
+  std::vector<int> const expect{0, 2, 2, 5, 6};
+  CHECK(std::equal(expect.begin(), expect.end(), rr.row_offsets().begin(),
+      rr.row_offsets().end()));
+  for (int n = 0; n < rr.num_rows(); ++n) {
+    CHECK(rr.size(n) == counts[n]);
+    for (auto &v : rr[n])
+      v = n;
+  }
+  CHECK(rr.values().size() == 6);
+  CHECK(rr[2][1] == 2);
+}
+
+TEST_CASE("RaggedRight assign", "[RaggedRight]") {
+  std::vector<std::vector<int>> const rows{{1, 2}, {}, {3, 4, 5}};
+  RR a, b;
+  a.assign_rows(rows);
+  b.init(3);
+  for (int n = 0; n < 3; ++n)
+    b.assign(n, rows[n].begin(), rows[n].end());
+  CHECK(a == b);
+
+  /* Reassigning a row replaces it in place, rather than abandoning data */
+  std::vector<int> const longer{7, 8, 9, 10};
+  b.assign(0, longer.begin(), longer.end());
+  CHECK(b.size(0) == 4);
+  CHECK(b.size(2) == 3);
+  CHECK(b[2][0] == 3);
+  CHECK(b.values().size() == 7);
+  b.assign(0, rows[0].begin(), rows[0].end());
+  b.compact();
+  CHECK(a == b);
+
+  std::stringstream ss;
+  a.write(ss);
+  RR c;
+  c.read(ss);
+  CHECK(a == c);
+}
+
+TEST_CASE("RaggedRight device view", "[RaggedRight]") {
+  std::vector<std::vector<int>> const rows{{1, 2}, {}, {3, 4, 5}, {6}};
+  RR rr;
+  rr.assign_rows(rows);
+  auto row_sums = [&rr]() {
+    auto const d_rr = rr.view<DevExecMemSpace>();
+    Kokkos::View<int *, DevExecMemSpace> d_sums("row sums", rr.num_rows());
+    Kokkos::parallel_for(
+        "sum rows", Kokkos::RangePolicy<DevExecSpace>(0, rr.num_rows()),
+        KOKKOS_LAMBDA(const int n) {
+          int sum{0};
+          for (int i = d_rr.begin(n); i < d_rr.end(n); ++i)
+            sum += d_rr.data(i);
+          d_sums(n) = sum + 100 * d_rr.size(n);
+        });
+    return Kokkos::create_mirror_view_and_copy(HostSpace(), d_sums);
+  };
+  auto h_sums = row_sums();
+  CHECK(h_sums(0) == 203);
+  CHECK(h_sums(1) == 0);
+  CHECK(h_sums(2) == 312);
+  CHECK(h_sums(3) == 106);
+
+  /* A second view is the same, and one after a change sees the change */
+  h_sums = row_sums();
+  CHECK(h_sums(2) == 312);
+  std::vector<int> const row1{7, 8};
+  rr.assign(1, row1.begin(), row1.end());
+  h_sums = row_sums();
+  CHECK(h_sums(0) == 203);
+  CHECK(h_sums(1) == 215);
+  CHECK(h_sums(2) == 312);
+  CHECK(h_sums(3) == 106);
+  rr[3][0] = 9;
+  h_sums = row_sums();
+  CHECK(h_sums(3) == 109);
+}
+
+TEST_CASE("RaggedRight invert_map", "[RaggedRight]") {
+  /* A pseudo-random item-to-row map, with some items excluded by negative
+     or out-of-range rows */
+  int const num_rows = 37;
+  int const num_items = 1000;
+  std::vector<int> i2r(num_items);
+  for (int i = 0; i < num_items; ++i)
+    i2r[i] = (i * 7919 + 13) % (num_rows + 6) - 3;
+
+  /* The serial reference */
+  std::vector<std::vector<int>> accum(num_rows);
+  for (int i = 0; i < num_items; ++i)
+    if (i2r[i] >= 0 && i2r[i] < num_rows)
+      accum[i2r[i]].push_back(i);
+  RR expect;
+  expect.assign_rows(accum);
+
+  RR rr;
+  Ume::invert_map(
+      rr, num_rows, num_items, [&](const int i) { return i2r[i]; },
+      [](const int i) { return i; });
+  CHECK(rr == expect);
+}
@@ -0,0 +1,353 @@
+/*
+  Copyright (c) 2023, Triad National Security, LLC. All rights reserved.
+
+  This is open source software; you can redistribute it and/or modify it under
+  the terms of the BSD-3 License. If software is modified to produce derivative
+  works, such modified software should be clearly marked, so as not to confuse
+  it with the version available from LANL. Full text of the BSD-3 License can be
+  found in the LICENSE.md file, and the full assertion of copyright in the
+  NOTICE.md file.
+*/
+
+#include "Ume/Comm_Transport.hh"
+#include "Ume/generate_mesh.hh"
+#include "Ume/gradient.hh"
+#include "Ume/renumbering.hh"
+#include <algorithm>
+#include <array>
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+using Catch::Approx;
+using Ume::Mesh_Spec;
+using Ume::Vec3;
+using Mesh = Ume::SOA_Idx::Mesh;
+
+namespace {
+
+Ume::Comm::Dummy_Transport dummy;
+
+/* A sorted list of the point coordinates of each side, which does not depend
+   on the numbering */
+std::vector<std::array<double, 6>> side_coords(Mesh &mesh) {
+  auto const &pcoord = mesh.ds->caccess_vec3v("pcoord");
+  auto const &s2p1 = mesh.ds->caccess_intv("m:s>p1");
+  auto const &s2p2 = mesh.ds->caccess_intv("m:s>p2");
+  std::vector<std::array<double, 6>> coords;
+  for (int s = 0; s < mesh.sides.size(); ++s) {
+    Vec3 const &a = pcoord[s2p1[s]];
+    Vec3 const &b = pcoord[s2p2[s]];
+    coords.push_back({a[0], a[1], a[2], b[0], b[1], b[2]});
+  }
+  std::sort(coords.begin(), coords.end());
+  return coords;
+}
+
+double real_volume(Mesh &mesh) {
+  auto const &side_vol = mesh.ds->caccess_dblv("side_vol");
+  double vol = 0.0;
+  for (int s = 0; s < mesh.sides.local_size(); ++s)
+    if (mesh.sides.mask[s] > 0)
+      vol += side_vol[s];
+  return vol;
+}
+
+/* Reverse the local elements of x */
+void reverse_entity(Ume::SOA_Idx::Entity &x, std::string const &x_tag) {
+  int const xl = x.local_size();
+  Ume::DS_Types::INTV_T x_to_xnew_map(x.size());
+  for (int i = 0; i < x.size(); ++i)
+    x_to_xnew_map[i] = i < xl ? xl - 1 - i : i;
+  Ume::reshape_entity(x, x_tag, x_to_xnew_map);
+}
+
+/* Renumber a mesh, and check that it is unchanged but for the numbering */
+void check_renumber(Mesh_Spec::Shape const shape, std::string const &name) {
+  Mesh_Spec spec;
+  spec.shape = shape;
+  spec.cells = {4, 3, 5};
+  Mesh mesh;
+  Ume::generate_mesh(spec, 0, mesh);
+  mesh.comm = &dummy;
+
+  double const vol = real_volume(mesh);
+  auto const coords = side_coords(mesh);
+  int const num_exterior = static_cast<int>(std::count(
+      mesh.zones.mask.begin(), mesh.zones.mask.end(), short{-1}));
+
+  auto const strategy = Ume::make_renumber_strategy(name);
+  REQUIRE(strategy);
+  strategy->renumber(mesh);
+
+  /* The mesh is the same, and the derived fields were rebuilt */
+  CHECK(side_coords(mesh) == coords);
+  CHECK(real_volume(mesh) == Approx(vol));
+  CHECK(std::count(mesh.zones.mask.begin(), mesh.zones.mask.end(),
+            short{-1}) == num_exterior);
+  auto const &s2s2 = mesh.ds->caccess_intv("m:s>s2");
+  for (int s = 0; s < mesh.sides.size(); ++s)
+    REQUIRE(s2s2[s2s2[s]] == s);
+
+  /* The gradient of a linear field is still exact at the interior points */
+  Vec3 const a{{1.0, -2.0, 3.0}};
+  auto const &zcoord = mesh.ds->caccess_vec3v("zcoord");
+  Ume::DS_Types::DBLV_T zone_field(mesh.zones.size());
+  for (int z = 0; z < mesh.zones.size(); ++z)
+    zone_field[z] = Ume::dotprod(a, zcoord[z]);
+  Ume::DS_Types::VEC3V_T zone_gradient(mesh.zones.size());
+  Ume::DS_Types::VEC3V_T point_gradient(mesh.points.size());
+  Ume::gradzatz(mesh, zone_field, zone_gradient, point_gradient);
+  for (int p = 0; p < mesh.points.local_size(); ++p) {
+    if (mesh.points.mask[p] <= 0)
+      continue;
+    for (int d = 0; d < 3; ++d)
+      CHECK(point_gradient[p][d] == Approx(a[d]));
+  }
+
+  auto const &c2p = mesh.ds->caccess_intv("m:c>p");
+  auto const &c2z = mesh.ds->caccess_intv("m:c>z");
+  auto const &s2z = mesh.ds->caccess_intv("m:s>z");
+  auto const &s2p1 = mesh.ds->caccess_intv("m:s>p1");
+  auto const &s2p2 = mesh.ds->caccess_intv("m:s>p2");
+  auto const &a2p = mesh.ds->caccess_intv("m:a>p");
+  auto const &a2s = mesh.ds->caccess_intv("m:a>s");
+  if (name == "wavefront" || name == "rcm") {
+    /* Corners and iotas are sorted by point, and sides by their larger
+       point */
+    CHECK(std::is_sorted(c2p.begin(), c2p.end()));
+    CHECK(std::is_sorted(a2p.begin(), a2p.end()));
+    for (int s = 1; s < mesh.sides.size(); ++s)
+      REQUIRE(std::max(s2p1[s - 1], s2p2[s - 1]) <=
+          std::max(s2p1[s], s2p2[s]));
+  } else {
+    /* Sides and corners are grouped by zone, and iotas by side */
+    CHECK(std::is_sorted(s2z.begin(), s2z.end()));
+    CHECK(std::is_sorted(c2z.begin(), c2z.end()));
+    CHECK(std::is_sorted(a2s.begin(), a2s.end()));
+  }
+  if (name.starts_with("bisection")) {
+    /* The corners reach the points in order */
+    int max_p = -1;
+    for (int c = 0; c < mesh.corners.local_size(); ++c) {
+      REQUIRE(c2p[c] <= max_p + 1);
+      max_p = std::max(max_p, c2p[c]);
+    }
+  }
+}
+
+} // namespace
+
+TEST_CASE("renumber_mesh", "[renumbering]") {
+  for (std::string const name :
+      {"wavefront", "hilbert", "morton", "rcm", "bisection", "bisection-l2"}) {
+    check_renumber(Mesh_Spec::HEX, name);
+    check_renumber(Mesh_Spec::TET, name);
+  }
+}
+
+TEST_CASE("renumber strategies", "[renumbering]") {
+  CHECK(Ume::make_renumber_strategy("wavefront")->needs_iotas());
+  CHECK_FALSE(Ume::make_renumber_strategy("hilbert")->needs_iotas());
+  CHECK_FALSE(Ume::make_renumber_strategy("peano"));
+
+  /* A strategy registered by the caller is made by name, like the rest */
+  struct Reverse_Points : Ume::Renumber_Strategy {
+    void renumber(Mesh &mesh) const override {
+      reverse_entity(mesh.points, "p");
+    }
+  };
+  Ume::register_renumber_strategy(
+      "reverse", [] { return std::make_unique<Reverse_Points>(); });
+  auto const names = Ume::renumber_strategy_names();
+  CHECK(std::ranges::find(names, "reverse") != names.end());
+  CHECK(std::ranges::find(names, "rcm") != names.end());
+
+  Mesh_Spec spec;
+  spec.cells = {2, 2, 2};
+  Mesh mesh;
+  Ume::generate_mesh(spec, 0, mesh);
+  mesh.comm = &dummy;
+  Vec3 const p0 = mesh.ds->caccess_vec3v("pcoord")[0];
+  Ume::make_renumber_strategy("reverse")->renumber(mesh);
+  CHECK(mesh.ds->caccess_vec3v("pcoord")[mesh.points.local_size() - 1] == p0);
+
+  /* Leave the registry as the other tests expect it */
+  CHECK(Ume::unregister_renumber_strategy("reverse"));
+  CHECK(!Ume::unregister_renumber_strategy("reverse"));
+  CHECK(!Ume::make_renumber_strategy("reverse"));
+}
+
+TEST_CASE("locality_metrics", "[renumbering]") {
+  Mesh_Spec spec;
+  spec.cells = {6, 5, 4};
+  Mesh mesh;
+  Ume::generate_mesh(spec, 0, mesh);
+  mesh.comm = &dummy;
+
+  /* Scramble the points, so that the side points are far apart */
+  int const pl = mesh.points.local_size();
+  Ume::DS_Types::INTV_T p_to_pnew_map(mesh.points.size());
+  for (int p = 0; p < mesh.points.size(); ++p)
+    p_to_pnew_map[p] = p < pl ? (p * 11) % pl : p;
+  REQUIRE(pl % 11 != 0);
+  Ume::reshape_entity(mesh.points, "p", p_to_pnew_map);
+  auto const scrambled = Ume::locality_metrics(mesh);
+  CHECK(scrambled.c2p > 0.0);
+  CHECK(scrambled.c2z >= 0.0);
+  CHECK(scrambled.s2z >= 0.0);
+
+  Ume::renumber_rcm(mesh);
+  auto const rcm = Ume::locality_metrics(mesh);
+  CHECK(rcm.point_bandwidth < scrambled.point_bandwidth);
+
+  Ume::renumber_bisection(mesh, 4096);
+  auto const bisection = Ume::locality_metrics(mesh);
+  CHECK(bisection.c2z < 1.0);
+}
+
+TEST_CASE("renumber_p", "[renumbering]") {
+  Mesh_Spec spec;
+  spec.cells = {6, 3, 2};
+  Mesh mesh;
+  Ume::generate_mesh(spec, 0, mesh);
+  mesh.comm = &dummy;
+
+  /* Null the plane of points at x = 0.5, which splits the point graph in
+     two pieces, and scramble the rest */
+  int const pl = mesh.points.local_size();
+  {
+    auto const &pcoord = mesh.ds->caccess_vec3v("pcoord");
+    for (int p = 0; p < pl; ++p)
+      if (std::abs(pcoord[p][0] - 0.5) < 1.0e-6)
+        mesh.points.mask[p] = 0;
+  }
+  reverse_entity(mesh.points, "p");
+  reverse_entity(mesh.iotas, "a");
+  int const num_null = static_cast<int>(std::count(
+      mesh.points.mask.begin(), mesh.points.mask.begin() + pl, short{0}));
+  REQUIRE(num_null == 4 * 3);
+
+  Ume::renumber_p(mesh);
+
+  /* The null points are last */
+  for (int p = 0; p < pl; ++p)
+    REQUIRE((mesh.points.mask[p] == 0) == (p >= pl - num_null));
+
+  /* Each piece is numbered in turn, in order of the distance from its
+     first point */
+  auto const &pcoord = mesh.ds->caccess_vec3v("pcoord");
+  auto const &s2p1 = mesh.ds->caccess_intv("m:s>p1");
+  auto const &s2p2 = mesh.ds->caccess_intv("m:s>p2");
+  std::vector<std::vector<int>> neighbors(pl);
+  for (int s = 0; s < mesh.sides.local_size(); ++s) {
+    int const p1 = s2p1[s];
+    int const p2 = s2p2[s];
+    if (mesh.points.mask[p1] != 0 && mesh.points.mask[p2] != 0) {
+      neighbors[p1].push_back(p2);
+      neighbors[p2].push_back(p1);
+    }
+  }
+  std::vector<int> distance(pl, -1);
+  int piece_start = 0;
+  int num_pieces = 0;
+  for (int p = 0; p < pl - num_null; ++p) {
+    if (distance[p] < 0) {
+      /* A new piece, on the other side of the null plane */
+      if (p > 0)
+        CHECK((pcoord[p][0] < 0.5) != (pcoord[0][0] < 0.5));
+      piece_start = p;
+      num_pieces += 1;
+      std::queue<int> front;
+      front.push(p);
+      distance[p] = 0;
+      while (!front.empty()) {
+        int const q = front.front();
+        front.pop();
+        for (int const n : neighbors[q]) {
+          if (distance[n] < 0) {
+            distance[n] = distance[q] + 1;
+            front.push(n);
+          }
+        }
+      }
+    }
+    if (p > piece_start)
+      REQUIRE(distance[p] >= distance[p - 1]);
+  }
+  CHECK(num_pieces == 2);
+}
+
+TEST_CASE("curve keys", "[renumbering]") {
+  CHECK(Ume::morton_key({0, 0, 0}) == 0);
+  CHECK(Ume::morton_key({1, 0, 0}) == 4);
+  CHECK(Ume::morton_key({0, 1, 0}) == 2);
+  CHECK(Ume::morton_key({0, 0, 1}) == 1);
+  CHECK(Ume::morton_key({3, 3, 3}) == 63);
+  CHECK(Ume::morton_key({(1 << 21) - 1, 0, 0}) >> 62 == 1);
+
+  /* Each step along the Hilbert curve is to a neighboring cell, and the
+     first 4^3 steps fill the 4^3 cube at the origin */
+  std::vector<std::pair<std::uint64_t, std::array<int, 3>>> cells;
+  for (std::uint32_t i = 0; i < 4; ++i)
+    for (std::uint32_t j = 0; j < 4; ++j)
+      for (std::uint32_t k = 0; k < 4; ++k)
+        cells.push_back({Ume::hilbert_key({i, j, k}),
+            {static_cast<int>(i), static_cast<int>(j), static_cast<int>(k)}});
+  std::sort(cells.begin(), cells.end());
+  CHECK(cells.front().first == 0);
+  CHECK(cells.back().first == 63);
+  for (size_t n = 1; n < cells.size(); ++n) {
+    auto const &a = cells[n - 1].second;
+    auto const &b = cells[n].second;
+    REQUIRE(std::abs(a[0] - b[0]) + std::abs(a[1] - b[1]) +
+            std::abs(a[2] - b[2]) ==
+        1);
+  }
+}
+
+TEST_CASE("reshape_entity", "[renumbering]") {
+  Mesh_Spec spec;
+  spec.cells = {2, 2, 2};
+  Mesh mesh;
+  Ume::generate_mesh(spec, 0, mesh);
+  mesh.comm = &dummy;
+
+  /* Reverse the points */
+  int const pl = mesh.points.local_size();
+  auto const pcoord = mesh.ds->caccess_vec3v("pcoord");
+  auto const s2p1 = mesh.ds->caccess_intv("m:s>p1");
+  auto const mask = mesh.points.mask;
+  Ume::DS_Types::INTV_T p_to_pnew_map(mesh.points.size());
+  for (int p = 0; p < pl; ++p)
+    p_to_pnew_map[p] = pl - 1 - p;
+  Ume::reshape_entity(mesh.points, "p", p_to_pnew_map);
+
+  auto const &new_pcoord = mesh.ds->caccess_vec3v("pcoord");
+  auto const &new_s2p1 = mesh.ds->caccess_intv("m:s>p1");
+  for (int p = 0; p < pl; ++p) {
+    REQUIRE(new_pcoord[p] == pcoord[pl - 1 - p]);
+    REQUIRE(mesh.points.mask[p] == mask[pl - 1 - p]);
+  }
+  for (int s = 0; s < mesh.sides.size(); ++s)
+    REQUIRE(new_s2p1[s] == pl - 1 - s2p1[s]);
+
+  /* Map values that are not valid indices (such as the bad m:c>z values
+     at some ghost corners) are left alone */
+  auto &c2z = mesh.ds->access_intv("m:c>z");
+  int const zll = mesh.zones.size();
+  c2z[0] = zll + 5;
+  c2z[1] = -1;
+  int const z2 = c2z[2];
+  reverse_entity(mesh.zones, "z");
+  auto const &new_c2z = mesh.ds->caccess_intv("m:c>z");
+  CHECK(new_c2z[0] == zll + 5);
+  CHECK(new_c2z[1] == -1);
+  CHECK(new_c2z[2] == mesh.zones.local_size() - 1 - z2);
+}
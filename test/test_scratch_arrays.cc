@@ -9,12 +9,17 @@
   NOTICE.md file.
 */
 
+#include "Ume/Comm_Transport.hh"
 #include "Ume/DS_Types.hh"
 #include "Ume/VecN.hh"
 #include "Ume/array_types.hh"
+#include "Ume/face_area.hh"
+#include "Ume/generate_mesh.hh"
+#include "Ume/gradient.hh"
 #include "Ume/mem_exec_spaces.hh"
 #include "Ume/memory.hh"
 #include <catch2/catch_test_macros.hpp>
+#include <cmath>
 #include <concepts>
 
 TEST_CASE("1D int scratch array"
@@ -234,3 +239,38 @@ TEST_CASE("STL vector view copy/set/copy-back"
   REQUIRE(host_var(dim0 - 1) == host_const_var(dim0 - 1));
   REQUIRE(var[dim0 - 1] == const_var[dim0 - 1]);
 }
+
+TEST_CASE("Scratch arrays without the memory pool", "[ScratchArrayRank1]") {
+  size_t const claims = GetMemPool().Pool().NumClaims();
+  {
+    ScratchArrayRank1<double> pooled("pooled", 100);
+    CHECK(pooled.claim.data() != nullptr);
+    CHECK(pooled.view.data() == pooled.claim.data());
+  }
+  CHECK(GetMemPool().Pool().NumClaims() == claims + 1);
+
+  /* The library kernels fall back to Kokkos views */
+  GetMemPool().IsPoolEnabled() = false;
+  {
+    ScratchArrayRank1<double> plain("plain", 100);
+    CHECK(plain.claim.data() == nullptr);
+    CHECK(plain.view.extent(0) == 100);
+
+    Ume::Mesh_Spec spec;
+    spec.cells = {3, 3, 3};
+    Ume::SOA_Idx::Mesh mesh;
+    Ume::generate_mesh(spec, 0, mesh);
+    Ume::Comm::Dummy_Transport dummy;
+    mesh.comm = &dummy;
+    Ume::DS_Types::DBLV_T zone_field(mesh.zones.size(), 1.0);
+    Ume::DS_Types::VEC3V_T zone_gradient, point_gradient;
+    Ume::gradzatz(mesh, zone_field, zone_gradient, point_gradient);
+    for (int z = 0; z < mesh.zones.local_size(); ++z)
+      for (int d = 0; d < 3; ++d)
+        CHECK(std::abs(zone_gradient[z][d]) < 1.0e-12);
+    Ume::DS_Types::DBLV_T face_area(mesh.faces.size());
+    Ume::calc_face_area(mesh, face_area);
+  }
+  GetMemPool().IsPoolEnabled() = true;
+  CHECK(GetMemPool().Pool().NumClaims() == claims + 1);
+}
@@ -9,6 +9,7 @@
   NOTICE.md file.
 */
 
+#include "Ume/Comm_Buffers.hh"
 #include "Ume/VecN.hh"
 #include "Ume/utils.hh"
 #include <catch2/catch_test_macros.hpp>
@@ -66,6 +67,20 @@ TEST_CASE("vector<Vec3> binary r/w", "[utils]") {
   REQUIRE(in_vec == out_vec);
 }
 
+TEST_CASE("Vec3 comm buffer pack/unpack", "[utils]") {
+  using Ume::Vec3;
+  Ume::Comm::Neighbors const neighs{{1, {2, 0}}, {3, {1}}};
+  Ume::Comm::Buffers<Ume::DS_Types::VEC3V_T> bufs(neighs);
+  Ume::DS_Types::VEC3V_T in_vec{
+      Vec3({1.0, 2.0, 3.0}), Vec3({4.0, 5.0, 6.0}), Vec3({7.0, 8.0, 9.0})};
+  bufs.pack(in_vec);
+  std::vector<double> const expected{7, 8, 9, 1, 2, 3, 4, 5, 6};
+  REQUIRE(std::vector<double>(bufs.get_buf(), bufs.get_buf() + 9) == expected);
+  Ume::DS_Types::VEC3V_T out_vec(3, Vec3(0.0));
+  bufs.unpack(out_vec, Ume::Comm::Op::OVERWRITE);
+  REQUIRE(in_vec == out_vec);
+}
+
 TEST_CASE("ltrim", "[utils]") {
   std::string a{"  \tThis is a test\t    "};
   std::string b;